@@ -0,0 +1,125 @@
+#include <stdio.h>  //sprintf
+#include "IO_Driver.h"
+#include "IO_RTC.h"
+#include "IO_UART.h"
+
+#include "arena.h"
+#include "serial.h"
+
+//Placement.  The TASKING locator puts __near data in DSRAM and __huge data in
+//external RAM.  Other compilers (e.g. the host replay build) don't need it.
+#if defined(__C166__)
+    #define ARENA_INTERNAL_RAM __near
+    #define ARENA_EXTERNAL_RAM __huge
+#else
+    #define ARENA_INTERNAL_RAM
+    #define ARENA_EXTERNAL_RAM
+#endif
+
+//Every allocation is rounded up to a whole ArenaWord so any object can start there
+typedef union _ArenaWord
+{
+    void* pointer;
+    ubyte4 integer;
+    float4 real;
+} ArenaWord;
+
+#define ARENA_WORDS(bytes) (((bytes) + sizeof(ArenaWord) - 1) / sizeof(ArenaWord))
+
+static ARENA_INTERNAL_RAM ArenaWord arena_internal[ARENA_WORDS(ARENA_INTERNAL_SIZE)];
+static ARENA_EXTERNAL_RAM ArenaWord arena_external[ARENA_WORDS(ARENA_EXTERNAL_SIZE)];
+
+typedef struct _ArenaRegionState
+{
+    ArenaWord* storage;
+    ubyte2 words;
+    ubyte2 wordsUsed;
+    ubyte1 objects;
+} ArenaRegionState;
+
+static ArenaRegionState arenaRegions[] =
+{
+      { (ArenaWord*)arena_internal, ARENA_WORDS(ARENA_INTERNAL_SIZE), 0, 0 }  //ARENA_INTERNAL
+    , { (ArenaWord*)arena_external, ARENA_WORDS(ARENA_EXTERNAL_SIZE), 0, 0 }  //ARENA_EXTERNAL
+};
+
+static ubyte1 arenaFallbacks = 0;  //Internal requests that went to external RAM
+
+static void* Arena_take(ArenaRegionState* region, ubyte2 words)
+{
+    if (words > region->words - region->wordsUsed) { return NULL; }
+
+    void* object = &region->storage[region->wordsUsed];
+    region->wordsUsed += words;
+    region->objects++;
+    return object;
+}
+
+//Out of memory.  Every constructor uses its object straight away, so NULL would only fault
+//somewhere less obvious.  This only happens during init, before anything has been turned on,
+//so stop here with the outputs still off and keep printing why (the SerialManager may be
+//the thing that didn't fit, so write to the UART directly).
+static void Arena_halt(ArenaRegion region, ubyte2 size)
+{
+    ubyte1 message[128];
+    ubyte1 length = (ubyte1)sprintf(message, "Arena full: no room for a %u byte object (region %u) - increase the arena sizes.  VCU halted.\n", size, region);
+    bool sent = FALSE;
+    ubyte4 timestamp_message = 0;
+    ubyte4 timestamp_cycle;
+
+    while (1)
+    {
+        IO_RTC_StartTime(&timestamp_cycle);
+        IO_Driver_TaskBegin();
+        if (sent == FALSE || IO_RTC_GetTimeUS(timestamp_message) >= 1000000)
+        {
+            ubyte1 written;
+            sent = TRUE;
+            IO_RTC_StartTime(&timestamp_message);
+            IO_UART_Write(IO_UART_CH0, message, length, &written);
+        }
+        IO_Driver_TaskEnd();
+        while (IO_RTC_GetTimeUS(timestamp_cycle) < 1000);   //1 ms driver cycle
+    }
+}
+
+void* Arena_allocate(ArenaRegion region, ubyte2 size)
+{
+    ubyte2 words = ARENA_WORDS(size);
+    void* object = Arena_take(&arenaRegions[region], words);
+
+    if (object == NULL && region == ARENA_INTERNAL)
+    {
+        object = Arena_take(&arenaRegions[ARENA_EXTERNAL], words);
+        if (object != NULL) { arenaFallbacks++; }
+    }
+    if (object == NULL) { Arena_halt(region, size); }
+
+    return object;
+}
+
+ubyte2 Arena_getUsed(ArenaRegion region)
+{
+    return arenaRegions[region].wordsUsed * sizeof(ArenaWord);
+}
+
+ubyte2 Arena_getSize(ArenaRegion region)
+{
+    return arenaRegions[region].words * sizeof(ArenaWord);
+}
+
+void Arena_report(SerialManager* serialMan)
+{
+    ubyte1 message[96];
+
+    sprintf(message, "Memory: internal %u/%u bytes (%u objects), external %u/%u bytes (%u objects)\n"
+        , Arena_getUsed(ARENA_INTERNAL), Arena_getSize(ARENA_INTERNAL), arenaRegions[ARENA_INTERNAL].objects
+        , Arena_getUsed(ARENA_EXTERNAL), Arena_getSize(ARENA_EXTERNAL), arenaRegions[ARENA_EXTERNAL].objects);
+    SerialManager_send(serialMan, message);
+
+    if (arenaFallbacks > 0)
+    {
+        sprintf(message, "%u objects didn't fit in internal RAM - increase ARENA_INTERNAL_SIZE\n", arenaFallbacks);
+        SerialManager_log(serialMan, SERIAL_WARNING, message);
+    }
+}
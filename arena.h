@@ -0,0 +1,45 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include "IO_Driver.h"
+#include "serial.h"
+
+/*****************************************************************************
+* Static memory arena
+******************************************************************************
+* Every object is created once at power up and lives until power off, so the
+* *_new constructors take their memory from two fixed arrays instead of the
+* heap.  Nothing is ever freed.  Allocation is deterministic (same objects,
+* same order, same addresses every time) and there's no heap to size or
+* fragment.
+*
+* ARENA_INTERNAL is the XC2000's on-chip DSRAM (single cycle access) - use it
+* for objects the fast task touches every tick.  ARENA_EXTERNAL is external
+* RAM, for buffers and anything that's only used occasionally.  If an object
+* doesn't fit in the internal region it goes to external RAM instead; the
+* startup report (Arena_report) shows when that happens.  If it doesn't fit
+* in either, the VCU halts during init (see Arena_allocate) - constructors
+* never get NULL.
+*
+* Sizes are set here so the linker (not the allocator) decides where the
+* memory is.  Check the map file after changing them.
+****************************************************************************/
+#define ARENA_INTERNAL_SIZE 6144
+#define ARENA_EXTERNAL_SIZE 6144
+
+typedef enum
+{
+      ARENA_INTERNAL
+    , ARENA_EXTERNAL
+} ArenaRegion;
+
+//Never returns NULL: if the object fits in neither region, halts with the reason on the serial port
+void* Arena_allocate(ArenaRegion region, ubyte2 size);
+
+ubyte2 Arena_getUsed(ArenaRegion region);  //High-water mark = used, since nothing is freed
+ubyte2 Arena_getSize(ArenaRegion region);
+
+//Usage of both regions, plus any fallbacks.  Call once the objects are created.
+void Arena_report(SerialManager* serialMan);
+
+#endif // _ARENA_H
@@ -1,11 +1,13 @@
 
 #include <stdio.h>
 #include "bms.h"
-#include <stdlib.h>
+#include "arena.h"
+#include <stddef.h>
 #include "IO_Driver.h"
 #include "IO_RTC.h"
 #include "serial.h"
 #include "mathFunctions.h"
+#include "canSignals.h"
 
 /**************************************************************************
  *     REVISION HISTORY:
@@ -36,7 +38,8 @@
  *                                                          *
  **********************************************************/
 
-
+//Messages canMessageBaseId + 0 .. + 9 (0x620 - 0x629)
+#define BMS_MESSAGE_COUNT 10
 
 struct _BatteryManagementSystem {
 
@@ -44,6 +47,14 @@ struct _BatteryManagementSystem {
 
     SerialManager* sm;
 
+    //Latest frame of each message, as received.  Fields below are only decoded from
+    //it when a getter needs them (see BMS_decode), and then kept until the next frame.
+    IO_CAN_DATA_FRAME frames[BMS_MESSAGE_COUNT];
+    ubyte2 undecoded;                                  //Bit per message: frame is newer than the fields
+    ubyte4 timebase;
+    ubyte4 timestamp_received[BMS_MESSAGE_COUNT];      //BMS timebase (BMS_new = 0)
+    ubyte4 timeout_us[BMS_MESSAGE_COUNT];              //0 = not monitored
+
     // 0x622h //
 
     ubyte1  state;             // state of system
@@ -56,9 +67,9 @@ struct _BatteryManagementSystem {
     // 0x623h //
 
 //    ubyte2 packVoltage;        // Total voltage of pack
-    ubyte1  minVtg;            // Voltage of least charged cell
+    ubyte1  minVtg;            // Voltage of least charged cell (100 mV)
     ubyte1  minVtgCell;         // ID of cell with lowest voltage
-    ubyte1  maxVtg;            // Voltage of most charged cell
+    ubyte1  maxVtg;            // Voltage of most charged cell (100 mV)
     ubyte1  maxVtgCell;         // ID of cell with highest voltage
 
     // 0x624h //
@@ -90,10 +101,10 @@ struct _BatteryManagementSystem {
 
     // 0x628h //
 
-    ubyte2     packRes;            // resistance of entire pack
-    ubyte1  minRes;              // resistance of lowest resistance cells
+    ubyte2     packRes;            // resistance of entire pack (raw BMS units)
+    ubyte1  minRes;              // resistance of lowest resistance cells (raw)
     ubyte1  minResCell;         // ID of cell with lowest resistance
-    ubyte1  maxRes;                // resistance of highest resistance cells
+    ubyte1  maxRes;                // resistance of highest resistance cells (raw)
     ubyte1  maxResCell;            // ID of cell with highest resistance
 
     // 0X629 //
@@ -115,7 +126,7 @@ struct _BatteryManagementSystem {
 
 BatteryManagementSystem* BMS_new(SerialManager* serialMan, ubyte2 canMessageBaseID) {
 
-    BatteryManagementSystem* me = (BatteryManagementSystem*)malloc(sizeof(struct _BatteryManagementSystem));
+    BatteryManagementSystem* me = (BatteryManagementSystem*)Arena_allocate(ARENA_EXTERNAL, sizeof(struct _BatteryManagementSystem));
 
     me->canMessageBaseId = canMessageBaseID;
     me->sm = serialMan;
@@ -128,173 +139,175 @@ BatteryManagementSystem* BMS_new(SerialManager* serialMan, ubyte2 canMessageBase
     me->DCL = 0;
     me->chargeLimit = 0;
     me->dischargeLimit = 0;
+
+    //Nothing received yet.  Monitored messages count as stale once their timeout has passed since power up.
+    IO_RTC_StartTime(&me->timebase);
+    me->undecoded = 0;
+    for (ubyte1 i = 0; i < BMS_MESSAGE_COUNT; i++)
+    {
+        me->timestamp_received[i] = 0;
+        me->timeout_us[i] = 0;
+    }
     
     return me;
 
 }
 
-void BMS_parseCanMessage(BatteryManagementSystem* bms, IO_CAN_DATA_FRAME* bmsCanMessage){
-    ubyte2 utemp16;
-//    sbyte1  temp16;
-    ubyte4 utemp32;
+/*****************************************************************************
+* CAN signals
+******************************************************************************
+* Where each BMS message field lives.  Note that despite the caution above,
+* the Elithion frames we receive are decoded little-endian (this matches the
+* previous byte-swapped parsing).
+* Values are stored in the BMS's own units: dividing in integer math here
+* turned most of them into 0.
+* 0x629: See https://onedrive.live.com/view.aspx?resid=F9BB8F0F8FDB5CF8!36803&ithint=file%2cxlsx&app=Excel&authkey=!AI-YHJrHmtUaWpI
+****************************************************************************/
+#define BMS_FIELD(messageID, signal, field) { messageID, signal, offsetof(struct _BatteryManagementSystem, field), sizeof(((BatteryManagementSystem*)0)->field) }
+
+static const CanSignalField bmsSignals[] =
+{
+    //0x622
+      BMS_FIELD(0x622, CANSIGNAL_LE( 0,  8), state)
+    , BMS_FIELD(0x622, CANSIGNAL_LE( 8, 16), timer)
+    , BMS_FIELD(0x622, CANSIGNAL_LE(24,  8), flags)
+    , BMS_FIELD(0x622, CANSIGNAL_LE(32,  8), faultCode)
+    , BMS_FIELD(0x622, CANSIGNAL_LE(40,  8), levelFaults)
+    , BMS_FIELD(0x622, CANSIGNAL_LE(48,  8), warnings)
+
+    //0x623 - bytes 0,1 = pack voltage (unused)
+    , BMS_FIELD(0x623, CANSIGNAL_LE(16,  8), minVtg)                  //255 = 25.5V
+    , BMS_FIELD(0x623, CANSIGNAL_LE(24,  8), minVtgCell)              //1-254
+    , BMS_FIELD(0x623, CANSIGNAL_LE(32,  8), maxVtg)                  //255 = 25.5V
+    , BMS_FIELD(0x623, CANSIGNAL_LE(40,  8), maxVtgCell)              //1-254
+
+    //0x624 - bytes 0,1 = pack current (unused)
+    , BMS_FIELD(0x624, CANSIGNAL_LE(16, 16), chargeLimit)
+    , BMS_FIELD(0x624, CANSIGNAL_LE(32, 16), dischargeLimit)
+
+    //0x625
+    , BMS_FIELD(0x625, CANSIGNAL_LE( 0, 32), batteryEnergyIn)
+    , BMS_FIELD(0x625, CANSIGNAL_LE(32, 32), batteryEnergyOut)
+
+    //0x626
+    , BMS_FIELD(0x626, CANSIGNAL_LE( 0,  8), SOC)
+    , BMS_FIELD(0x626, CANSIGNAL_LE( 8, 16), DOD)
+    , BMS_FIELD(0x626, CANSIGNAL_LE(24, 16), capacity)
+    , BMS_FIELD(0x626, CANSIGNAL_LE(48,  8), SOH)
+
+    //0x627 - byte 0 = pack temp (unused)
+    , BMS_FIELD(0x627, CANSIGNAL_LE_SIGNED(16, 8), minTemp)
+    , BMS_FIELD(0x627, CANSIGNAL_LE(24,  8), minTempCell)
+    , BMS_FIELD(0x627, CANSIGNAL_LE_SIGNED(32, 8), maxTemp)
+    , BMS_FIELD(0x627, CANSIGNAL_LE(40,  8), maxTempCell)
+
+    //0x628 - 1 = 100 mOhm, 10000 = 1 ohm
+    , BMS_FIELD(0x628, CANSIGNAL_LE( 0, 16), packRes)
+    , BMS_FIELD(0x628, CANSIGNAL_LE(16,  8), minRes)
+    , BMS_FIELD(0x628, CANSIGNAL_LE(24,  8), minResCell)
+    , BMS_FIELD(0x628, CANSIGNAL_LE(32,  8), maxRes)
+    , BMS_FIELD(0x628, CANSIGNAL_LE(40,  8), maxResCell)
+
+    //0x629
+    , BMS_FIELD(0x629, CANSIGNAL_LE( 0, 16), packVoltage)                       //Voltage(100mV)[022]
+    , BMS_FIELD(0x629, CANSIGNAL_LE_SIGNED(16, 16), packCurrent)                //Current(100mA)[054]
+    , BMS_FIELD(0x629, CANSIGNAL_LE_SIGNED(32, 8), maxTemp)                     //Max Temp[104] - C
+    , BMS_FIELD(0x629, CANSIGNAL_LE_SIGNED(40, 8), avgTemp)                     //Avg Temp[096] - C
+    , BMS_FIELD(0x629, CANSIGNAL_LE(48,  8), CCL)                               //%
+    , BMS_FIELD(0x629, CANSIGNAL_LE(56,  8), DCL)                               //%
+};
 
+//Only stores the frame - decoding waits until somebody asks for a value
+void BMS_parseCanMessage(BatteryManagementSystem* bms, IO_CAN_DATA_FRAME* bmsCanMessage)
+{
+    ubyte2 messageIndex = bmsCanMessage->id - bms->canMessageBaseId;
+    if (messageIndex >= BMS_MESSAGE_COUNT) { return; }
 
-    switch (bmsCanMessage->id)
-    {
+    bms->frames[messageIndex] = *bmsCanMessage;
+    bms->undecoded |= (ubyte2)1 << messageIndex;
+    bms->timestamp_received[messageIndex] = IO_RTC_GetTimeUS(bms->timebase);
+}
 
-    case 0x622:
+//Brings the fields of one message (canMessageBaseId + messageIndex) up to date
+static void BMS_decode(BatteryManagementSystem* me, ubyte1 messageIndex)
+{
+    ubyte2 bit = (ubyte2)1 << messageIndex;
+    if ((me->undecoded & bit) == 0) { return; }
 
-        bms->state = bmsCanMessage->data[0];
-        utemp16 = (ubyte2)bmsCanMessage->data[1] << 8 | bmsCanMessage->data[2];
-        bms->timer = swap_uint16(utemp16);
-        bms->flags = bmsCanMessage->data[3];
-        bms->faultCode = bmsCanMessage->data[4];
-        bms->levelFaults = bmsCanMessage->data[5];
-        bms->warnings = bmsCanMessage->data[6];
-        break;
-
-    case 0x623:
-
-        //    utemp16 = ((bmsCanMessage->data[0] << 8) | (bmsCanMessage->data[1]));
-        //    bms->packVoltage = swap_uint16(utemp16);  //65535 = 65535V
-        bms->minVtg = (bmsCanMessage->data[2] / 10);    //255 = 25.5V
-        bms->minVtgCell = bmsCanMessage->data[3];       //1-254
-        bms->maxVtg = (bmsCanMessage->data[4] / 10);    //255 = 25.5V
-        bms->maxVtgCell = bmsCanMessage->data[5];       //1-254
-
-        break;
-
-    case 0x624:
-
-        //    temp16 = ((bmsCanMessage->data[0] << 8) | (bmsCanMessage->data[1]));
-        //    bms->packCurrent = swap_int16(temp16);
-
-        utemp16 = ((bmsCanMessage->data[2] << 8) | (bmsCanMessage->data[3]));
-        bms->chargeLimit = swap_uint16(utemp16);
-
-        utemp16 = ((bmsCanMessage->data[4] << 8) | (bmsCanMessage->data[5]));
-        bms->dischargeLimit = swap_uint16(utemp16);
-
-        break;
-
-    case 0x625:
-
-        utemp32 = ((((ubyte4)bmsCanMessage->data[0] << 24) |
-                ((ubyte4)bmsCanMessage->data[1] << 16) |
-                ((ubyte4)bmsCanMessage->data[2] << 8) |
-                (bmsCanMessage->data[3])));
-        bms->batteryEnergyIn = swap_uint32(utemp32);
-
-        utemp32 = ((((ubyte4)bmsCanMessage->data[4] << 24) |
-                ((ubyte4)bmsCanMessage->data[5] << 16) |
-                ((ubyte4)bmsCanMessage->data[6] << 8) |
-                ((ubyte4)bmsCanMessage->data[7])));
-        bms->batteryEnergyOut = swap_uint32(utemp32);
-
-        break;
-
-    case 0x626:
-
-            bms->SOC = bmsCanMessage->data[0];
-
-        utemp16 = ((bmsCanMessage->data[1] << 8) | (bmsCanMessage->data[2]));
-        bms->DOD = swap_uint16(utemp16);
-
-        utemp16 = ((bmsCanMessage->data[3] << 8) | (bmsCanMessage->data[4]));
-        bms->capacity = swap_uint16(utemp16);
-        bms->SOH = bmsCanMessage->data[6];
-
-        break;
-
-    case 0x627:
-
-        //bms->packTemp = bmsCanMessage->data[0];
-        bms->minTemp = bmsCanMessage->data[2];
-        bms->minTempCell = bmsCanMessage->data[3];
-        bms->maxTemp = bmsCanMessage->data[4];
-        bms->maxTempCell = bmsCanMessage->data[5];
-
-        break;
-
-    case 0x628:
-
-        utemp16 = ((bmsCanMessage->data[0] << 8) | (bmsCanMessage->data[1]));
-        bms->packRes = ((swap_uint16(utemp16)) / 10000);
-//        1 = 100 mOhm
-//        10 = 1000 mOhm = 0.001 ohm = 10/10000
-//        100 = 10000 mohm = 0.01 ohm
-//        1000 = 100000 mOhM = 0.1 ohm
-//        10000 = 1000000 mOhm = 1 ohm
-        bms->minRes = (bmsCanMessage->data[2] / 10000);
-        bms->minResCell = bmsCanMessage->data[3];
-        bms->maxRes = (bmsCanMessage->data[4] / 10000);
-        bms->maxResCell = bmsCanMessage->data[5];
-        break;
-
-    case 0x629:
-        //See https://onedrive.live.com/view.aspx?resid=F9BB8F0F8FDB5CF8!36803&ithint=file%2cxlsx&app=Excel&authkey=!AI-YHJrHmtUaWpI
-        //Voltage(100mV)[022] - 2 bytes little endian (1=100mV) 0000000000000001 = 1 = 100 mV = 0.1 V
-                                                        //        5 = 500 mV = 0.5 V
-                                                        //        10 = 1000 mV = 1 V
-                                                        //       100 = 10000 mV = 10 V
-                                                        //         1000 = 100000 mV = 100 V
-        //Current(100mA)[054] - 2 bytes little endian (1=100mA)
-        //Max Temp[104] - in C
-        //Avg Temp[096] - in C
-        //SOC(%)[112] - %
-        //DCL(%)[080]- %  //**CHANGED**
-        
-        bms->packVoltage = (((bmsCanMessage->data[1] << 8) | (bmsCanMessage->data[0])) / 10); //V
-        bms->packCurrent = (((bmsCanMessage->data[3] << 8) | (bmsCanMessage->data[2])) / 10); //V
-        bms->maxTemp = ((bmsCanMessage->data[4]));  //C
-        bms->avgTemp = ((bmsCanMessage->data[5]));  //C
-        bms->CCL = ((bmsCanMessage->data[6]));    //%
-        bms->DCL = ((bmsCanMessage->data[7]));    //%
-
-        break;
-    }
+    CanSignal_unpackFields(bmsSignals, sizeof(bmsSignals) / sizeof(bmsSignals[0]), &me->frames[messageIndex], me);
+    me->undecoded &= ~bit;
 }
 
 sbyte1 BMS_getAvgTemp(BatteryManagementSystem* me)
 {
-    char buffer[32];
-    sprintf(buffer, "AvgPackTemp: %i\n", me->avgTemp);
+    BMS_decode(me, 9);
     return (me->avgTemp);
 }
 sbyte1 BMS_getMaxTemp(BatteryManagementSystem* me)
 {
-    char buffer[32];
-    sprintf(buffer, "MaxTemp: %i\n", me->maxTemp);
+    //0x627 and 0x629 both carry the max temp - 0x629 wins, like it did when every frame was decoded
+    BMS_decode(me, 7);
+    BMS_decode(me, 9);
     return (me->maxTemp);
 }
 
 // ***NOTE: packCurrent and and packVoltage are SIGNED variables and the return type for BMS_getPower is signed
+//Watts: (100 mA * 100 mV) / 100
 sbyte4 BMS_getPower(BatteryManagementSystem* me)
 {
-    //char buffer[32];
-    //sprintf(buffer, "packVoltage: %f\n", me->packVoltage);
-    return (me->packCurrent * me->packVoltage);
+    BMS_decode(me, 9);
+    return (me->packCurrent * me->packVoltage) / 100;
 }
 
 ubyte2 BMS_getPackTemp(BatteryManagementSystem* me)
 {
-    char buffer[32];
-    sprintf(buffer, "PackTemp: %i\n", me->packTemp);
     return (me->packTemp);
 }
 
-ubyte1 BMS_getCCL(BatteryManagementSystem* me)
+ubyte2 BMS_getCCL(BatteryManagementSystem* me)
 {
+    BMS_decode(me, 4);
     //return me->CCL;
     return me->chargeLimit;
 }
 
-ubyte1 BMS_getDCL(BatteryManagementSystem* me)
+ubyte2 BMS_getDCL(BatteryManagementSystem* me)
 {
+    BMS_decode(me, 4);
     //return me->DCL;
     return me->dischargeLimit;
 }
 
+ubyte2 BMS_getPackVoltage(BatteryManagementSystem* me)
+{
+    BMS_decode(me, 9);
+    return (me->packVoltage < 0) ? 0 : (ubyte2)me->packVoltage;
+}
+
+/*****************************************************************************
+* Staleness
+******************************************************************************
+* Each message can be given a timeout (normally the timeBetweenMessages_Max
+* that CanManager_new lists for it).  BMS_isStale is TRUE while any monitored
+* message is overdue.
+****************************************************************************/
+void BMS_setMessageTimeout(BatteryManagementSystem* me, ubyte2 messageID, ubyte4 timeout_us)
+{
+    ubyte2 messageIndex = messageID - me->canMessageBaseId;
+    if (messageIndex >= BMS_MESSAGE_COUNT) { return; }
+    me->timeout_us[messageIndex] = timeout_us;
+}
+
+bool BMS_isStale(BatteryManagementSystem* me)
+{
+    ubyte4 now = IO_RTC_GetTimeUS(me->timebase);
+    for (ubyte1 i = 0; i < BMS_MESSAGE_COUNT; i++)
+    {
+        if (me->timeout_us[i] != 0 && now - me->timestamp_received[i] > me->timeout_us[i]) { return TRUE; }
+    }
+    return FALSE;
+}
+
 
 // ELITHION BMS OPTIONS //
 
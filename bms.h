@@ -39,8 +39,14 @@ ubyte2 BMS_getPackTemp(BatteryManagementSystem* me);
 sbyte1 BMS_getAvgTemp(BatteryManagementSystem* me);
 sbyte1 BMS_getMaxTemp(BatteryManagementSystem* me);
 
-ubyte1 BMS_getCCL(BatteryManagementSystem* me);
-ubyte1 BMS_getDCL(BatteryManagementSystem* me);
+//Current limits (A) from 0x624, and pack voltage (100 mV, 0 until 0x629 arrives)
+ubyte2 BMS_getCCL(BatteryManagementSystem* me);
+ubyte2 BMS_getDCL(BatteryManagementSystem* me);
+ubyte2 BMS_getPackVoltage(BatteryManagementSystem* me);
+
+//Staleness monitoring.  timeout_us = 0 turns it off for that message (the default).
+void BMS_setMessageTimeout(BatteryManagementSystem* me, ubyte2 messageID, ubyte4 timeout_us);
+bool BMS_isStale(BatteryManagementSystem* me);  //TRUE if any monitored message is overdue
 
 typedef enum
 {
@@ -1,14 +1,25 @@
-#include <stdlib.h>  //Needed for malloc
 #include <math.h>
 #include "IO_RTC.h"
 
 #include "brakePressureSensor.h"
+#include "arena.h"
 #include "mathFunctions.h"
+#include "fixedPoint.h"
+#include "eepromManager.h"
 
 #include "sensors.h"
 //extern Sensor Sensor_BPS0;
 //extern Sensor Sensor_BenchTPS1;
 
+//A stored calibration narrower than this (in mV) is assumed to be from a botched sweep
+#define BPS_MIN_CALIBRATION_SPAN 100
+
+//Precompute the reciprocal so update() doesn't have to divide
+static void BrakePressureSensor_setSpans(BrakePressureSensor* me)
+{
+    FixedPoint_setSpan(&me->bps0_span, me->bps0_calibMin, me->bps0_calibMax);
+}
+
 /*****************************************************************************
 * Torque Encoder (TPS) functions
 * RULE EV2.3.5:
@@ -17,7 +28,7 @@
 ****************************************************************************/
 BrakePressureSensor* BrakePressureSensor_new(void)
 {
-    BrakePressureSensor* me = (BrakePressureSensor*)malloc(sizeof(struct _BrakePressureSensor));
+    BrakePressureSensor* me = (BrakePressureSensor*)Arena_allocate(ARENA_INTERNAL, sizeof(struct _BrakePressureSensor));
     //me->bench = benchMode;
 
     //TODO: Make sure the main loop is running before doing this
@@ -59,31 +70,31 @@ void BrakePressureSensor_update(BrakePressureSensor* me, bool bench)
 	}
 	else
 	{
-		me->bps0_percent = getPercent(me->bps0_value, me->bps0_calibMin, me->bps0_calibMax, TRUE);
+		me->bps0_percent = FixedPoint_percent(&me->bps0_span, me->bps0_value);
 		me->percent = me->bps0_percent;
 	}
 
-	if (me->percent <= 0)
+	if (me->percent == 0)
 	{
-		Light_set(Light_brake, 0);
+		Light_setDuty(Light_brake, 0);
 	}
 	else if (bench == FALSE)
 	{
-		Light_set(Light_brake, 1);
+		Light_setDuty(Light_brake, 0xFFFF);
 	}
 	else
 	{
-		if (me->percent > 0 && me->percent < .02)
+		if (me->percent < Q15(.02))
 		{
-			Light_set(Light_brake, .20);
+			Light_setDuty(Light_brake, FixedPoint_toDuty(Q15(.20)));
 		}
-		else if (me->percent >= .02 && me->percent < .30)
+		else if (me->percent < Q15(.30))
 		{
-			Light_set(Light_brake, .30);
+			Light_setDuty(Light_brake, FixedPoint_toDuty(Q15(.30)));
 		}
-		else if (me->percent >= .30)
+		else
 		{
-			Light_set(Light_brake, me->percent);
+			Light_setDuty(Light_brake, FixedPoint_toDuty(me->percent));
 		}
 	}
 }
@@ -97,6 +108,7 @@ void BrakePressureSensor_resetCalibration(BrakePressureSensor* me)
 	//me->bps0_calibMax = me->bps0->specMin;
 	me->bps0_calibMin = 550;
 	me->bps0_calibMax = 1250;
+	BrakePressureSensor_setSpans(me);
 
     //me->bps1_rawCalibMin = me->bps1->specMax;
     //me->bps1_rawCalibMax = me->bps1->specMin;
@@ -107,14 +119,34 @@ void BrakePressureSensor_resetCalibration(BrakePressureSensor* me)
     me->calibrated = TRUE;
 }
 
-void BrakePressureSensor_saveCalibrationToEEPROM(BrakePressureSensor* me)
+void BrakePressureSensor_saveCalibrationToEEPROM(BrakePressureSensor* me, EEPROMManager* eeprom)
 {
+    EEPROMCalibration calibration;
+    EEPROMManager_getCalibration(eeprom, &calibration);  //Keep the TPS values
 
+    calibration.bps0_calibMin = me->bps0_calibMin;
+    calibration.bps0_calibMax = me->bps0_calibMax;
+    EEPROMManager_setCalibration(eeprom, &calibration);
 }
 
-void BrakePressureSensor_loadCalibrationFromEEPROM(BrakePressureSensor* me)
+bool BrakePressureSensor_loadCalibrationFromEEPROM(BrakePressureSensor* me, EEPROMManager* eeprom)
 {
+    EEPROMCalibration calibration;
+
+    if (EEPROMManager_getCalibration(eeprom, &calibration) == FALSE) { return FALSE; }
 
+    //Stored range must sit inside the datasheet limits and be wide enough to be a real sweep
+    if (calibration.bps0_calibMin < me->bps0->specMin || calibration.bps0_calibMax > me->bps0->specMax
+     || (ubyte4)calibration.bps0_calibMin + BPS_MIN_CALIBRATION_SPAN > calibration.bps0_calibMax)
+    {
+        return FALSE;
+    }
+
+    me->bps0_calibMin = calibration.bps0_calibMin;
+    me->bps0_calibMax = calibration.bps0_calibMax;
+    BrakePressureSensor_setSpans(me);
+    me->calibrated = TRUE;
+    return TRUE;
 }
 
 void BrakePressureSensor_startCalibration(BrakePressureSensor* me, ubyte1 secondsToRun)
@@ -160,11 +192,13 @@ void BrakePressureSensor_calibrationCycle(BrakePressureSensor* me, ubyte1* error
         }
         else  //Calibration shutdown
         {
-            float4 pedalTopPlay = 1.02;
-            float4 pedalBottomPlay = .95;
+            //Pedal play: top = 102%, bottom = 95% (as percent so this stays in integer math)
+            ubyte2 pedalTopPlay = 102;
+            ubyte2 pedalBottomPlay = 95;
 
-            me->bps0_calibMin *= me->bps0_reverse ? pedalBottomPlay : pedalTopPlay;
-            me->bps0_calibMax *= me->bps0_reverse ? pedalTopPlay : pedalBottomPlay;
+            me->bps0_calibMin = (ubyte4)me->bps0_calibMin * (me->bps0_reverse ? pedalBottomPlay : pedalTopPlay) / 100;
+            me->bps0_calibMax = (ubyte4)me->bps0_calibMax * (me->bps0_reverse ? pedalTopPlay : pedalBottomPlay) / 100;
+            BrakePressureSensor_setSpans(me);
             //me->bps1_calibMin *= me->bps1_reverse ? pedalBottomPlay : pedalTopPlay;
             //me->bps1_calibMax *= me->bps1_reverse ? pedalTopPlay : pedalBottomPlay;
 
@@ -181,9 +215,8 @@ void BrakePressureSensor_calibrationCycle(BrakePressureSensor* me, ubyte1* error
         //TODO: Throw warning: calibrationCycle helper function was called but calibration should not be running
     }
 
-    //TODO: Write calibration data to EEPROM
-
-    //TODO: Check for valid/reasonable calibration data
+    //Calibration data is written to EEPROM by the caller (see BrakePressureSensor_saveCalibrationToEEPROM)
+    //and checked for valid/reasonable values when it is loaded
 
     //TODO: Do something on the display to show that voltages are being recorded
 
@@ -193,7 +226,7 @@ void BrakePressureSensor_calibrationCycle(BrakePressureSensor* me, ubyte1* error
 }
 
 
-void BrakePressureSensor_getIndividualSensorPercent(BrakePressureSensor* me, ubyte1 sensorNumber, float4* percent)
+void BrakePressureSensor_getIndividualSensorPercent(BrakePressureSensor* me, ubyte1 sensorNumber, Q15* percent)
 {
 	//Sensor* bps;
 	//ubyte2 calMin;
@@ -223,12 +256,12 @@ void BrakePressureSensor_getIndividualSensorPercent(BrakePressureSensor* me, uby
 * Description: Reads TPS Pin voltages and returns % of throttle pedal travel.
 * Parameters:  None
 * Inputs:      Assumes TPS#.sensorValue has been set by main loop
-* Returns:     Throttle value in percent (from 0 to 1)
+* Returns:     Brake value in percent (Q15: 0 to FIXEDPOINT_ONE)
 * Notes:       Valid pedal travel is from 10% (0.10) to 90% (0.90), not including mechanical limits.
 * Throws:      000 - TPS0 voltage out of range
 *              001 - TPS1 voltage out of range, 002
 -------------------------------------------------------------------*/
-void BrakePressureSensor_getPedalTravel(BrakePressureSensor* me, ubyte1* errorCount, float4* pedalPercent)
+void BrakePressureSensor_getPedalTravel(BrakePressureSensor* me, ubyte1* errorCount, Q15* pedalPercent)
 {
 	*pedalPercent = me->percent;
 
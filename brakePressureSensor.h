@@ -3,6 +3,8 @@
 
 #include "IO_Driver.h"
 #include "sensors.h"
+#include "fixedPoint.h"
+#include "eepromManager.h"
 
 //After update(), access to tps Sensor objects should no longer be necessary.
 //In other words, only updateFromSensors itself should use the tps Sensor objects
@@ -18,7 +20,8 @@ typedef struct _BrakePressureSensor
 	ubyte2 bps0_calibMax;
 	bool bps0_reverse;
 	ubyte2 bps0_value;
-    float4 bps0_percent;
+    Q15 bps0_percent;
+    FixedPointSpan bps0_span;  //calibMin -> calibMax, set whenever the calibration changes
 
 	/*ubyte4 bps1_calibMin;
     ubyte4 bps1_calibMax;
@@ -32,18 +35,19 @@ typedef struct _BrakePressureSensor
     ubyte1 calibrationRunTime;
 
     bool calibrated;
-    float4 percent;
+    Q15 percent;
 	bool implausibility;
 } BrakePressureSensor;
 
 BrakePressureSensor* BrakePressureSensor_new(void);
 void BrakePressureSensor_update(BrakePressureSensor* me, bool bench);
-void BrakePressureSensor_getIndividualSensorPercent(BrakePressureSensor* me, ubyte1 sensorNumber, float4* percent);
+void BrakePressureSensor_getIndividualSensorPercent(BrakePressureSensor* me, ubyte1 sensorNumber, Q15* percent);
 void BrakePressureSensor_resetCalibration(BrakePressureSensor* me);
-void BrakePressureSensor_saveCalibrationToEEPROM(BrakePressureSensor* me);
-void BrakePressureSensor_loadCalibrationFromEEPROM(BrakePressureSensor* me);
+void BrakePressureSensor_saveCalibrationToEEPROM(BrakePressureSensor* me, EEPROMManager* eeprom);
+//Returns FALSE (and keeps the current calibration) if nothing is stored or the stored values look wrong
+bool BrakePressureSensor_loadCalibrationFromEEPROM(BrakePressureSensor* me, EEPROMManager* eeprom);
 void BrakePressureSensor_startCalibration(BrakePressureSensor* me, ubyte1 secondsToRun);
 void BrakePressureSensor_calibrationCycle(BrakePressureSensor* me, ubyte1* errorCount);
-void BrakePressureSensor_getPedalTravel(BrakePressureSensor* me, ubyte1* errorCount, float4* pedalPercent);
+void BrakePressureSensor_getPedalTravel(BrakePressureSensor* me, ubyte1* errorCount, Q15* pedalPercent);
 
 #endif //  _BRAKEPRESSURESENSOR_H
\ No newline at end of file
@@ -1,26 +1,191 @@
 
-#include <stdlib.h> //malloc
+#include <stddef.h> //NULL
+#include <string.h> //memcmp, memcpy, memset
 
 #include "IO_Driver.h" 
 #include "IO_CAN.h"
 #include "IO_RTC.h"
 
 #include "mathFunctions.h"
+#include "fixedPoint.h"
+#include "lookupTable.h"
 #include "sensors.h"
 #include "canManager.h"
-#include "avlTree.h"
+#include "arena.h"
 #include "motorController.h"
 #include "bms.h"
 #include "safety.h"
 #include "wheelSpeeds.h"
 #include "serial.h"
+#include "canSignals.h"
+#include "loopTiming.h"
 
 
-struct _CanManager {
-    //AVLNode* incomingTree;
-    //AVLNode* outgoingTree;
+//Keep track of CAN message IDs, their data, and when they were last sent/received.
+//Only IDs that are actually used get a slot, so this table stays small (see
+//CANMANAGER_MESSAGE_SLOTS) instead of holding an entry for every possible 11-bit ID.
+struct _CanMessageNode
+{
+    ubyte2 id;
+    bool required;
+    CanTxClass txClass;              //Outgoing messages only (see CanManager_send)
+    ubyte4 timeBetweenMessages_Min;  //Fastest rate at which messages will be sent
+    ubyte4 timeBetweenMessages_Max;  //Slowest rate at which messages will be sent, OR max time between receiving messages before throwing an error
+    ubyte4 lastMessage_timeStamp;    //Last time message was sent/received (CanManager timebase, see CanManager_now)
+    ubyte1 data[8];                  //Last data sent/received
+};
+
+//Number of message descriptors.  Must cover every message registered in CanManager_new, plus
+//some room for messages that are seen for the first time by CanManager_send.
+#define CANMANAGER_MESSAGE_SLOTS 32
+
+//ID -> slot index (open addressing).  Must be a power of 2 and larger than CANMANAGER_MESSAGE_SLOTS
+//so most lookups hit on the first probe.
+#define CANMANAGER_INDEX_SIZE 64
+#define CANMANAGER_INDEX_EMPTY 0xFF
+
+//Receive dispatch.  Each registered message ID gets a route, which points at up to
+//CANMANAGER_RECEIVERS_PER_ID receivers (parse function + object).  Routes are found
+//through the same kind of hash index as the message history, so dispatch cost per
+//frame does not grow with the number of registered devices.
+#define CANMANAGER_MAX_RECEIVERS 8
+#define CANMANAGER_RECEIVERS_PER_ID 3
+#define CANMANAGER_MAX_ROUTES 48
+#define CANMANAGER_NO_RECEIVER 0xFF
+
+//Inverter feedback (0xA0-0xAF) gets its own small read FIFO on CAN0, so the torque path
+//never waits behind a BMS burst and an overflow of the general FIFO can't starve it.
+//The controller hands a frame to the first message object whose filter matches, so
+//this FIFO has to be configured before the accept-all general FIFO.
+//Note: the sum of all FIFO sizes must stay below 128 (see CanManager_new).
+#define CANMANAGER_PRIORITY_FIFO_SIZE 8
+#define CANMANAGER_PRIORITY_ID        0x0A0
+#define CANMANAGER_PRIORITY_MASK      0x7F0
+
+//Max number of times the read FIFO is re-read in one CanManager_read call when it comes back full
+#define CANMANAGER_MAX_READ_PASSES 4
+
+//Transmit queue for everything below CANTX_CRITICAL.  Holds what one tick's tasks send; the
+//worst case is the slow task (all of the debug telemetry, every loop timing frame and both bus
+//stats blocks - see the size check after canTelemetry).  CanManager_transmit empties it every time.
+//Frames are kept in send order with a channel/class tag each, and written to the FIFO straight
+//from the queue.
+//Queued frames may use at most writeLimit - CANMANAGER_TX_CRITICAL_RESERVE FIFO slots
+//per release, so there is always room for the next inverter command.
+#define CANMANAGER_TX_QUEUE_SIZE      40
+#define CANMANAGER_TX_CRITICAL_RESERVE 4
+#define CANMANAGER_TX_TAG(channel, txClass) ((ubyte1)((channel) * CANTX_CLASSES + (txClass)))
+
+typedef struct _CanReceiver
+{
+    CanMessageParser parse;
+    void* object;
+} CanReceiver;
+
+typedef struct _CanRoute
+{
+    ubyte2 id;
+    ubyte1 receiver[CANMANAGER_RECEIVERS_PER_ID];
+
+    //Coalescing: position of the newest copy of this ID in the current read batch
+    ubyte2 lastBatchNumber;
+    ubyte1 lastBatchPosition;
+
+    //Older copies that were thrown away because a newer one arrived in the same batch
+    ubyte2 droppedFrames;    //older copy had different data (information was lost)
+    ubyte2 duplicateFrames;  //older copy had the same data as the newer one
+
+    ubyte1 gatewaySlot;      //CAN0->CAN1 forwarding state, or CANMANAGER_NO_GATEWAY (= drop)
+
+    //Bus load stats: every received copy counts, including superseded ones
+    ubyte2 windowFrames;     //Since the current stats window started
+    ubyte2 windowBytes;
+    ubyte2 framesPerSecond;  //Rates over the last complete window (see CanManager_publishBusStats)
+    ubyte2 bytesPerSecond;
+} CanRoute;
+
+typedef struct _CanDispatchTable
+{
+    CanRoute routes[CANMANAGER_MAX_ROUTES];
+    ubyte1 routeCount;
+    ubyte1 routeIndex[CANMANAGER_INDEX_SIZE];
+
+    ubyte2 batchNumber;        //Incremented for every IO_CAN_ReadFIFO batch
+    ubyte4 supersededFrames;   //Total dropped + duplicate frames.  Grows when the main loop falls behind the bus.
+    ubyte4 unroutedFrames;     //Frames that nobody registered for
+} CanDispatchTable;
+
+//Bus load / FIFO counters for one channel, over the current stats window (~1 s).
+//Bits are estimated from the frame length with worst case bit stuffing, so the
+//load figure errs on the high side.
+typedef struct _CanBusStats
+{
+    ubyte4 rxFrames;
+    ubyte4 txFrames;
+    ubyte4 bits;               //rx + tx, on the wire
+    ubyte1 rxFifoHighWater;    //Most frames returned by a single IO_CAN_ReadFIFO
+    ubyte1 readBatchMax;       //Most frames handled by a single CanManager_read (all passes)
+    ubyte2 overflowEvents;     //IO_E_CAN_OVERFLOW from reads: frames were lost before we got to them
+    ubyte2 oldDataEvents;      //IO_E_CAN_OLD_DATA from reads: nothing new since the last read
+    ubyte2 txFifoFullEvents;   //Writes refused with IO_E_CAN_FIFO_FULL
+    ubyte2 txDroppedFrames;    //Frames not written (refused batches + gateway overflow)
+    ubyte2 txClassDrops[CANTX_CLASSES];  //Frames CanManager_send/transmit could not get out, by class
+} CanBusStats;
+
+#define CANMANAGER_STATS_PERIOD_US 1000000
+#define CANMANAGER_STATS_ID 0x50F
+#define CANMANAGER_STATS_FRAME_COUNT 8  //4 per channel (see CanManager_publishBusStats)
+
+//----------------------------------------------------------------------------
+// CAN0 -> CAN1 (DAQ) gateway
+//----------------------------------------------------------------------------
+// Messages received on CAN0 are forwarded to CAN1 according to the policy below.
+// IDs that are not listed are not forwarded.
+//   GATEWAY_ALWAYS    - forward every frame (including older copies in a batch)
+//   GATEWAY_RATE      - forward at most rateHz times per second
+//   GATEWAY_ON_CHANGE - forward when the data changes, and at least rateHz times
+//                       per second if rateHz > 0
+//----------------------------------------------------------------------------
+typedef enum { GATEWAY_DROP, GATEWAY_ALWAYS, GATEWAY_RATE, GATEWAY_ON_CHANGE } GatewayPolicy;
+
+typedef struct _CanGatewayRule
+{
+    ubyte2 firstMessageID;
+    ubyte2 lastMessageID;
+    GatewayPolicy policy;
+    ubyte2 rateHz;
+} CanGatewayRule;
+
+static const CanGatewayRule canGatewayRules[] =
+{
+    //  first   last   policy             rateHz
+      { 0x0A0, 0x0A4, GATEWAY_RATE,        5 }  //MCM temperatures, analog/digital inputs
+    , { 0x0A5, 0x0A7, GATEWAY_RATE,       50 }  //MCM motor speed, currents, DC bus voltage
+    , { 0x0A8, 0x0A9, GATEWAY_RATE,        5 }  //MCM flux, reference voltages
+    , { 0x0AA, 0x0AB, GATEWAY_ON_CHANGE,   2 }  //MCM internal states, faults
+    , { 0x0AC, 0x0AF, GATEWAY_RATE,       50 }  //MCM torque, etc
+    , { 0x620, 0x629, GATEWAY_RATE,       10 }  //BMS
+    //VCU debug control (0x5FF) is received on CAN1 now, so there is nothing to forward
+};
+
+#define CANMANAGER_MAX_GATEWAY_IDS 32
+#define CANMANAGER_NO_GATEWAY 0xFF
+
+//Most frames forwarded by one CanManager_read / CanManager_readPriority call.  The rate limited
+//rules forward at most one copy of an ID per call, so this covers a copy of every inverter ID
+//(0xA0-0xAF); anything past it is counted in gatewayOverflows.
+#define CANMANAGER_GATEWAY_BATCH_SIZE 16
 
+typedef struct _CanGatewayState
+{
+    GatewayPolicy policy;
+    ubyte4 periodus;                 //0 = no time-based forwarding
+    ubyte4 timestamp_lastForward;
+    ubyte1 length;
+    ubyte1 data[8];                  //Last forwarded data (GATEWAY_ON_CHANGE)
+} CanGatewayState;
 
+struct _CanManager {
     SerialManager* sm;
 
     ubyte1 canMessageLimit;
@@ -29,13 +194,14 @@ struct _CanManager {
     //Functions shall have a CanChannel enum (see header) parameter.  Direction (send/receive is not
     //specified by this parameter.  The CAN0/CAN1 is selected based on the parameter passed in, and 
     //Read/Write is selected based on the function that is being called (get/send)
-    ubyte1 can0_busSpeed;
+    ubyte2 can0_busSpeed;  //kbit/s
+    ubyte1 can0_priorityReadHandle;  //Inverter feedback only - see CANMANAGER_PRIORITY_ID
     ubyte1 can0_readHandle;
     ubyte1 can0_read_messageLimit;
     ubyte1 can0_writeHandle;
     ubyte1 can0_write_messageLimit;
 
-    ubyte1 can1_busSpeed;
+    ubyte2 can1_busSpeed;
     ubyte1 can1_readHandle;
     ubyte1 can1_read_messageLimit;
     ubyte1 can1_writeHandle;
@@ -44,11 +210,13 @@ struct _CanManager {
     IO_ErrorType ioErr_can0_Init;
     IO_ErrorType ioErr_can1_Init;
 
+    IO_ErrorType ioErr_can0_fifoInit_priority;
     IO_ErrorType ioErr_can0_fifoInit_R;
     IO_ErrorType ioErr_can0_fifoInit_W;
     IO_ErrorType ioErr_can1_fifoInit_R;
     IO_ErrorType ioErr_can1_fifoInit_W;
 
+    IO_ErrorType ioErr_can0_priorityRead;
     IO_ErrorType ioErr_can0_read;
     IO_ErrorType ioErr_can0_write;
     IO_ErrorType ioErr_can1_read;
@@ -56,46 +224,259 @@ struct _CanManager {
 
     ubyte4 sendDelayus;
 
-
-    //WARNING: These values are not initialized - be careful to only access
-    //pointers that have been previously assigned
-    //AVLNode* canMessageHistory[0x7FF];
-    AVLNode* canMessageHistory[0x7FF];
+    //All CanManager timestamps are microseconds since this IO_RTC timestamp, so a whole
+    //batch of messages can share one clock read.  Differences stay correct across the
+    //~71 minute wrap because they are taken modulo 2^32.
+    ubyte4 timebase;
+
+    //Message history: dense descriptor table + small ID->slot index
+    CanMessageNode canMessageHistory[CANMANAGER_MESSAGE_SLOTS];
+    ubyte1 canMessageHistoryCount;
+    ubyte1 canMessageIndex[CANMANAGER_INDEX_SIZE];
+
+    //Receive dispatch (one table per channel, receivers shared)
+    CanReceiver receivers[CANMANAGER_MAX_RECEIVERS];
+    ubyte1 receiverCount;
+    CanDispatchTable can0_dispatch;
+    CanDispatchTable can1_dispatch;
+
+    //CAN0 -> CAN1 gateway
+    CanGatewayState gateway[CANMANAGER_MAX_GATEWAY_IDS];
+    ubyte1 gatewayCount;
+    ubyte4 gatewayOverflows;  //Frames that should have been forwarded but didn't fit in one write
+
+    //Non-critical frames waiting for CanManager_transmit
+    IO_CAN_DATA_FRAME txQueue[CANMANAGER_TX_QUEUE_SIZE];
+    ubyte1 txQueueTag[CANMANAGER_TX_QUEUE_SIZE];  //CANMANAGER_TX_TAG
+    ubyte1 txQueueCount;
+
+    //Bus load / FIFO monitor
+    CanBusStats can0_stats;
+    CanBusStats can1_stats;
+    ubyte4 timestamp_statsWindow;
 };
 
-//Keep track of CAN message IDs, their data, and when they were last sent.
-/*
-struct _CanMessageNode
+/*-------------------------------------------------------------------
+* Message history helpers
+* The index is a small hash table of slot numbers.  Lookups normally take
+* one probe; the worst case is bounded by CANMANAGER_INDEX_SIZE.
+-------------------------------------------------------------------*/
+static ubyte4 CanManager_now(CanManager* me)
 {
-	IO_CAN_DATA_FRAME canMessage;
-	ubyte4 timeBetweenMessages_Min;
-	ubyte4 timeBetweenMessages_Max;
-	ubyte1 lastMessage_data[8];
-	ubyte4 lastMessage_timeStamp;
-	canHistoryNode* left;
-	canHistoryNode* right;
-};
-*/
+    return IO_RTC_GetTimeUS(me->timebase);
+}
+
+static ubyte1 CanManager_hashID(ubyte2 messageID)
+{
+    return (messageID ^ (messageID >> 6)) & (CANMANAGER_INDEX_SIZE - 1);
+}
+
+static CanMessageNode* CanManager_findMessage(CanManager* me, ubyte2 messageID)
+{
+    ubyte1 bucket = CanManager_hashID(messageID);
+    for (ubyte1 probes = 0; probes < CANMANAGER_INDEX_SIZE; probes++)
+    {
+        ubyte1 slot = me->canMessageIndex[bucket];
+        if (slot == CANMANAGER_INDEX_EMPTY) { return NULL; }
+        if (me->canMessageHistory[slot].id == messageID) { return &me->canMessageHistory[slot]; }
+        bucket = (bucket + 1) & (CANMANAGER_INDEX_SIZE - 1);
+    }
+    return NULL;
+}
+
+//Returns NULL if the descriptor table is full
+static CanMessageNode* CanManager_addMessage(CanManager* me, ubyte2 messageID, ubyte4 timeBetweenMessages_Min, ubyte4 timeBetweenMessages_Max, bool required, CanTxClass txClass)
+{
+    CanMessageNode* message = CanManager_findMessage(me, messageID);
+    if (message == NULL)
+    {
+        if (me->canMessageHistoryCount >= CANMANAGER_MESSAGE_SLOTS) { return NULL; }
+
+        ubyte1 bucket = CanManager_hashID(messageID);
+        while (me->canMessageIndex[bucket] != CANMANAGER_INDEX_EMPTY)
+        {
+            bucket = (bucket + 1) & (CANMANAGER_INDEX_SIZE - 1);
+        }
+        me->canMessageIndex[bucket] = me->canMessageHistoryCount;
+        message = &me->canMessageHistory[me->canMessageHistoryCount++];
+        message->id = messageID;
+    }
+
+    message->timeBetweenMessages_Min = timeBetweenMessages_Min;
+    message->timeBetweenMessages_Max = timeBetweenMessages_Max;
+    message->required = required;
+    message->txClass = txClass;
+    memset(message->data, 0, sizeof(message->data));
+    message->lastMessage_timeStamp = CanManager_now(me);
+    return message;
+}
+
+//TRUE if canMessage's data differs from what was last sent/received for that ID
+static bool CanManager_dataChanged(const CanMessageNode* lastMessage, const IO_CAN_DATA_FRAME* canMessage)
+{
+    return memcmp(lastMessage->data, canMessage->data, sizeof(lastMessage->data)) != 0;
+}
+
+/*-------------------------------------------------------------------
+* Receive dispatch helpers
+-------------------------------------------------------------------*/
+static void CanManager_clearDispatchTable(CanDispatchTable* table)
+{
+    table->routeCount = 0;
+    table->batchNumber = 0;
+    table->supersededFrames = 0;
+    table->unroutedFrames = 0;
+    for (ubyte1 bucket = 0; bucket < CANMANAGER_INDEX_SIZE; bucket++)
+    {
+        table->routeIndex[bucket] = CANMANAGER_INDEX_EMPTY;
+    }
+}
+
+static CanRoute* CanManager_findRoute(CanDispatchTable* table, ubyte2 messageID)
+{
+    ubyte1 bucket = CanManager_hashID(messageID);
+    for (ubyte1 probes = 0; probes < CANMANAGER_INDEX_SIZE; probes++)
+    {
+        ubyte1 slot = table->routeIndex[bucket];
+        if (slot == CANMANAGER_INDEX_EMPTY) { return NULL; }
+        if (table->routes[slot].id == messageID) { return &table->routes[slot]; }
+        bucket = (bucket + 1) & (CANMANAGER_INDEX_SIZE - 1);
+    }
+    return NULL;
+}
+
+//Returns NULL if the dispatch table is full
+static CanRoute* CanManager_addRoute(CanDispatchTable* table, ubyte2 messageID)
+{
+    CanRoute* route = CanManager_findRoute(table, messageID);
+    if (route == NULL)
+    {
+        if (table->routeCount >= CANMANAGER_MAX_ROUTES) { return NULL; }
+
+        ubyte1 bucket = CanManager_hashID(messageID);
+        while (table->routeIndex[bucket] != CANMANAGER_INDEX_EMPTY)
+        {
+            bucket = (bucket + 1) & (CANMANAGER_INDEX_SIZE - 1);
+        }
+        table->routeIndex[bucket] = table->routeCount;
+        route = &table->routes[table->routeCount++];
+        route->id = messageID;
+        for (ubyte1 i = 0; i < CANMANAGER_RECEIVERS_PER_ID; i++) { route->receiver[i] = CANMANAGER_NO_RECEIVER; }
+        route->lastBatchNumber = 0xFFFF;
+        route->lastBatchPosition = 0;
+        route->droppedFrames = 0;
+        route->duplicateFrames = 0;
+        route->gatewaySlot = CANMANAGER_NO_GATEWAY;
+        route->windowFrames = 0;
+        route->windowBytes = 0;
+        route->framesPerSecond = 0;
+        route->bytesPerSecond = 0;
+    }
+    return route;
+}
+
+/*-------------------------------------------------------------------
+* Bus load helpers
+-------------------------------------------------------------------*/
+static void CanManager_clearBusStats(CanBusStats* stats)
+{
+    stats->rxFrames = 0;
+    stats->txFrames = 0;
+    stats->bits = 0;
+    stats->rxFifoHighWater = 0;
+    stats->readBatchMax = 0;
+    stats->overflowEvents = 0;
+    stats->oldDataEvents = 0;
+    stats->txFifoFullEvents = 0;
+    stats->txDroppedFrames = 0;
+    for (ubyte1 txClass = 0; txClass < CANTX_CLASSES; txClass++) { stats->txClassDrops[txClass] = 0; }
+}
+
+static void CanManager_saturatingIncrement(ubyte2* counter, ubyte2 amount)
+{
+    *counter = (*counter > 0xFFFF - amount) ? 0xFFFF : *counter + amount;
+}
+
+//Standard (11 bit ID) frame with worst case stuffing: 8n + 47 + (34 + 8n - 1) / 4
+static ubyte1 CanManager_frameBits(ubyte1 length)
+{
+    if (length > 8) { length = 8; }
+    return 8 * length + 47 + (34 + 8 * length - 1) / 4;
+}
+
+//Counts the result of one IO_CAN_WriteFIFO call
+static void CanManager_countWrite(CanBusStats* stats, const IO_CAN_DATA_FRAME canMessages[], ubyte1 canMessageCount, IO_ErrorType writeResult)
+{
+    if (writeResult != IO_E_OK)
+    {
+        if (writeResult == IO_E_CAN_FIFO_FULL) { CanManager_saturatingIncrement(&stats->txFifoFullEvents, 1); }
+        CanManager_saturatingIncrement(&stats->txDroppedFrames, canMessageCount);
+        return;
+    }
+    stats->txFrames += canMessageCount;
+    for (ubyte1 i = 0; i < canMessageCount; i++) { stats->bits += CanManager_frameBits(canMessages[i].length); }
+}
 
 CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit, ubyte1 can0_write_messageLimit
                          , ubyte2 can1_busSpeed, ubyte1 can1_read_messageLimit, ubyte1 can1_write_messageLimit
                          , ubyte4 defaultSendDelayus, SerialManager* serialMan) //ubyte4 defaultMinSendDelay, ubyte4 defaultMaxSendDelay)
 {
-	CanManager* me = (CanManager*)malloc(sizeof(struct _CanManager));
+	CanManager* me = (CanManager*)Arena_allocate(ARENA_INTERNAL, sizeof(struct _CanManager));
 
     me->sm = serialMan;
     SerialManager_send(me->sm, "CanManager's reference to SerialManager was created.\n");
 	
-    //create can history data structure (AVL tree?)
-	//me->incomingTree = NULL;
-    //me->outgoingTree = NULL;
-    for (ubyte4 id = 0; id <= 0x7FF; id++)
+    IO_RTC_StartTime(&me->timebase);
+
+    CanManager_clearBusStats(&me->can0_stats);
+    CanManager_clearBusStats(&me->can1_stats);
+    me->timestamp_statsWindow = 0;
+    me->txQueueCount = 0;
+
+    //Empty message history
+    me->canMessageHistoryCount = 0;
+    for (ubyte1 bucket = 0; bucket < CANMANAGER_INDEX_SIZE; bucket++)
+    {
+        me->canMessageIndex[bucket] = CANMANAGER_INDEX_EMPTY;
+    }
+
+    //Nothing is registered to receive messages until the subsystem objects are created
+    me->receiverCount = 0;
+    CanManager_clearDispatchTable(&me->can0_dispatch);
+    CanManager_clearDispatchTable(&me->can1_dispatch);
+
+    //Set up the CAN0 -> CAN1 gateway from the policy table
+    me->gatewayCount = 0;
+    me->gatewayOverflows = 0;
+    for (ubyte1 rule = 0; rule < sizeof(canGatewayRules) / sizeof(canGatewayRules[0]); rule++)
     {
-        me->canMessageHistory[id] = 0;
+        for (ubyte2 messageID = canGatewayRules[rule].firstMessageID; messageID <= canGatewayRules[rule].lastMessageID; messageID++)
+        {
+            CanRoute* route = CanManager_addRoute(&me->can0_dispatch, messageID);
+            if (route == NULL || me->gatewayCount >= CANMANAGER_MAX_GATEWAY_IDS)
+            {
+                SerialManager_log(me->sm, SERIAL_ERROR, "ERROR: CanManager gateway table is full.\n");
+                break;
+            }
+            CanGatewayState* gateway = &me->gateway[me->gatewayCount];
+            gateway->policy = canGatewayRules[rule].policy;
+            gateway->periodus = (canGatewayRules[rule].rateHz == 0) ? 0 : 1000000 / canGatewayRules[rule].rateHz;
+            gateway->timestamp_lastForward = 0 - gateway->periodus;  //First frame is forwarded right away
+            gateway->length = 0;
+            for (ubyte1 i = 0; i < 8; i++) { gateway->data[i] = 0; }
+            route->gatewaySlot = me->gatewayCount++;
+        }
     }
 
     me->sendDelayus = defaultSendDelayus;
 
+    me->can0_busSpeed = can0_busSpeed;
+    me->can0_read_messageLimit = can0_read_messageLimit;
+    me->can0_write_messageLimit = can0_write_messageLimit;
+    me->can1_busSpeed = can1_busSpeed;
+    me->can1_read_messageLimit = can1_read_messageLimit;
+    me->can1_write_messageLimit = can1_write_messageLimit;
+
     //Activate the CAN channels --------------------------------------------------
     me->ioErr_can0_Init = IO_CAN_Init(IO_CAN_CHANNEL_0, can0_busSpeed, 0, 0, 0);
     me->ioErr_can1_Init = IO_CAN_Init(IO_CAN_CHANNEL_1, can1_busSpeed, 0, 0, 0);
@@ -107,12 +488,19 @@ CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit,
     //, the direction of the queue (in/out)
     //, the frame size
     //, and other stuff?
-    IO_CAN_ConfigFIFO(&me->can0_readHandle, IO_CAN_CHANNEL_0, can0_read_messageLimit, IO_CAN_MSG_READ, IO_CAN_STD_FRAME, 0, 0);
-    IO_CAN_ConfigFIFO(&me->can0_writeHandle, IO_CAN_CHANNEL_0, can0_write_messageLimit, IO_CAN_MSG_WRITE, IO_CAN_STD_FRAME, 0, 0);
-    IO_CAN_ConfigFIFO(&me->can1_readHandle, IO_CAN_CHANNEL_1, can1_read_messageLimit, IO_CAN_MSG_READ, IO_CAN_STD_FRAME, 0, 0);
-    IO_CAN_ConfigFIFO(&me->can1_writeHandle, IO_CAN_CHANNEL_1, can1_write_messageLimit, IO_CAN_MSG_WRITE, IO_CAN_STD_FRAME, 0, 0);
+    //The filtered priority FIFO goes first (see CANMANAGER_PRIORITY_ID)
+    me->ioErr_can0_fifoInit_priority = IO_CAN_ConfigFIFO(&me->can0_priorityReadHandle, IO_CAN_CHANNEL_0, CANMANAGER_PRIORITY_FIFO_SIZE, IO_CAN_MSG_READ, IO_CAN_STD_FRAME, CANMANAGER_PRIORITY_ID, CANMANAGER_PRIORITY_MASK);
+    me->ioErr_can0_fifoInit_R = IO_CAN_ConfigFIFO(&me->can0_readHandle, IO_CAN_CHANNEL_0, can0_read_messageLimit, IO_CAN_MSG_READ, IO_CAN_STD_FRAME, 0, 0);
+    me->ioErr_can0_fifoInit_W = IO_CAN_ConfigFIFO(&me->can0_writeHandle, IO_CAN_CHANNEL_0, can0_write_messageLimit, IO_CAN_MSG_WRITE, IO_CAN_STD_FRAME, 0, 0);
+    me->ioErr_can1_fifoInit_R = IO_CAN_ConfigFIFO(&me->can1_readHandle, IO_CAN_CHANNEL_1, can1_read_messageLimit, IO_CAN_MSG_READ, IO_CAN_STD_FRAME, 0, 0);
+    me->ioErr_can1_fifoInit_W = IO_CAN_ConfigFIFO(&me->can1_writeHandle, IO_CAN_CHANNEL_1, can1_write_messageLimit, IO_CAN_MSG_WRITE, IO_CAN_STD_FRAME, 0, 0);
+    if (me->ioErr_can0_fifoInit_priority != IO_E_OK)
+    {
+        SerialManager_log(me->sm, SERIAL_ERROR, "ERROR: CanManager could not configure the inverter FIFO.\n");
+    }
 
     //Assume read/write at error state until used
+    me->ioErr_can0_priorityRead = IO_E_CAN_BUS_OFF;
     me->ioErr_can0_read = IO_E_CAN_BUS_OFF;
     me->ioErr_can0_write = IO_E_CAN_BUS_OFF;
     me->ioErr_can1_read = IO_E_CAN_BUS_OFF;
@@ -121,193 +509,232 @@ CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit,
     //-------------------------------------------------------------------
     //Define default messages
     //-------------------------------------------------------------------
-    //AVLNode* insertedMessage;
-    //insertedMessage = AVL_insert(me->canMessageHistory, 0x0C0, 0, 50000, 125000, TRUE); //MCM command message
-    
     ubyte2 messageID;
     //Outgoing ----------------------------
-    messageID = 0xC0;  //MCM Command Message
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 25000;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 125000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
+    CanManager_addMessage(me, 0xC0, 5000, 125000, TRUE, CANTX_CRITICAL);  //MCM Command Message (min = fast task period)
 
     for (messageID = 0x500; messageID <= 0x515; messageID++)
     {
-        me->canMessageHistory[messageID]->timeBetweenMessages_Min = 50000;
-        me->canMessageHistory[messageID]->timeBetweenMessages_Max = 250000;
-        me->canMessageHistory[messageID]->required = TRUE;
-        for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-        IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
+        CanManager_addMessage(me, messageID, 50000, 250000, TRUE, CANTX_TELEMETRY);
     }
+    CanManager_addMessage(me, 0x506, 50000, 250000, TRUE, CANTX_POWERTRAIN);  //Safety faults/warnings
+    CanManager_addMessage(me, 0x509, 50000, 250000, TRUE, CANTX_POWERTRAIN);  //HVIL / RTD status
+    CanManager_addMessage(me, 0x520, 100000, 1000000, TRUE, CANTX_TELEMETRY);  //MCM startup stage timing
 
     //Incoming ----------------------------
-    messageID = 0xAA;  //MCM ______
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 0;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 500000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
-
-    messageID = 0xAB;  //MCM ________
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 0;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 500000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
-
-    messageID = 0x623;  //BMS faults
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 0;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 5000000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
-
-    messageID = 0x629;  //BMS details
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 0;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 1000000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
+    CanManager_addMessage(me, 0xAA, 0, 500000, TRUE, CANTX_TELEMETRY);  //MCM ______
+    CanManager_addMessage(me, 0xAB, 0, 500000, TRUE, CANTX_TELEMETRY);  //MCM ________
+    CanManager_addMessage(me, 0x623, 0, 5000000, TRUE, CANTX_TELEMETRY);  //BMS faults
+    CanManager_addMessage(me, 0x629, 0, 1000000, TRUE, CANTX_TELEMETRY);  //BMS details
 
 	return me;
 }
 
 
+//Copies history for frames that went out
+static void CanManager_recordSent(CanMessageNode* lastMessage, const IO_CAN_DATA_FRAME* canMessage, ubyte4 now)
+{
+    if (lastMessage == NULL) { return; }
+
+    lastMessage->lastMessage_timeStamp = now;
+    memcpy(lastMessage->data, canMessage->data, sizeof(lastMessage->data));
+}
+
 /*****************************************************************************
 * This function takes an array of messages, determines which messages to send
 * based on whether or not data has changed since the last time it was sent,
 * or if a certain amount of time has passed since the last time it was sent.
 *
-* Messages that need to be sent are copied to another array and passed to the
-* FIFO queue.
+* CANTX_CRITICAL messages that need to be sent are passed to the FIFO queue
+* right away (at most CANMANAGER_TX_CRITICAL_RESERVE per call - the FIFO space
+* CanManager_transmit leaves free for them).  The rest go into the transmit
+* queue for CanManager_transmit.
 *
 * Note: http://stackoverflow.com/questions/5573310/difference-between-passing-array-and-array-pointer-into-function-in-c
 * http://stackoverflow.com/questions/2360794/how-to-pass-an-array-of-struct-using-pointer-in-c-c
 ****************************************************************************/
 IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRAME canMessages[], ubyte1 canMessageCount)
 {
-    //SerialManager_send(me->sm, "Do you even send?\n");
-    bool sendSerialDebug = FALSE;
-    ubyte2 serialMessageID = 0xC0;
-    bool sendMessage = FALSE;
     ubyte1 messagesToSendCount = 0;
-    IO_CAN_DATA_FRAME messagesToSend[canMessageCount];//[channel == CAN0_HIPRI ? me->can0_write_messageLimit : me->can1_write_messageLimit];
+    CanMessageNode* sentMessages[CANMANAGER_TX_CRITICAL_RESERVE];  //History entries of the messages being sent (may be NULL)
+    CanBusStats* stats = (channel == CAN0_HIPRI) ? &me->can0_stats : &me->can1_stats;
+    IO_ErrorType sendResult = IO_E_OK;
+
+    //One clock read for the whole batch
+    ubyte4 now = CanManager_now(me);
 
     //----------------------------------------------------------------------------
-    // Check if message exists in outgoing message history tree
+    // Decide which messages need to go out.  Critical messages that are sent are
+    // moved down to the front of canMessages[] (in place) so they can be handed
+    // to the FIFO directly.  Everything else is copied to the transmit queue.
     //----------------------------------------------------------------------------
-    AVLNode* lastMessage;  //replace with me->canMessageHistory[ID]
-    ubyte1 messagePosition; //used twice
-    for (messagePosition = 0; messagePosition < canMessageCount; messagePosition++)
+    for (ubyte1 messagePosition = 0; messagePosition < canMessageCount; messagePosition++)
     {
-        bool firstTimeMessage = FALSE;
-        bool dataChanged = FALSE;
-        bool minTimeExceeded = FALSE;
-        bool maxTimeExceeded = FALSE;
-
-        ubyte2 outboundMessageID = canMessages[messagePosition].id;
-        lastMessage = me->canMessageHistory[outboundMessageID];
-        sendMessage = FALSE;
+        IO_CAN_DATA_FRAME* canMessage = &canMessages[messagePosition];
+        bool sendMessage;
 
-        //----------------------------------------------------------------------------
-        // Check if this message exists in the array
-        //----------------------------------------------------------------------------
-        firstTimeMessage = (me->canMessageHistory[outboundMessageID] == 0);  //############################## ALWAYS FALSE? ##############################
-        if (firstTimeMessage)
+        CanMessageNode* lastMessage = CanManager_findMessage(me, canMessage->id);
+        if (lastMessage == NULL)
         {
-            me->canMessageHistory[outboundMessageID]->timeBetweenMessages_Min = 25000;
-            me->canMessageHistory[outboundMessageID]->timeBetweenMessages_Max = 125000;
-            me->canMessageHistory[outboundMessageID]->required = TRUE;
-            for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[outboundMessageID]->data[i] = 0; }
-            //IO_RTC_StartTime(&me->canMessageHistory[outboundMessageID]->lastMessage_timeStamp);
-            me->canMessageHistory[outboundMessageID]->lastMessage_timeStamp = 0;
+            //First time: start tracking this message.  If the table is full, lastMessage stays NULL
+            //and the message is sent every time (no history to compare against).
+            lastMessage = CanManager_addMessage(me, canMessage->id, 25000, 125000, TRUE, CANTX_TELEMETRY);
+            sendMessage = TRUE;
         }
-
-        //----------------------------------------------------------------------------
-        // Check if data has changed since last time message was sent
-        //----------------------------------------------------------------------------
-        //Check each data byte in the data array
-        for (ubyte1 dataPosition = 0; dataPosition < 8; dataPosition++)
+        else
         {
-            ubyte1 oldData = lastMessage->data[dataPosition];
-            ubyte1 newData = canMessages[messagePosition].data[dataPosition];
-            //if any data byte is changed, then probably want to send the message
-            if (oldData == newData)
+            ubyte4 timeSinceLastMessage = now - lastMessage->lastMessage_timeStamp;
+            if (timeSinceLastMessage >= lastMessage->timeBetweenMessages_Max)
             {
-                //data has not changed.  No action required (DO NOT SET)
-                //dataChanged = FALSE;
+                sendMessage = TRUE;
             }
             else
             {
-                dataChanged = TRUE; //ONLY MODIFY IF CHANGED
+                //Only look at the data if the message is allowed to go out early
+                sendMessage = (timeSinceLastMessage >= lastMessage->timeBetweenMessages_Min)
+                           && CanManager_dataChanged(lastMessage, canMessage);
             }
-        }//end checking each byte in message
+        }
 
-        //----------------------------------------------------------------------------
-        // Check if time has exceeded
-        //----------------------------------------------------------------------------
-        minTimeExceeded = ((IO_RTC_GetTimeUS(lastMessage->lastMessage_timeStamp) >= lastMessage->timeBetweenMessages_Min));
-        maxTimeExceeded = ((IO_RTC_GetTimeUS(lastMessage->lastMessage_timeStamp) >= 50000));//lastMessage->timeBetweenMessages_Max));
-        
-        //----------------------------------------------------------------------------
-        // If any criteria were exceeded, send the message out
-        //----------------------------------------------------------------------------
-        if (  (firstTimeMessage)
-           || (dataChanged && minTimeExceeded)
-           || (!dataChanged && maxTimeExceeded)
-           )
+        if (sendMessage == FALSE) { continue; }
+
+        CanTxClass txClass = (lastMessage == NULL) ? CANTX_TELEMETRY : lastMessage->txClass;
+        if (txClass == CANTX_CRITICAL && messagesToSendCount < CANMANAGER_TX_CRITICAL_RESERVE)
         {
-            sendMessage = TRUE;
+            if (messagesToSendCount != messagePosition)
+            {
+                canMessages[messagesToSendCount] = *canMessage;
+            }
+            sentMessages[messagesToSendCount++] = lastMessage;
         }
-
-        //----------------------------------------------------------------------------
-        // If we determined that this message should be sent
-        //----------------------------------------------------------------------------
-        if (sendMessage == TRUE)
+        else if (txClass != CANTX_CRITICAL && me->txQueueCount < CANMANAGER_TX_QUEUE_SIZE)
         {
-            //copy the message that needs to be sent into the outgoing messages array
-            //see http://stackoverflow.com/questions/1693853/copying-arrays-of-structs-in-c
-            //http://www.socialledge.com/sjsu/index.php?title=ES101_-_Lesson_9_:_Structures
-            messagesToSend[messagesToSendCount++] = canMessages[messagePosition];
+            me->txQueue[me->txQueueCount] = *canMessage;
+            me->txQueueTag[me->txQueueCount++] = CANMANAGER_TX_TAG(channel, txClass);
         }
         else
         {
-            if (sendSerialDebug && (serialMessageID == outboundMessageID)) {
-                SerialManager_send(me->sm, "This message did not need to be sent.\n");
-            }
+            CanManager_saturatingIncrement(&stats->txClassDrops[txClass], 1);
+            CanManager_saturatingIncrement(&stats->txDroppedFrames, 1);
+            sendResult = IO_E_CAN_FIFO_FULL;
         }
-    } //end of loop for each message in outgoing messages
+    }
 
     IO_UART_Task();
+
     //----------------------------------------------------------------------------
-    // If there are messages to send
+    // If there are critical messages to send
     //----------------------------------------------------------------------------
-    IO_ErrorType sendResult = IO_E_OK;
     if (messagesToSendCount > 0)
     {
         //Send the messages to send to the appropriate FIFO queue
-        sendResult = IO_CAN_WriteFIFO((channel == CAN0_HIPRI) ? me->can0_writeHandle : me->can1_writeHandle, messagesToSend, messagesToSendCount);
+        sendResult = IO_CAN_WriteFIFO((channel == CAN0_HIPRI) ? me->can0_writeHandle : me->can1_writeHandle, canMessages, messagesToSendCount);
         *((channel == CAN0_HIPRI) ? &me->ioErr_can0_write : &me->ioErr_can1_write) = sendResult;
+        CanManager_countWrite(stats, canMessages, messagesToSendCount, sendResult);
 
-        //Update the outgoing message tree with message sent timestamps
-        if ((channel == CAN0_HIPRI ? me->ioErr_can0_write : me->ioErr_can1_write) == IO_E_OK)
+        //Only update the history for messages that actually went out
+        if (sendResult == IO_E_OK)
         {
-            //Loop through the messages that we sent...
-            ///////////AVLNode* messageToUpdate;
-            for (messagePosition = 0; messagePosition < messagesToSendCount; messagePosition++)
+            for (ubyte1 messagePosition = 0; messagePosition < messagesToSendCount; messagePosition++)
             {
-                //...find the message ID in the outgoing message tree again (big inefficiency here)...
-                //////////messageToUpdate = AVL_find(me->outgoingTree, messagesToSend[messagePosition].id);
+                CanManager_recordSent(sentMessages[messagePosition], &canMessages[messagePosition], now);
+            }
+        }
+        else
+        {
+            CanManager_saturatingIncrement(&stats->txClassDrops[CANTX_CRITICAL], messagesToSendCount);
+        }
+    }
+    return sendResult;
+}
 
-                //and update the message sent timestamp
-                /////////////IO_RTC_GetTimeUS(messageToUpdate->lastMessage_timeStamp); //Update the timestamp for when the message was last sent
-                //IO_RTC_GetTimeUS(me->canMessageHistory[messagesToSend[messagePosition].id]->lastMessage_timeStamp);
-                IO_RTC_StartTime(&me->canMessageHistory[messagesToSend[messagePosition].id]->lastMessage_timeStamp);
+/*****************************************************************************
+* CanManager_transmit
+* Releases the transmit queue, one channel at a time, highest class first.
+* Each run of consecutive queued frames with the same channel and class is
+* written straight from the queue in one IO_CAN_WriteFIFO call.  The FIFO is
+* all or nothing, so if a run doesn't fit, its frames are written one by one
+* until it refuses one - lower classes only get whatever space is left.
+* Frames that don't get out are dropped and counted per class; CanManager_send
+* will pick the message again once it is due, so a stale copy is never sent late.
+****************************************************************************/
+void CanManager_transmit(CanManager* me)
+{
+    if (me->txQueueCount == 0) { return; }
+
+    ubyte4 now = CanManager_now(me);
+
+    for (ubyte1 channel = CAN0_HIPRI; channel <= CAN1_LOPRI; channel++)
+    {
+        ubyte1 writeHandle = (channel == CAN0_HIPRI) ? me->can0_writeHandle : me->can1_writeHandle;
+        ubyte1 writeLimit = (channel == CAN0_HIPRI) ? me->can0_write_messageLimit : me->can1_write_messageLimit;
+        ubyte1 budget = (writeLimit > CANMANAGER_TX_CRITICAL_RESERVE) ? writeLimit - CANMANAGER_TX_CRITICAL_RESERVE : 1;
+        CanBusStats* stats = (channel == CAN0_HIPRI) ? &me->can0_stats : &me->can1_stats;
+        IO_ErrorType* writeError = (channel == CAN0_HIPRI) ? &me->ioErr_can0_write : &me->ioErr_can1_write;
+        bool fifoRefused = FALSE;  //Once the FIFO refuses a frame, the rest of this channel is dropped
+
+        for (ubyte1 txClass = CANTX_POWERTRAIN; txClass < CANTX_CLASSES; txClass++)
+        {
+            ubyte1 tag = CANMANAGER_TX_TAG(channel, txClass);
+            ubyte1 position = 0;
+            while (position < me->txQueueCount)
+            {
+                if (me->txQueueTag[position] != tag) { position++; continue; }
+
+                //Next run of this channel's frames in this class
+                const IO_CAN_DATA_FRAME* run = &me->txQueue[position];
+                ubyte1 runLength = 0;
+                while (position < me->txQueueCount && me->txQueueTag[position] == tag) { position++; runLength++; }
+
+                ubyte1 writeCount = (fifoRefused == TRUE) ? 0 : (runLength < budget) ? runLength : budget;
+                ubyte1 sentCount = 0;
+                if (writeCount > 0)
+                {
+                    IO_ErrorType sendResult = IO_CAN_WriteFIFO(writeHandle, run, writeCount);
+                    if (sendResult == IO_E_OK)
+                    {
+                        sentCount = writeCount;
+                    }
+                    else if (sendResult == IO_E_CAN_FIFO_FULL)
+                    {
+                        while (sentCount < writeCount && IO_CAN_WriteFIFO(writeHandle, &run[sentCount], 1) == IO_E_OK) { sentCount++; }
+                    }
+                    *writeError = sendResult;
+
+                    if (sentCount > 0) { CanManager_countWrite(stats, run, sentCount, IO_E_OK); }
+                    if (sentCount < writeCount)
+                    {
+                        CanManager_countWrite(stats, &run[sentCount], writeCount - sentCount, sendResult);
+                        fifoRefused = TRUE;
+                    }
+                    budget -= sentCount;
+                    for (ubyte1 i = 0; i < sentCount; i++) { CanManager_recordSent(CanManager_findMessage(me, run[i].id), &run[i], now); }
+                }
+
+                //Over budget (or after a refusal) - never handed to the FIFO
+                CanManager_saturatingIncrement(&stats->txDroppedFrames, runLength - writeCount);
+                CanManager_saturatingIncrement(&stats->txClassDrops[txClass], runLength - sentCount);
             }
         }
     }
+
+    me->txQueueCount = 0;
+}
+
+/*****************************************************************************
+* CanManager_sendBulk
+* Writes the whole batch straight to the FIFO.  Nothing is tracked and nothing
+* is held back, so bursts (e.g. DataLogger freeze frames) are not throttled by
+* the per-ID timeBetweenMessages_Min of CanManager_send.  The caller is
+* responsible for pacing, and for retrying if the FIFO is full.
+****************************************************************************/
+IO_ErrorType CanManager_sendBulk(CanManager* me, CanChannel channel, const IO_CAN_DATA_FRAME canMessages[], ubyte1 canMessageCount)
+{
+    if (canMessageCount == 0) { return IO_E_OK; }
+
+    IO_ErrorType sendResult = IO_CAN_WriteFIFO((channel == CAN0_HIPRI) ? me->can0_writeHandle : me->can1_writeHandle, (IO_CAN_DATA_FRAME*)canMessages, canMessageCount);
+    *((channel == CAN0_HIPRI) ? &me->ioErr_can0_write : &me->ioErr_can1_write) = sendResult;
+    CanManager_countWrite((channel == CAN0_HIPRI) ? &me->can0_stats : &me->can1_stats, canMessages, canMessageCount, sendResult);
     return sendResult;
 }
 
@@ -319,79 +746,290 @@ bool CanManager_dataChangedSinceLastTransmit(IO_CAN_DATA_FRAME* canMessage) //bi
 */
 
 
+/*****************************************************************************
+* Gateway
+******************************************************************************
+* Decides whether a frame received on CAN0 should be forwarded to CAN1 (DAQ).
+* Updates the forwarding state when it returns TRUE.
+* See canGatewayRules for the per-ID policies.
+****************************************************************************/
+static bool CanManager_gatewayShouldForward(CanManager* me, CanRoute* route, IO_CAN_DATA_FRAME* canMessage, bool superseded, ubyte4 now)
+{
+    if (route == NULL || route->gatewaySlot == CANMANAGER_NO_GATEWAY) { return FALSE; }
+
+    CanGatewayState* gateway = &me->gateway[route->gatewaySlot];
+    //Only ALWAYS forwards the older copies of a message
+    if (superseded == TRUE && gateway->policy != GATEWAY_ALWAYS) { return FALSE; }
+
+    bool forward = FALSE;
+    switch (gateway->policy)
+    {
+    case GATEWAY_ALWAYS:
+        forward = TRUE;
+        break;
+
+    case GATEWAY_RATE:
+        forward = (now - gateway->timestamp_lastForward >= gateway->periodus);
+        break;
+
+    case GATEWAY_ON_CHANGE:
+        forward = (gateway->length != canMessage->length);
+        for (ubyte1 i = 0; forward == FALSE && i < canMessage->length && i < 8; i++)
+        {
+            forward = (gateway->data[i] != canMessage->data[i]);
+        }
+        if (forward == FALSE && gateway->periodus > 0)
+        {
+            forward = (now - gateway->timestamp_lastForward >= gateway->periodus);
+        }
+        if (forward == TRUE)
+        {
+            gateway->length = canMessage->length;
+            for (ubyte1 i = 0; i < 8; i++) { gateway->data[i] = canMessage->data[i]; }
+        }
+        break;
+
+    default:  //GATEWAY_DROP
+        break;
+    }
+
+    if (forward == TRUE)
+    {
+        gateway->timestamp_lastForward = now;
+    }
+    return forward;
+}
+
+
+/*****************************************************************************
+* Receive registration
+******************************************************************************
+* Each subsystem object registers the message IDs it wants, along with its parse
+* function.  Example:
+*   CanManager_registerReceiver(canMan, CAN0_HIPRI, 0xA0, 0xAF, MCM_parseCanMessage, mcm0);
+****************************************************************************/
+bool CanManager_registerReceiver(CanManager* me, CanChannel channel, ubyte2 firstMessageID, ubyte2 lastMessageID, CanMessageParser parse, void* object)
+{
+    CanDispatchTable* table = (channel == CAN0_HIPRI) ? &me->can0_dispatch : &me->can1_dispatch;
+    bool success = TRUE;
+
+    if (me->receiverCount >= CANMANAGER_MAX_RECEIVERS)
+    {
+        SerialManager_log(me->sm, SERIAL_ERROR, "ERROR: CanManager receiver table is full.\n");
+        return FALSE;
+    }
+    ubyte1 receiverNumber = me->receiverCount++;
+    me->receivers[receiverNumber].parse = parse;
+    me->receivers[receiverNumber].object = object;
+
+    for (ubyte2 messageID = firstMessageID; messageID <= lastMessageID; messageID++)
+    {
+        CanRoute* route = CanManager_addRoute(table, messageID);
+        ubyte1 i = 0;
+        if (route != NULL)
+        {
+            while (i < CANMANAGER_RECEIVERS_PER_ID && route->receiver[i] != CANMANAGER_NO_RECEIVER) { i++; }
+        }
+        if (route == NULL || i >= CANMANAGER_RECEIVERS_PER_ID)
+        {
+            success = FALSE;
+        }
+        else
+        {
+            route->receiver[i] = receiverNumber;
+        }
+    }
+
+    if (success == FALSE)
+    {
+        SerialManager_log(me->sm, SERIAL_ERROR, "ERROR: CanManager dispatch table is full.\n");
+    }
+    return success;
+}
+
+
 /*****************************************************************************
 * read
+******************************************************************************
+* Pulls messages from the read FIFO and hands each message to the objects that
+* registered for its ID.  If the FIFO comes back full, it is read again (up to
+* CANMANAGER_MAX_READ_PASSES times) so a burst of messages doesn't have to wait
+* for the next cycle.
+*
+* Devices like the MCM and BMS broadcast faster than the main loop runs, so one
+* batch often holds several copies of the same ID.  Only the newest copy of each
+* ID in a batch is parsed; the older copies are counted as dropped (different
+* data) or duplicate (same data).
+*
+* CanManager_read empties a channel's general FIFO.  CanManager_readPriority
+* empties the CAN0 inverter FIFO and should run first in the fast task.
 ****************************************************************************/
-void CanManager_read(CanManager* me, CanChannel channel, MotorController* mcm, BatteryManagementSystem* bms, SafetyChecker* sc)
+static void CanManager_readFIFO(CanManager* me, CanChannel channel, ubyte1 readHandle, ubyte1 readLimit, IO_ErrorType* ioErr_read)
 {
-    IO_CAN_DATA_FRAME canMessages[(channel == CAN0_HIPRI ? me->can0_read_messageLimit : me->can1_read_messageLimit)];
+    CanDispatchTable* table = (channel == CAN0_HIPRI) ? &me->can0_dispatch : &me->can1_dispatch;
+    CanBusStats* stats = (channel == CAN0_HIPRI) ? &me->can0_stats : &me->can1_stats;
+    IO_CAN_DATA_FRAME canMessages[readLimit];
+    CanRoute* messageRoutes[readLimit];  //NULL = nobody wants this message
+    bool superseded[readLimit];          //TRUE = a newer copy of this ID is in the same batch
     ubyte1 canMessageCount;  //FIFO queue only holds 128 messages max
+    ubyte1 readPass = 0;
+    ubyte2 batchSize = 0;
 
-	//Read messages from hipri channel 
-	*(channel == CAN0_HIPRI ? &me->ioErr_can0_read : &me->ioErr_can1_read) =
-    IO_CAN_ReadFIFO((channel == CAN0_HIPRI ? me->can0_readHandle : me->can1_writeHandle)
-                    , canMessages
-                    , (channel == CAN0_HIPRI ? me->can0_read_messageLimit : me->can1_read_messageLimit)
-                    , &canMessageCount);
-
-	//Determine message type based on ID
-	for (int currMessage = 0; currMessage < canMessageCount; currMessage++)
-	{
-		switch (canMessages[currMessage].id)
-		{
-        //-------------------------------------------------------------------------
-        //Motor controller
-        //-------------------------------------------------------------------------
-        case 0xA0:
-        case 0xA1:
-        case 0xA2:
-        case 0xA3:
-        case 0xA4:
-        case 0xA5:
-        case 0xA6:
-        case 0xA7:
-        case 0xA8:
-        case 0xA9:
-		case 0xAA:
-		case 0xAB:
-        case 0xAC:
-        case 0xAD:
-        case 0xAE:
-        case 0xAF:
-            MCM_parseCanMessage(mcm, &canMessages[currMessage]);
-            break;
-
-		//-------------------------------------------------------------------------
-		//BMS
-		//-------------------------------------------------------------------------
-		case 0x620:
-		case 0x621:
-		case 0x622:
-		case 0x623:
-		case 0x624:
-		case 0x625:
-		case 0x626:
-        case 0x627:
-        case 0x628:
-        case 0x629:
-            BMS_parseCanMessage(bms, &canMessages[currMessage]);
-			break;
-			
-		//-------------------------------------------------------------------------
-		//VCU Debug Control
-		//-------------------------------------------------------------------------
-		case 0x5FF:
-			SafetyChecker_parseCanMessage(sc, &canMessages[currMessage]);
-            MCM_parseCanMessage(mcm, &canMessages[currMessage]);
-			break;
-			//default:
-		}
-	}
-
-	//Echo message on lopri channel
-	//IO_CAN_WriteFIFO(me->can1_writeHandle, canMessages, messagesReceived);
-    CanManager_send(me, CAN1_LOPRI, canMessages, canMessageCount);
-    //IO_CAN_WriteMsg(canFifoHandle_LoPri_Write, canMessages);
+    //Frames to forward to CAN1 are collected over all passes and written once at the end
+    IO_CAN_DATA_FRAME gatewayMessages[CANMANAGER_GATEWAY_BATCH_SIZE];
+    ubyte1 gatewayMessageCount = 0;
+
+    do
+    {
+        //Read messages from the FIFO
+        IO_ErrorType readResult = IO_CAN_ReadFIFO(readHandle, canMessages, readLimit, &canMessageCount);
+        *ioErr_read = readResult;
+        table->batchNumber++;
+        ubyte4 now = CanManager_now(me);
+
+        //Bus load / FIFO stats
+        if (readResult == IO_E_CAN_OVERFLOW) { CanManager_saturatingIncrement(&stats->overflowEvents, 1); }
+        if (readResult == IO_E_CAN_OLD_DATA) { CanManager_saturatingIncrement(&stats->oldDataEvents, 1); }
+        if (canMessageCount > stats->rxFifoHighWater) { stats->rxFifoHighWater = canMessageCount; }
+        stats->rxFrames += canMessageCount;
+        batchSize += canMessageCount;
+
+        //----------------------------------------------------------------------------
+        // Coalesce: keep only the newest copy of each ID in this batch
+        //----------------------------------------------------------------------------
+        for (ubyte1 currMessage = 0; currMessage < canMessageCount; currMessage++)
+        {
+            CanRoute* route = CanManager_findRoute(table, canMessages[currMessage].id);
+            messageRoutes[currMessage] = route;
+            superseded[currMessage] = FALSE;
+            stats->bits += CanManager_frameBits(canMessages[currMessage].length);
+            if (route == NULL)
+            {
+                table->unroutedFrames++;
+                continue;
+            }
+
+            //batchNumber wraps, so an ID that hasn't been seen for 65536 batches can look like it is in
+            //this one - only trust the position if it is an earlier frame of this batch that has this route
+            if (route->lastBatchNumber == table->batchNumber
+                && route->lastBatchPosition < currMessage
+                && messageRoutes[route->lastBatchPosition] == route)
+            {
+                //An older copy is already in this batch - throw it away
+                IO_CAN_DATA_FRAME* olderMessage = &canMessages[route->lastBatchPosition];
+                bool sameData = (olderMessage->length == canMessages[currMessage].length);
+                for (ubyte1 i = 0; sameData && i < olderMessage->length && i < 8; i++)
+                {
+                    sameData = (olderMessage->data[i] == canMessages[currMessage].data[i]);
+                }
+                if (sameData) { if (route->duplicateFrames < 0xFFFF) { route->duplicateFrames++; } }
+                else          { if (route->droppedFrames < 0xFFFF)   { route->droppedFrames++; } }
+                table->supersededFrames++;
+
+                superseded[route->lastBatchPosition] = TRUE;
+            }
+            route->lastBatchNumber = table->batchNumber;
+            route->lastBatchPosition = currMessage;
+            CanManager_saturatingIncrement(&route->windowFrames, 1);
+            CanManager_saturatingIncrement(&route->windowBytes, canMessages[currMessage].length);
+        }
+
+        //----------------------------------------------------------------------------
+        // Hand each remaining message to whoever registered for its ID, and pick
+        // out the messages that should be forwarded to CAN1
+        //----------------------------------------------------------------------------
+        for (ubyte1 currMessage = 0; currMessage < canMessageCount; currMessage++)
+        {
+            CanRoute* route = messageRoutes[currMessage];
+            if (route == NULL) { continue; }
+
+            if (superseded[currMessage] == FALSE)
+            {
+                for (ubyte1 i = 0; i < CANMANAGER_RECEIVERS_PER_ID && route->receiver[i] != CANMANAGER_NO_RECEIVER; i++)
+                {
+                    CanReceiver* receiver = &me->receivers[route->receiver[i]];
+                    receiver->parse(receiver->object, &canMessages[currMessage]);
+                }
+            }
+
+            if (channel == CAN0_HIPRI
+                && CanManager_gatewayShouldForward(me, route, &canMessages[currMessage], superseded[currMessage], now))
+            {
+                if (gatewayMessageCount < CANMANAGER_GATEWAY_BATCH_SIZE)
+                {
+                    gatewayMessages[gatewayMessageCount++] = canMessages[currMessage];
+                }
+                else
+                {
+                    me->gatewayOverflows++;
+                    CanManager_saturatingIncrement(&me->can1_stats.txDroppedFrames, 1);
+                }
+            }
+        }
+
+        readPass++;
+    } while (canMessageCount >= readLimit && readPass < CANMANAGER_MAX_READ_PASSES);
+
+    if (batchSize > stats->readBatchMax) { stats->readBatchMax = (batchSize > 0xFF) ? 0xFF : batchSize; }
+
+    //Forward to lopri channel (DAQ) in one write
+    if (gatewayMessageCount > 0)
+    {
+        me->ioErr_can1_write = IO_CAN_WriteFIFO(me->can1_writeHandle, gatewayMessages, gatewayMessageCount);
+        CanManager_countWrite(&me->can1_stats, gatewayMessages, gatewayMessageCount, me->ioErr_can1_write);
+    }
+}
+
+void CanManager_read(CanManager* me, CanChannel channel)
+{
+    if (channel == CAN0_HIPRI)
+    {
+        CanManager_readFIFO(me, CAN0_HIPRI, me->can0_readHandle, me->can0_read_messageLimit, &me->ioErr_can0_read);
+    }
+    else
+    {
+        CanManager_readFIFO(me, CAN1_LOPRI, me->can1_readHandle, me->can1_read_messageLimit, &me->ioErr_can1_read);
+    }
+}
+
+void CanManager_readPriority(CanManager* me)
+{
+    CanManager_readFIFO(me, CAN0_HIPRI, me->can0_priorityReadHandle, CANMANAGER_PRIORITY_FIFO_SIZE, &me->ioErr_can0_priorityRead);
+}
+
+//Total number of received frames that were skipped because a newer copy of the same ID
+//arrived in the same batch.  A rising count means the main loop is falling behind the bus.
+ubyte4 CanManager_getSupersededCount(CanManager* me, CanChannel channel)
+{
+    return (channel == CAN0_HIPRI) ? me->can0_dispatch.supersededFrames : me->can1_dispatch.supersededFrames;
+}
+
+//Per-ID coalescing counters.  Returns FALSE if nobody registered for this ID.
+bool CanManager_getCoalescingStats(CanManager* me, CanChannel channel, ubyte2 messageID, ubyte2* droppedFrames, ubyte2* duplicateFrames)
+{
+    CanRoute* route = CanManager_findRoute((channel == CAN0_HIPRI) ? &me->can0_dispatch : &me->can1_dispatch, messageID);
+    if (route == NULL) { return FALSE; }
+    *droppedFrames = route->droppedFrames;
+    *duplicateFrames = route->duplicateFrames;
+    return TRUE;
+}
+
+//Backdate the last send by the max time: the scheduler and CanManager_send both see it as overdue
+void CanManager_requestSend(CanManager* me, ubyte2 messageID)
+{
+    CanMessageNode* message = CanManager_findMessage(me, messageID);
+    if (message != NULL)
+    {
+        message->lastMessage_timeStamp = CanManager_now(me) - message->timeBetweenMessages_Max;
+    }
+}
+
+//timeBetweenMessages_Max for a message in the history table (0 if it isn't tracked).
+//For received messages this is the longest allowed gap between frames.
+ubyte4 CanManager_getMessageTimeout(CanManager* me, ubyte2 messageID)
+{
+    CanMessageNode* message = CanManager_findMessage(me, messageID);
+    return (message == NULL) ? 0 : message->timeBetweenMessages_Max;
 }
 
 ubyte1 CanManager_getReadStatus(CanManager* me, CanChannel channel)
@@ -422,222 +1060,387 @@ void canOutput_sendSensorMessages(CanManager* me)
 //----------------------------------------------------------------------------
 // 
 //----------------------------------------------------------------------------
-void canOutput_sendDebugMessage(CanManager* me, TorqueEncoder* tps, BrakePressureSensor* bps, MotorController* mcm, WheelSpeeds* wss, SafetyChecker* sc)
-{
-    IO_CAN_DATA_FRAME canMessages[me->can0_write_messageLimit];
-    ubyte1 errorCount;
-    float4 tempPedalPercent;   //Pedal percent float (a decimal between 0 and 1
-    ubyte1 tps0Percent;  //Pedal percent int   (a number from 0 to 100)
-    ubyte1 tps1Percent;
-    ubyte2 canMessageCount = 0;
-    ubyte2 canMessageID = 0x500;
-    ubyte1 byteNum;
-
-    TorqueEncoder_getIndividualSensorPercent(tps, 0, &tempPedalPercent); //borrow the pedal percent variable
-    tps0Percent = 0xFF * tempPedalPercent;
-    TorqueEncoder_getIndividualSensorPercent(tps, 1, &tempPedalPercent);
-	tps1Percent = 0xFF * (tempPedalPercent);
+/*****************************************************************************
+* Debug / command message layouts
+******************************************************************************
+* All VCU-generated messages are little-endian.  Each message's values are
+* fetched once and packed by CanSignal_packMessage in the order listed here.
+****************************************************************************/
+//500, 501, 502: pedal percent, sensor percent, raw value, calibration min/max
+static const CanSignal canSignals_pedalSensor[] =
+    { CANSIGNAL_LE(0, 8), CANSIGNAL_LE(8, 8), CANSIGNAL_LE(16, 16), CANSIGNAL_LE(32, 16), CANSIGNAL_LE(48, 16) };
+//503: FL, FR, RL, RR wheel speeds
+static const CanSignal canSignals_wheelSpeeds[] =
+    { CANSIGNAL_LE(0, 16), CANSIGNAL_LE(16, 16), CANSIGNAL_LE(32, 16), CANSIGNAL_LE(48, 16) };
+//504, 505: raw wheel speed sensor values (2 per message)
+static const CanSignal canSignals_wheelSpeedSensors[] =
+    { CANSIGNAL_LE(0, 32), CANSIGNAL_LE(32, 32) };
+//506: faults, warnings, notices
+static const CanSignal canSignals_safety[] =
+    { CANSIGNAL_LE(0, 32), CANSIGNAL_LE(32, 16), CANSIGNAL_LE(48, 16) };
+//507: LV battery voltage (mV), SOC (%)
+static const CanSignal canSignals_lvBattery[] =
+    { CANSIGNAL_LE(0, 16), CANSIGNAL_LE_SIGNED(16, 8) };
+//508: regen mode, torque limit, torque at zero pedal, (byte 5 unused), APPS for max coasting, BPS for max regen
+static const CanSignal canSignals_regen[] =
+    { CANSIGNAL_LE(0, 8), CANSIGNAL_LE_SIGNED(8, 16), CANSIGNAL_LE_SIGNED(24, 16), CANSIGNAL_LE(48, 8), CANSIGNAL_LE(56, 8) };
+//509: HVIL term sense, HVIL override, power limiter: active limit (PowerLimitSource), torque ceiling (dNm), PI trim (10 W)
+static const CanSignal canSignals_hvil[] =
+    { CANSIGNAL_LE(0, 16), CANSIGNAL_LE(16, 8), CANSIGNAL_LE(24, 8), CANSIGNAL_LE(32, 16), CANSIGNAL_LE_SIGNED(48, 16) };
+//520: MCM startup stage, retries, ms spent in: lockout, waiting for RTD, enabling (since HV came up)
+static const CanSignal canSignals_mcmStartup[] =
+    { CANSIGNAL_LE(0, 8), CANSIGNAL_LE(8, 8), CANSIGNAL_LE(16, 16), CANSIGNAL_LE(32, 16), CANSIGNAL_LE(48, 16) };
+//C0: torque, (speed unused), direction, inverter enable, torque limit
+static const CanSignal canSignals_mcmCommand[] =
+    { CANSIGNAL_LE_SIGNED(0, 16), CANSIGNAL_LE(32, 8), CANSIGNAL_LE(40, 8), CANSIGNAL_LE_SIGNED(48, 16) };
+
+static const CanMessageDefinition canMessage_tps0 = CANMESSAGE(0x500, 8, canSignals_pedalSensor);
+static const CanMessageDefinition canMessage_tps1 = CANMESSAGE(0x501, 8, canSignals_pedalSensor);
+static const CanMessageDefinition canMessage_bps0 = CANMESSAGE(0x502, 8, canSignals_pedalSensor);
+static const CanMessageDefinition canMessage_wheelSpeeds = CANMESSAGE(0x503, 8, canSignals_wheelSpeeds);
+static const CanMessageDefinition canMessage_wheelSpeedSensorsFront = CANMESSAGE(0x504, 8, canSignals_wheelSpeedSensors);
+static const CanMessageDefinition canMessage_wheelSpeedSensorsRear = CANMESSAGE(0x505, 8, canSignals_wheelSpeedSensors);
+static const CanMessageDefinition canMessage_safety = CANMESSAGE(0x506, 8, canSignals_safety);
+static const CanMessageDefinition canMessage_lvBattery = CANMESSAGE(0x507, 3, canSignals_lvBattery);
+static const CanMessageDefinition canMessage_regen = CANMESSAGE(0x508, 8, canSignals_regen);
+static const CanMessageDefinition canMessage_hvil = CANMESSAGE(0x509, 8, canSignals_hvil);
+//510 - 51F reserved for dash
+static const CanMessageDefinition canMessage_mcmStartup = CANMESSAGE(0x520, 8, canSignals_mcmStartup);
+static const CanMessageDefinition canMessage_mcmCommand = CANMESSAGE(0x0C0, 8, canSignals_mcmCommand);
+
+/*****************************************************************************
+* Debug telemetry scheduler
+******************************************************************************
+* Each outgoing message is built only when it is due, using the min/max times
+* from its entry in the message history (see CanManager_new):
+*   - max time elapsed                    -> build and send
+*   - sendOnChange and min time elapsed   -> build, send only if data changed
+*   - otherwise                           -> skip (payload is never computed)
+* Debug telemetry goes out on CAN1 (DAQ, dash, laptop).  CAN0 only gets the
+* inverter command, so nothing queues up in front of it.
+****************************************************************************/
+typedef struct _CanTelemetrySources
+{
+    const VehicleState* state;  //Measurements and outputs
+    TorqueEncoder* tps;         //Calibrations
+    BrakePressureSensor* bps;
+    MotorController* mcm;       //Regen settings, HVIL override
+} CanTelemetrySources;
+
+//Fills values[] in the order of the message's signals
+typedef void (*CanTelemetryBuilder)(const CanTelemetrySources* src, sbyte4 values[]);
+
+typedef struct _CanTelemetryMessage
+{
+    const CanMessageDefinition* message;
+    CanTelemetryBuilder build;
+    bool sendOnChange;
+} CanTelemetryMessage;
+
+#define CANMANAGER_MAX_SIGNALS_PER_MESSAGE 8
+
+//Pedal percents are sent as 0-FF
+static ubyte1 canOutput_pedalPercent(Q15 percent)
+{
+    return (ubyte1)FixedPoint_mul(0xFF, percent);
+}
+
+//500: TPS 0
+static void canOutput_buildTps0(const CanTelemetrySources* src, sbyte4 values[])
+{
+    values[0] = canOutput_pedalPercent(src->state->throttlePercent);
+    values[1] = canOutput_pedalPercent(src->state->tps0Percent);
+    values[2] = src->state->tps0Value;
+    values[3] = src->tps->tps0_calibMin;
+    values[4] = src->tps->tps0_calibMax;
+}
+
+//501: TPS 1
+static void canOutput_buildTps1(const CanTelemetrySources* src, sbyte4 values[])
+{
+    values[0] = canOutput_pedalPercent(src->state->throttlePercent);
+    values[1] = canOutput_pedalPercent(src->state->tps1Percent);
     //tps1Percent = 0xFF * (1 - tempPedalPercent);  //OLD: flipped over pedal percent (this value for display in CAN only)
+    values[2] = src->state->tps1Value;
+    values[3] = src->tps->tps1_calibMin;
+    values[4] = src->tps->tps1_calibMax;
+}
 
-    TorqueEncoder_getPedalTravel(tps, &errorCount, &tempPedalPercent); //getThrottlePercent(TRUE, &errorCount);
-    ubyte1 throttlePercent = 0xFF * tempPedalPercent;
-
-    BrakePressureSensor_getPedalTravel(bps, &errorCount, &tempPedalPercent); //getThrottlePercent(TRUE, &errorCount);
-    ubyte1 brakePercent = 0xFF * tempPedalPercent;
-
-	//500: TPS 0
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1; //500
-    canMessages[canMessageCount - 1].data[byteNum++] = throttlePercent;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps0Percent;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_TPS0.sensorValue; // tps->tps0_value;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_TPS0.sensorValue >> 8; //tps->tps0_value >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps0_calibMin;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps0_calibMin >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps0_calibMax;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps0_calibMax >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
-
-	//TPS 1
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].data[byteNum++] = throttlePercent;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps1Percent;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_value;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_value >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_calibMin;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_calibMin >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_calibMax;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_calibMax >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
-
-	//BPS
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].data[byteNum++] = brakePercent; //This should be bps0Percent, but for now bps0Percent = brakePercent
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_value;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_value >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_calibMin;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_calibMin >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_calibMax;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_calibMax >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
-
-	//WSS
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte2)(WheelSpeeds_getWheelSpeed(wss, FL) + 0.5);
-    canMessages[canMessageCount - 1].data[byteNum++] = ((ubyte2)(WheelSpeeds_getWheelSpeed(wss, FL) + 0.5)) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte2)(WheelSpeeds_getWheelSpeed(wss, FR) + 0.5);
-    canMessages[canMessageCount - 1].data[byteNum++] = ((ubyte2)(WheelSpeeds_getWheelSpeed(wss, FR) + 0.5)) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte2)(WheelSpeeds_getWheelSpeed(wss, RL) + 0.5);
-    canMessages[canMessageCount - 1].data[byteNum++] = ((ubyte2)(WheelSpeeds_getWheelSpeed(wss, RL) + 0.5)) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte2)(WheelSpeeds_getWheelSpeed(wss, RR) + 0.5);
-    canMessages[canMessageCount - 1].data[byteNum++] = ((ubyte2)(WheelSpeeds_getWheelSpeed(wss, RR) + 0.5)) >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
-
-	//TEMP: WSS2
-	canMessageCount++;
-	byteNum = 0;
-	canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-	canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FL.sensorValue;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FL.sensorValue >> 8;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FL.sensorValue >> 16;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FL.sensorValue >> 24;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FR.sensorValue;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FR.sensorValue >> 8;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FR.sensorValue >> 16;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FR.sensorValue >> 24;
-	canMessages[canMessageCount - 1].length = byteNum;
-
-	//TEMP: WSS3
-	canMessageCount++;
-	byteNum = 0;
-	canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-	canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;  //505
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RL.sensorValue;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RL.sensorValue >> 8;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RL.sensorValue >> 16;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RL.sensorValue >> 24;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RR.sensorValue;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RR.sensorValue >> 8;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RR.sensorValue >> 16;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RR.sensorValue >> 24;
-	canMessages[canMessageCount - 1].length = byteNum;
-
-    //506: Safety Checker
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getFaults(sc);
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getFaults(sc) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getFaults(sc) >> 16;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getFaults(sc) >> 24;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getWarnings(sc);
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getWarnings(sc) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getNotices(sc);
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getNotices(sc) >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
-
-	//12v battery
-	float4 LVBatterySOC = 0;
-	if (Sensor_LVBattery.sensorValue < 12730)
-		LVBatterySOC = .0 + .1 * getPercent(Sensor_LVBattery.sensorValue, 9200, 12730, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 12866)
-		LVBatterySOC = .1 + .1 * getPercent(Sensor_LVBattery.sensorValue, 12730, 12866, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 12996)
-		LVBatterySOC = .2 + .1 * getPercent(Sensor_LVBattery.sensorValue, 12866, 12996, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 13104)
-		LVBatterySOC = .3 + .1 * getPercent(Sensor_LVBattery.sensorValue, 12996, 13104, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 13116)
-		LVBatterySOC = .4 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13104, 13116, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 13130)
-		LVBatterySOC = .5 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13116, 13130, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 13160)
-		LVBatterySOC = .6 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13130, 13160, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 13270)
-		LVBatterySOC = .7 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13160, 13270, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 13300)
-		LVBatterySOC = .8 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13270, 13300, FALSE);
-	else //if (Sensor_LVBattery.sensorValue < 14340)
-		LVBatterySOC = .9 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13300, 14340, FALSE);
-
-	canMessageCount++;
-	byteNum = 0;
-	canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-	canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-	canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)Sensor_LVBattery.sensorValue;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_LVBattery.sensorValue >> 8;
-	canMessages[canMessageCount - 1].data[byteNum++] = (sbyte1)(100 * LVBatterySOC);
-	canMessages[canMessageCount - 1].length = byteNum;
-
-    //508: Regen settings
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenMode(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)MCM_getRegenTorqueLimitDNm(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenTorqueLimitDNm(mcm) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)MCM_getRegenTorqueAtZeroPedalDNm(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenTorqueAtZeroPedalDNm(mcm) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenAPPSForMaxCoastingZeroToFF(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenBPSForMaxRegenZeroToFF(mcm);
-    canMessages[canMessageCount - 1].length = byteNum;
-
-    //509: MCM RTD Status
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_HVILTerminationSense.sensorValue;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_HVILTerminationSense.sensorValue >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getHvilOverrideStatus(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].length = byteNum;
-
-	//Cooling?
+//502: BPS
+static void canOutput_buildBps0(const CanTelemetrySources* src, sbyte4 values[])
+{
+    values[0] = canOutput_pedalPercent(src->state->brakePercent);
+    values[1] = 0;  //This should be bps0Percent, but for now bps0Percent = brakePercent
+    values[2] = src->state->bps0Value;
+    values[3] = src->bps->bps0_calibMin;
+    values[4] = src->bps->bps0_calibMax;
+}
+
+//503: WSS (m/s, rounded)
+static void canOutput_buildWheelSpeeds(const CanTelemetrySources* src, sbyte4 values[])
+{
+    values[0] = ((ubyte4)src->state->wheelSpeed[FL] + 500) / 1000;
+    values[1] = ((ubyte4)src->state->wheelSpeed[FR] + 500) / 1000;
+    values[2] = ((ubyte4)src->state->wheelSpeed[RL] + 500) / 1000;
+    values[3] = ((ubyte4)src->state->wheelSpeed[RR] + 500) / 1000;
+}
+
+//TEMP: 504, 505: WSS raw
+static void canOutput_buildWheelSpeedSensorsFront(const CanTelemetrySources* src, sbyte4 values[])
+{
+    values[0] = src->state->wheelSpeedSensor[FL];
+    values[1] = src->state->wheelSpeedSensor[FR];
+}
+
+static void canOutput_buildWheelSpeedSensorsRear(const CanTelemetrySources* src, sbyte4 values[])
+{
+    values[0] = src->state->wheelSpeedSensor[RL];
+    values[1] = src->state->wheelSpeedSensor[RR];
+}
+
+//506: Safety Checker
+static void canOutput_buildSafety(const CanTelemetrySources* src, sbyte4 values[])
+{
+    values[0] = src->state->faults;
+    values[1] = src->state->warnings;
+    values[2] = src->state->notices;
+}
+
+//507: 12v battery
+//State of charge vs resting voltage (mV), 10% steps.  Between breakpoints is linear.
+static const sbyte2 lvBatteryVoltage[] = { 9200, 12730, 12866, 12996, 13104, 13116, 13130, 13160, 13270, 13300, 14340 };
+static const sbyte4 lvBatterySOC[]     = {    0,    10,    20,    30,    40,    50,    60,    70,    80,    90,   100 };
+static const LookupTable1D lvBatterySOCCurve = { LOOKUPTABLE_AXIS(lvBatteryVoltage), lvBatterySOC };
+
+static void canOutput_buildLVBattery(const CanTelemetrySources* src, sbyte4 values[])
+{
+    values[0] = src->state->lvBatteryMV;
+    values[1] = (sbyte1)LookupTable_evaluate(&lvBatterySOCCurve, src->state->lvBatteryMV);
+}
+
+//508: Regen settings
+static void canOutput_buildRegen(const CanTelemetrySources* src, sbyte4 values[])
+{
+    values[0] = MCM_getRegenMode(src->mcm);
+    values[1] = MCM_getRegenTorqueLimitDNm(src->mcm);
+    values[2] = MCM_getRegenTorqueAtZeroPedalDNm(src->mcm);
+    values[3] = MCM_getRegenAPPSForMaxCoastingZeroToFF(src->mcm);
+    values[4] = MCM_getRegenBPSForMaxRegenZeroToFF(src->mcm);
+}
+
+//509: MCM RTD Status, power limiter
+static void canOutput_buildHvil(const CanTelemetrySources* src, sbyte4 values[])
+{
+    values[0] = src->state->hvilTermSense;
+    values[1] = MCM_getHvilOverrideStatus(src->mcm);
+    values[2] = src->state->powerLimit;
+    values[3] = src->state->torqueCeilingDNm;
+    values[4] = src->state->powerLimitTrimW / 10;
+}
+
+//520: MCM startup timing
+static void canOutput_buildMcmStartup(const CanTelemetrySources* src, sbyte4 values[])
+{
+    values[0] = src->state->mcmStartupStage;
+    values[1] = MCM_getStartupRetries(src->mcm);
+    values[2] = MCM_getStartupStageTimeMs(src->mcm, MCM_STARTUP_LOCKOUT);
+    values[3] = MCM_getStartupStageTimeMs(src->mcm, MCM_STARTUP_WAIT_RTD);
+    values[4] = MCM_getStartupStageTimeMs(src->mcm, MCM_STARTUP_ENABLING);
+}
+
+//C0: Motor controller command message
+static void canOutput_buildMcmCommand(const CanTelemetrySources* src, sbyte4 values[])
+{
+    values[0] = src->state->commandedTorqueDNm;
+    values[1] = src->state->direction;
+    values[2] = (src->state->inverterEnabled == TRUE) ? 1 : 0; //unused/unused/unused/unused unused/unused/Discharge/Inverter Enable
+    values[3] = src->state->torqueLimitDNm;
+}
 
+static const CanTelemetryMessage canTelemetry[] =
+{
+    //  message                                 builder                                   sendOnChange
+      { &canMessage_tps0,                     canOutput_buildTps0,                     TRUE  }
+    , { &canMessage_tps1,                     canOutput_buildTps1,                     TRUE  }
+    , { &canMessage_bps0,                     canOutput_buildBps0,                     TRUE  }
+    , { &canMessage_wheelSpeeds,              canOutput_buildWheelSpeeds,              TRUE  }
+    , { &canMessage_wheelSpeedSensorsFront,   canOutput_buildWheelSpeedSensorsFront,   FALSE }
+    , { &canMessage_wheelSpeedSensorsRear,    canOutput_buildWheelSpeedSensorsRear,    FALSE }
+    , { &canMessage_safety,                   canOutput_buildSafety,                   TRUE  }
+    , { &canMessage_lvBattery,                canOutput_buildLVBattery,                FALSE }
+    , { &canMessage_regen,                    canOutput_buildRegen,                    TRUE  }
+    , { &canMessage_hvil,                     canOutput_buildHvil,                     TRUE  }
+    //Cooling?
     //510 - 51F reserved for dash
+    , { &canMessage_mcmStartup,               canOutput_buildMcmStartup,               TRUE  }
+};
 
+#define CANOUTPUT_TELEMETRY_COUNT (sizeof(canTelemetry) / sizeof(canTelemetry[0]))
 
-    //Motor controller command message
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = 0xC0;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)MCM_commands_getTorque(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_commands_getTorque(mcm) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;  //Speed (RPM?) - not needed - mcu should be in torque mode
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;  //Speed (RPM?) - not needed - mcu should be in torque mode
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_commands_getDirection(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = (MCM_commands_getInverter(mcm) == ENABLED) ? 1 : 0; //unused/unused/unused/unused unused/unused/Discharge/Inverter Enable
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)MCM_commands_getTorqueLimit(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_commands_getTorqueLimit(mcm) >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
-    //----------------------------------------------------------------------------
-    //Additional sensors
-    //----------------------------------------------------------------------------
+//The slow task queues all of the telemetry, the loop timing stats and the bus stats in the same
+//tick, and it all has to fit in the transmit queue.  Doesn't compile if it can't.
+typedef char canOutput_txQueueFitsSlowTask[(CANMANAGER_TX_QUEUE_SIZE >= CANOUTPUT_TELEMETRY_COUNT + LOOPTIMING_FRAME_COUNT + CANMANAGER_STATS_FRAME_COUNT) ? 1 : -1];
+
+//Sent separately (from the fast task, on CAN0) - see canOutput_sendMCMCommand
+static const CanTelemetryMessage canTelemetry_mcmCommand =
+      { &canMessage_mcmCommand,               canOutput_buildMcmCommand,               TRUE  };
+
+static void canOutput_sendScheduled(CanManager* me, CanChannel channel, const CanTelemetryMessage telemetryMessages[], ubyte1 telemetryCount, const CanTelemetrySources* src)
+{
+    IO_CAN_DATA_FRAME canMessages[CANOUTPUT_TELEMETRY_COUNT];
+    ubyte1 canMessageCount = 0;
+    ubyte4 now = CanManager_now(me);
+
+    for (ubyte1 i = 0; i < telemetryCount && canMessageCount < CANOUTPUT_TELEMETRY_COUNT; i++)
+    {
+        const CanTelemetryMessage* telemetry = &telemetryMessages[i];
+        CanMessageNode* lastMessage = CanManager_findMessage(me, telemetry->message->id);
+
+        //----------------------------------------------------------------------------
+        // Is this message due?
+        //----------------------------------------------------------------------------
+        bool maxTimeExceeded = TRUE;  //Untracked messages are always sent
+        bool minTimeExceeded = TRUE;
+        if (lastMessage != NULL)
+        {
+            ubyte4 timeSinceLastMessage = now - lastMessage->lastMessage_timeStamp;
+            minTimeExceeded = (timeSinceLastMessage >= lastMessage->timeBetweenMessages_Min);
+            maxTimeExceeded = (timeSinceLastMessage >= lastMessage->timeBetweenMessages_Max);
+        }
+        if (!maxTimeExceeded && !(telemetry->sendOnChange && minTimeExceeded))
+        {
+            continue;
+        }
+
+        //----------------------------------------------------------------------------
+        // Build it, and drop it again if it only needed sending on change
+        //----------------------------------------------------------------------------
+        sbyte4 values[CANMANAGER_MAX_SIGNALS_PER_MESSAGE];
+        telemetry->build(src, values);
+        CanSignal_packMessage(telemetry->message, values, &canMessages[canMessageCount]);
+
+        if (!maxTimeExceeded && lastMessage != NULL && !CanManager_dataChanged(lastMessage, &canMessages[canMessageCount]))
+        {
+            continue;
+        }
+        canMessageCount++;
+    }
 
     //Place the can messsages into the FIFO queue ---------------------------------------------------
-    //IO_CAN_WriteFIFO(canFifoHandle_HiPri_Write, canMessages, canMessageCount);  //Important: Only transmit one message (the MCU message)
-    CanManager_send(me, CAN0_HIPRI, canMessages, canMessageCount);  //Important: Only transmit one message (the MCU message)
-    //IO_CAN_WriteFIFO(canFifoHandle_LoPri_Write, canMessages, canMessageCount);  
+    if (canMessageCount > 0)
+    {
+        CanManager_send(me, channel, canMessages, canMessageCount);
+    }
+}
 
+void canOutput_sendDebugMessage(CanManager* me, const VehicleState* state, TorqueEncoder* tps, BrakePressureSensor* bps, MotorController* mcm)
+{
+    const CanTelemetrySources src = { state, tps, bps, mcm };
+    canOutput_sendScheduled(me, CAN1_LOPRI, canTelemetry, CANOUTPUT_TELEMETRY_COUNT, &src);
+}
+
+void canOutput_sendMCMCommand(CanManager* me, const VehicleState* state)
+{
+    const CanTelemetrySources src = { state, NULL, NULL, NULL };
+    canOutput_sendScheduled(me, CAN0_HIPRI, &canTelemetry_mcmCommand, 1, &src);
+}
+
+/*****************************************************************************
+* Bus load / FIFO monitor
+******************************************************************************
+* Once per second, for each channel (byte 0 = channel << 4 | page):
+*   0x50F page 0: 1 = bus load %, 2 = rx FIFO high-water, 3 = largest read batch,
+*                 4-5 = rx frames/s, 6-7 = tx frames/s
+*   0x50F page 1: 1 = read overflows, 2-3 = empty reads (old data),
+*                 4-5 = tx FIFO full events, 6-7 = tx frames dropped
+*   0x50F page 2: busiest received ID: 2-3 = ID, 4-5 = frames/s, 6-7 = bytes/s
+*   0x50F page 3: tx frames dropped by class: 2-3 = critical, 4-5 = powertrain,
+*                 6-7 = telemetry (see CanTxClass)
+* Counts are for the last window and saturate (255 / 65535).
+****************************************************************************/
+static const CanSignal canSignals_busLoad[] =
+    { CANSIGNAL_LE(0, 8), CANSIGNAL_LE(8, 8), CANSIGNAL_LE(16, 8), CANSIGNAL_LE(24, 8), CANSIGNAL_LE(32, 16), CANSIGNAL_LE(48, 16) };
+static const CanSignal canSignals_busEvents[] =
+    { CANSIGNAL_LE(0, 8), CANSIGNAL_LE(8, 8), CANSIGNAL_LE(16, 16), CANSIGNAL_LE(32, 16), CANSIGNAL_LE(48, 16) };
+static const CanSignal canSignals_busTopTalker[] =
+    { CANSIGNAL_LE(0, 8), CANSIGNAL_LE(16, 16), CANSIGNAL_LE(32, 16), CANSIGNAL_LE(48, 16) };
+static const CanSignal canSignals_busClassDrops[] =
+    { CANSIGNAL_LE(0, 8), CANSIGNAL_LE(16, 16), CANSIGNAL_LE(32, 16), CANSIGNAL_LE(48, 16) };
+
+static const CanMessageDefinition canMessage_busLoad = CANMESSAGE(CANMANAGER_STATS_ID, 8, canSignals_busLoad);
+static const CanMessageDefinition canMessage_busEvents = CANMESSAGE(CANMANAGER_STATS_ID, 8, canSignals_busEvents);
+static const CanMessageDefinition canMessage_busTopTalker = CANMESSAGE(CANMANAGER_STATS_ID, 8, canSignals_busTopTalker);
+static const CanMessageDefinition canMessage_busClassDrops = CANMESSAGE(CANMANAGER_STATS_ID, 8, canSignals_busClassDrops);
+
+static ubyte2 CanManager_perSecond(ubyte4 count, ubyte4 elapsedms)
+{
+    ubyte4 rate = (elapsedms == 0) ? 0 : count * 1000 / elapsedms;
+    return (rate > 0xFFFF) ? 0xFFFF : (ubyte2)rate;
+}
+
+void CanManager_publishBusStats(CanManager* me)
+{
+    IO_CAN_DATA_FRAME canMessages[CANMANAGER_STATS_FRAME_COUNT];
+    ubyte1 canMessageCount = 0;
+
+    ubyte4 now = CanManager_now(me);
+    ubyte4 elapsedus = now - me->timestamp_statsWindow;
+    if (elapsedus < CANMANAGER_STATS_PERIOD_US) { return; }
+    me->timestamp_statsWindow = now;
+    ubyte4 elapsedms = elapsedus / 1000;
+
+    for (ubyte1 channel = CAN0_HIPRI; channel <= CAN1_LOPRI; channel++)
+    {
+        CanDispatchTable* table = (channel == CAN0_HIPRI) ? &me->can0_dispatch : &me->can1_dispatch;
+        CanBusStats* stats = (channel == CAN0_HIPRI) ? &me->can0_stats : &me->can1_stats;
+        ubyte2 busSpeed = (channel == CAN0_HIPRI) ? me->can0_busSpeed : me->can1_busSpeed;
+
+        //Per-ID rates, and the busiest ID
+        CanRoute* busiest = NULL;
+        for (ubyte1 i = 0; i < table->routeCount; i++)
+        {
+            CanRoute* route = &table->routes[i];
+            route->framesPerSecond = CanManager_perSecond(route->windowFrames, elapsedms);
+            route->bytesPerSecond = CanManager_perSecond(route->windowBytes, elapsedms);
+            route->windowFrames = 0;
+            route->windowBytes = 0;
+            if (route->framesPerSecond > 0 && (busiest == NULL || route->framesPerSecond > busiest->framesPerSecond)) { busiest = route; }
+        }
+
+        //kbit/s * ms = bits available in the window
+        ubyte4 busLoad = (busSpeed == 0 || elapsedms == 0) ? 0 : stats->bits * 100 / ((ubyte4)busSpeed * elapsedms);
+        {
+            sbyte4 values[] = { channel << 4 | 0, (busLoad > 0xFF) ? 0xFF : busLoad, stats->rxFifoHighWater, stats->readBatchMax
+                              , CanManager_perSecond(stats->rxFrames, elapsedms), CanManager_perSecond(stats->txFrames, elapsedms) };
+            CanSignal_packMessage(&canMessage_busLoad, values, &canMessages[canMessageCount++]);
+        }
+        {
+            sbyte4 values[] = { channel << 4 | 1, (stats->overflowEvents > 0xFF) ? 0xFF : stats->overflowEvents
+                              , stats->oldDataEvents, stats->txFifoFullEvents, stats->txDroppedFrames };
+            CanSignal_packMessage(&canMessage_busEvents, values, &canMessages[canMessageCount++]);
+        }
+        {
+            sbyte4 values[] = { channel << 4 | 2, (busiest == NULL) ? 0 : busiest->id
+                              , (busiest == NULL) ? 0 : busiest->framesPerSecond, (busiest == NULL) ? 0 : busiest->bytesPerSecond };
+            CanSignal_packMessage(&canMessage_busTopTalker, values, &canMessages[canMessageCount++]);
+        }
+        {
+            sbyte4 values[] = { channel << 4 | 3, stats->txClassDrops[CANTX_CRITICAL], stats->txClassDrops[CANTX_POWERTRAIN], stats->txClassDrops[CANTX_TELEMETRY] };
+            CanSignal_packMessage(&canMessage_busClassDrops, values, &canMessages[canMessageCount++]);
+        }
+
+        //Start a new window
+        CanManager_clearBusStats(stats);
+    }
+
+    CanManager_send(me, CAN1_LOPRI, canMessages, canMessageCount);
+}
+
+bool CanManager_getMessageRate(CanManager* me, CanChannel channel, ubyte2 messageID, ubyte2* framesPerSecond, ubyte2* bytesPerSecond)
+{
+    CanRoute* route = CanManager_findRoute((channel == CAN0_HIPRI) ? &me->can0_dispatch : &me->can1_dispatch, messageID);
+    if (route == NULL) { return FALSE; }
+    *framesPerSecond = route->framesPerSecond;
+    *bytesPerSecond = route->bytesPerSecond;
+    return TRUE;
 }
@@ -4,33 +4,84 @@
 #include "IO_Driver.h" 
 #include "IO_CAN.h"
 
-#include "avlTree.h"
 #include "motorController.h"
 #include "bms.h"
 #include "wheelSpeeds.h"
 #include "safety.h"
+#include "vehicleState.h"
 
 typedef enum { CAN0_HIPRI, CAN1_LOPRI } CanChannel;
-//CAN0: 48 messages per handle (48 read, 48 write)
-//CAN1: 16 messages per handle
+//Each channel has one read and one write FIFO, sized by the messageLimits given to CanManager_new
+//(see main.c).  CAN0 also has a small read FIFO for the inverter feedback (CANMANAGER_PRIORITY_FIFO_SIZE).
+
+//VCU debug control, 0x5FF on CAN1 (PCAN Explorer dashboard / laptop, see PCAN/SRE2.sym "V5FF VCU Debug").
+//Byte 0 is the command; every receiver checks it and ignores the other commands.  Byte 1 is the
+//MCM HVIL override (> 0 = keep the MCM relay on for 1 s without the HVIL) in every frame, so it can
+//be sent together with any command - command arguments start at byte 2 and must leave byte 1 alone.
+#define VCU_DEBUG_MESSAGE_ID        0x5FF
+#define VCU_DEBUG_SAFETY_BYPASS     0xC4    //SafetyChecker: bypass the torque reduction for 500 ms
+#define VCU_DEBUG_CUSTOM_REGEN      0x4D    //MotorController: regen mode 4 settings (see MCM_setCustomRegen)
+#define VCU_DEBUG_CAPTURE           0xDA    //DataLogger: byte 2 = 1 -> freeze frame now
+
+//Transmit priority, set per message ID in CanManager_new (unknown IDs are telemetry).
+//CANTX_CRITICAL frames (the inverter command) go to the FIFO as soon as CanManager_send
+//decides to send them.  The rest wait for CanManager_transmit, which releases them
+//highest class first into whatever FIFO space the critical frames left.
+typedef enum { CANTX_CRITICAL, CANTX_POWERTRAIN, CANTX_TELEMETRY, CANTX_CLASSES } CanTxClass;
 
 typedef struct _CanManager CanManager;
 
 typedef struct _CanMessageNode CanMessageNode;
 
+//Parse function for incoming messages.  object is the pointer that was given at registration
+//(e.g. the MotorController*), so existing XXX_parseCanMessage(XXX* me, ...) functions can be registered
+//with a cast to CanMessageParser.
+typedef void (*CanMessageParser)(void* object, IO_CAN_DATA_FRAME* canMessage);
+
 //Note: Sum of messageLimits must be < 128 (hardware only does 128 total messages)
 CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit, ubyte1 can0_write_messageLimit
                          , ubyte2 can1_busSpeed, ubyte1 can1_read_messageLimit, ubyte1 can1_write_messageLimit
                          , ubyte4 defaultSendDelayus, SerialManager* sm);
+//Sends the messages that are due (see timeBetweenMessages_Min/Max).  canMessages[] is reordered in place:
+//the critical messages that were sent end up at the front.  Non-critical messages are only queued.
 IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRAME canMessages[], ubyte1 canMessageCount);
+//Writes out the queued non-critical messages (see CanTxClass).  Run it from the scheduler background.
+void CanManager_transmit(CanManager* me);
+//Makes a tracked message due now, so the next send of it goes out even if it hasn't changed
+//(untracked messages are always sent anyway)
+void CanManager_requestSend(CanManager* me, ubyte2 messageID);
+//Sends every message right away, with no history or rate limiting.  For bulk transfers only.
+IO_ErrorType CanManager_sendBulk(CanManager* me, CanChannel channel, const IO_CAN_DATA_FRAME canMessages[], ubyte1 canMessageCount);
+
+//Registers parse functions for a range of message IDs (inclusive).  Objects should be registered at init.
+//Up to 3 objects can receive the same message ID.  Returns FALSE if the dispatch table is full.
+bool CanManager_registerReceiver(CanManager* me, CanChannel channel, ubyte2 firstMessageID, ubyte2 lastMessageID, CanMessageParser parse, void* object);
 
 //Reads and distributes can messages to their appropriate subsystem objects so they can updates themselves
-void CanManager_read(CanManager* me, CanChannel channel, MotorController* mcm, BatteryManagementSystem* bms, SafetyChecker* sc);
+//(general FIFO - bulk traffic such as the BMS)
+void CanManager_read(CanManager* me, CanChannel channel);
+//Same, for the CAN0 inverter feedback FIFO (0xA0-0xAF only).  Call first in the fast task.
+void CanManager_readPriority(CanManager* me);
+
+//Coalescing counters - see CanManager_read
+ubyte4 CanManager_getSupersededCount(CanManager* me, CanChannel channel);
+bool CanManager_getCoalescingStats(CanManager* me, CanChannel channel, ubyte2 messageID, ubyte2* droppedFrames, ubyte2* duplicateFrames);
+
+//Bus load and FIFO monitor: sends per-channel load, FIFO high-water and overflow counts on 0x50F (CAN1)
+//(see canManager.c for the layout).  Safe to call often - only sends once per second.
+void CanManager_publishBusStats(CanManager* me);
+//Receive rate of one ID over the last stats window.  Returns FALSE if nobody registered for this ID.
+bool CanManager_getMessageRate(CanManager* me, CanChannel channel, ubyte2 messageID, ubyte2* framesPerSecond, ubyte2* bytesPerSecond);
 
 void canOutput_sendSensorMessages(CanManager* me);
 //void canOutput_sendMCUControl(CanManager* me, MotorController* mcm, bool sendEvenIfNoChanges);
-void canOutput_sendDebugMessage(CanManager* me, TorqueEncoder* tps, BrakePressureSensor* bps, MotorController* mcm, WheelSpeeds* wss, SafetyChecker* sc);
+//Debug telemetry (0x500-0x509, 0x520, on CAN1) from the published snapshot (VehicleStateBuffer_getFront)
+void canOutput_sendDebugMessage(CanManager* me, const VehicleState* state, TorqueEncoder* tps, BrakePressureSensor* bps, MotorController* mcm);
+//Sends the MCM command message (0xC0, CAN0) if it has changed or is due.  Call this right after the fast task publishes its snapshot.
+void canOutput_sendMCMCommand(CanManager* me, const VehicleState* state);
 
 ubyte1 CanManager_getReadStatus(CanManager* me, CanChannel channel);
+//Longest allowed time between frames of a message, as set up in CanManager_new (0 = not tracked)
+ubyte4 CanManager_getMessageTimeout(CanManager* me, ubyte2 messageID);
 
 #endif // _CANMANAGER_H is defined
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "canSignals.h"
+
+/*****************************************************************************
+* CAN signal codec
+******************************************************************************
+* See canSignals.h for the bit numbering convention.
+* Signals are read/written a byte (or partial byte) at a time rather than bit
+* by bit, so byte-aligned signals cost one step per byte.
+****************************************************************************/
+
+/*-------------------------------------------------------------------
+* CanSignal_getRaw / CanSignal_setRaw
+* Read/write the unscaled bits of a signal
+-------------------------------------------------------------------*/
+static ubyte4 CanSignal_getRaw(const CanSignal* signal, const ubyte1 data[])
+{
+    ubyte4 raw = 0;
+    ubyte1 bit = signal->startBit;
+    ubyte1 done = 0;
+
+    if (signal->byteOrder == CAN_LITTLE_ENDIAN)
+    {
+        //LSB first: each step takes the low bits of the remaining signal
+        while (done < signal->length)
+        {
+            ubyte1 shift = bit & 7;
+            ubyte1 take = 8 - shift;
+            if (take > signal->length - done) { take = signal->length - done; }
+
+            raw |= (ubyte4)((data[bit >> 3] >> shift) & ((1 << take) - 1)) << done;
+            done += take;
+            bit += take;
+        }
+    }
+    else
+    {
+        //MSB first: each step takes the high bits of the remaining signal,
+        //then continues at bit 7 of the next byte
+        while (done < signal->length)
+        {
+            ubyte1 take = (bit & 7) + 1;
+            if (take > signal->length - done) { take = signal->length - done; }
+
+            raw = (raw << take) | ((data[bit >> 3] >> ((bit & 7) + 1 - take)) & ((1 << take) - 1));
+            done += take;
+            bit = (((bit >> 3) + 1) << 3) + 7;
+        }
+    }
+    return raw;
+}
+
+static void CanSignal_setRaw(const CanSignal* signal, ubyte1 data[], ubyte4 raw)
+{
+    ubyte1 bit = signal->startBit;
+    ubyte1 done = 0;
+
+    if (signal->byteOrder == CAN_LITTLE_ENDIAN)
+    {
+        while (done < signal->length)
+        {
+            ubyte1 shift = bit & 7;
+            ubyte1 take = 8 - shift;
+            if (take > signal->length - done) { take = signal->length - done; }
+
+            ubyte1 mask = (ubyte1)(((1 << take) - 1) << shift);
+            data[bit >> 3] = (data[bit >> 3] & ~mask) | ((ubyte1)((raw >> done) << shift) & mask);
+            done += take;
+            bit += take;
+        }
+    }
+    else
+    {
+        while (done < signal->length)
+        {
+            ubyte1 take = (bit & 7) + 1;
+            if (take > signal->length - done) { take = signal->length - done; }
+
+            ubyte1 shift = (bit & 7) + 1 - take;
+            ubyte1 mask = (ubyte1)(((1 << take) - 1) << shift);
+            done += take;
+            data[bit >> 3] = (data[bit >> 3] & ~mask) | ((ubyte1)((raw >> (signal->length - done)) << shift) & mask);
+            bit = (((bit >> 3) + 1) << 3) + 7;
+        }
+    }
+}
+
+/*****************************************************************************
+* Single signals
+****************************************************************************/
+sbyte4 CanSignal_unpack(const CanSignal* signal, const ubyte1 data[])
+{
+    ubyte4 raw = CanSignal_getRaw(signal, data);
+    sbyte4 value;
+
+    //Sign extend
+    if (signal->isSigned == TRUE && signal->length < 32 && (raw & ((ubyte4)1 << (signal->length - 1))) != 0)
+    {
+        raw |= ~(((ubyte4)1 << signal->length) - 1);
+    }
+    value = (sbyte4)raw;
+
+    if (signal->factor != 1 || signal->divisor != 1)
+    {
+        value = value * signal->factor / signal->divisor;
+    }
+    return value + signal->offset;
+}
+
+void CanSignal_pack(const CanSignal* signal, ubyte1 data[], sbyte4 value)
+{
+    value -= signal->offset;
+    if (signal->factor != 1 || signal->divisor != 1)
+    {
+        value = value * signal->divisor / signal->factor;
+    }
+    CanSignal_setRaw(signal, data, (ubyte4)value);
+}
+
+/*****************************************************************************
+* Whole messages
+****************************************************************************/
+void CanSignal_packMessage(const CanMessageDefinition* message, const sbyte4 values[], IO_CAN_DATA_FRAME* canMessage)
+{
+    canMessage->id = message->id;
+    canMessage->id_format = IO_CAN_STD_FRAME;
+    canMessage->length = message->length;
+    for (ubyte1 i = 0; i < 8; i++) { canMessage->data[i] = 0; }
+
+    for (ubyte1 i = 0; i < message->signalCount; i++)
+    {
+        CanSignal_pack(&message->signals[i], canMessage->data, values[i]);
+    }
+}
+
+ubyte1 CanSignal_unpackFields(const CanSignalField fields[], ubyte1 fieldCount, const IO_CAN_DATA_FRAME* canMessage, void* object)
+{
+    ubyte1 stored = 0;
+    for (ubyte1 i = 0; i < fieldCount; i++)
+    {
+        if (fields[i].messageID != canMessage->id) { continue; }
+
+        sbyte4 value = CanSignal_unpack(&fields[i].signal, canMessage->data);
+        void* field = (ubyte1*)object + fields[i].fieldOffset;
+        switch (fields[i].fieldSize)
+        {
+        case 1: *(ubyte1*)field = (ubyte1)value; break;
+        case 2: *(ubyte2*)field = (ubyte2)value; break;
+        case 4: *(ubyte4*)field = (ubyte4)value; break;
+        }
+        stored++;
+    }
+    return stored;
+}
@@ -0,0 +1,71 @@
+#ifndef _CANSIGNALS_H
+#define _CANSIGNALS_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+/*****************************************************************************
+* CAN signal codec
+******************************************************************************
+* DBC-style description of the signals inside a CAN frame, so messages can be
+* packed/unpacked from const tables instead of hand-written shifts.
+*
+* Bit numbering follows DBC files:
+*   CAN_LITTLE_ENDIAN (Intel):    startBit is the signal's LSB
+*   CAN_BIG_ENDIAN    (Motorola): startBit is the signal's MSB
+*   Bit n is bit (n % 8) of data[n / 8]
+*
+* Scaling is integer only (no FPU):  value = raw * factor / divisor + offset
+****************************************************************************/
+typedef enum { CAN_LITTLE_ENDIAN, CAN_BIG_ENDIAN } CanByteOrder;
+
+typedef struct _CanSignal
+{
+    ubyte1 startBit;
+    ubyte1 length;          //bits, 1-32
+    CanByteOrder byteOrder;
+    bool isSigned;
+    sbyte2 factor;
+    sbyte2 divisor;
+    sbyte4 offset;
+} CanSignal;
+
+//Shorthand for the common cases
+#define CANSIGNAL_LE(startBit, length)                       { startBit, length, CAN_LITTLE_ENDIAN, FALSE, 1, 1, 0 }
+#define CANSIGNAL_LE_SIGNED(startBit, length)                { startBit, length, CAN_LITTLE_ENDIAN, TRUE, 1, 1, 0 }
+#define CANSIGNAL_LE_SCALED(startBit, length, factor, divisor) { startBit, length, CAN_LITTLE_ENDIAN, FALSE, factor, divisor, 0 }
+#define CANSIGNAL_LE_SIGNED_SCALED(startBit, length, factor, divisor) { startBit, length, CAN_LITTLE_ENDIAN, TRUE, factor, divisor, 0 }
+#define CANSIGNAL_BE(startBit, length)                       { startBit, length, CAN_BIG_ENDIAN, FALSE, 1, 1, 0 }
+
+//A transmitted message: signals are packed in order from a values[] array
+typedef struct _CanMessageDefinition
+{
+    ubyte2 id;
+    ubyte1 length;          //bytes; unused bytes are sent as 0
+    ubyte1 signalCount;
+    const CanSignal* signals;
+} CanMessageDefinition;
+
+//Definition for a message whose signals are the const CanSignal array signals[] (signalCount from its size)
+#define CANMESSAGE(id, length, signals) { id, length, sizeof(signals) / sizeof(signals[0]), signals }
+
+//A received signal that is stored directly into a field of the receiving object
+//e.g. { 0x622, CANSIGNAL_LE(8, 16), offsetof(struct _BatteryManagementSystem, timer), sizeof(ubyte2) }
+typedef struct _CanSignalField
+{
+    ubyte2 messageID;
+    CanSignal signal;
+    ubyte2 fieldOffset;     //offsetof() the field in the receiving object
+    ubyte1 fieldSize;       //sizeof() the field: 1, 2 or 4 bytes
+} CanSignalField;
+
+sbyte4 CanSignal_unpack(const CanSignal* signal, const ubyte1 data[]);
+void CanSignal_pack(const CanSignal* signal, ubyte1 data[], sbyte4 value);
+
+//Fills in id, id_format, length and data.  values[] must have message->signalCount entries.
+void CanSignal_packMessage(const CanMessageDefinition* message, const sbyte4 values[], IO_CAN_DATA_FRAME* canMessage);
+
+//Stores every field in fields[] whose messageID matches canMessage->id.  Returns the number of fields stored.
+ubyte1 CanSignal_unpackFields(const CanSignalField fields[], ubyte1 fieldCount, const IO_CAN_DATA_FRAME* canMessage, void* object);
+
+#endif // _CANSIGNALS_H
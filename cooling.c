@@ -1,4 +1,3 @@
-#include <stdlib.h>
 #include "IO_Driver.h"
 //#include "IO_DIO.h"
 //#include "IO_PWM.h"
@@ -6,22 +5,50 @@
 #include "serial.h"
 #include "sensors.h"
 #include "cooling.h"
+#include "arena.h"
 #include "motorController.h"
 #include "mathFunctions.h"
+#include "fixedPoint.h"
+#include "lookupTable.h"
 #include "bms.h"
 
 //All temperatures in C
+
+//Water pump: 20% (minimum) up to 25C, ramping to 90% at 40C
+static const sbyte2 waterPumpTemp[]    = { 25,      40      };
+static const sbyte4 waterPumpPercent[] = { Q15(.2), Q15(.9) };
+static const LookupTable1D waterPumpCurve = { LOOKUPTABLE_AXIS(waterPumpTemp), waterPumpPercent };
+
+//Feed forward: pump demand from MCM power, 20% up to 10 kW, ramping to 90% at 60 kW
+static const sbyte2 waterPumpPowerKW[]      = { 10,      60      };
+static const sbyte4 waterPumpPowerPercent[] = { Q15(.2), Q15(.9) };
+static const LookupTable1D waterPumpPowerCurve = { LOOKUPTABLE_AXIS(waterPumpPowerKW), waterPumpPowerPercent };
+
+//Fans also come on above these (filtered) powers, and stay on until the power drops
+//below the off level and the temperatures are below their low points
+#define COOLING_MOTORFAN_ON_W       30000
+#define COOLING_MOTORFAN_OFF_W      20000
+#define COOLING_BATTERYFAN_ON_W     30000
+#define COOLING_BATTERYFAN_OFF_W    20000
+
+//Power low-pass: each call moves 1/8 of the way to the new reading (~0.8 s at 100 ms)
+#define COOLING_POWER_FILTER_SHIFT  3
+
+//Pump PWM may change by at most this much per call (100 ms): 0 -> 100% in 2 s
+#define COOLING_PUMP_SLEW           Q15(.05)
+
 CoolingSystem* CoolingSystem_new(SerialManager* serialMan)
 {
-    CoolingSystem* me = (CoolingSystem*)malloc(sizeof(struct _CoolingSystem));
-    SerialManager* sm = serialMan;
+    CoolingSystem* me = (CoolingSystem*)Arena_allocate(ARENA_EXTERNAL, sizeof(struct _CoolingSystem));
+    me->sm = serialMan;
 
     //Cooling systems:
     //Water pump (motor, controller) - PWM
-    me->waterPumpMinPercent = 0.2;
-    me->waterPumpLow = 25;  //Start ramping beyond min at this temp
-    me->waterPumpHigh = 40;
-    me->waterPumpPercent = .2;
+    me->waterPumpCurve = &waterPumpCurve;
+    me->waterPumpPowerCurve = &waterPumpPowerCurve;
+    me->waterPumpPercent = waterPumpPercent[0];
+    me->motorPowerW = 0;
+    me->batteryPowerW = 0;
 
     //PP fans (motor, radiator) - Relay
     //Motor fan + radiator on same circuit
@@ -38,7 +65,12 @@ CoolingSystem* CoolingSystem_new(SerialManager* serialMan)
     me->batteryFanLow = 32;  //Turn off BELOW tuhis point
     me->batteryFanHigh = 35;  //Turn on at this temperature
     me->batteryFanState = TRUE;      //float4 batteryFanPercent;
-    
+
+    me->outputsWritten = FALSE;
+    me->waterPumpDuty = 0;
+    me->motorFanDuty = 0;
+    me->batteryFanDuty = 0;
+
     return me;
 }
 
@@ -46,22 +78,28 @@ CoolingSystem* CoolingSystem_new(SerialManager* serialMan)
 // Cooling system calculations - turns fans on/off, sends water pump PWM control signal
 //Rinehart water temperature operating range: -30C to +80C before derating
 //-------------------------------------------------------------------
-void CoolingSystem_calculations(CoolingSystem* me, sbyte2 motorControllerTemp, sbyte2 motorTemp, sbyte1 batteryTemp)
+//First order low-pass on a power reading (W).  Regen counts as no load.
+static sbyte4 CoolingSystem_filterPower(sbyte4 filtered, sbyte4 powerW)
+{
+    if (powerW < 0) { powerW = 0; }
+    return filtered + ((powerW - filtered) >> COOLING_POWER_FILTER_SHIFT);
+}
+
+void CoolingSystem_calculations(CoolingSystem* me, sbyte2 motorControllerTemp, sbyte2 motorTemp, sbyte1 batteryTemp, sbyte4 motorPowerW, sbyte4 batteryPowerW)
 {
+    me->motorPowerW = CoolingSystem_filterPower(me->motorPowerW, motorPowerW);
+    me->batteryPowerW = CoolingSystem_filterPower(me->batteryPowerW, batteryPowerW);
+
     //Water pump ------------------
     //Water pump PWM protocol unknown
-    if (motorControllerTemp >= me->waterPumpHigh || motorTemp >= me->waterPumpHigh)
-    {
-        me->waterPumpPercent = .9;
-    }
-    else if (motorControllerTemp < me->waterPumpLow && motorTemp < me->waterPumpLow)
-    {
-        me->waterPumpPercent = .2;
-    }
-    else
-    {
-        me->waterPumpPercent = .2 + .7 * getPercent(max(motorControllerTemp, motorTemp), me->waterPumpLow, me->waterPumpHigh, TRUE);
-    }
+    //Follows the hotter of the two, or the power demand if that's higher
+    sbyte2 hottest = (motorControllerTemp > motorTemp) ? motorControllerTemp : motorTemp;
+    Q15 pumpDemand = (Q15)LookupTable_evaluate(me->waterPumpCurve, hottest);
+    Q15 pumpPowerDemand = (Q15)LookupTable_evaluate(me->waterPumpPowerCurve, me->motorPowerW / 1000);
+    if (pumpPowerDemand > pumpDemand) { pumpDemand = pumpPowerDemand; }
+
+    //Slew limit, so the pump ramps instead of stepping
+    me->waterPumpPercent = (Q15)FixedPoint_clamp(pumpDemand, (sbyte4)me->waterPumpPercent - COOLING_PUMP_SLEW, (sbyte4)me->waterPumpPercent + COOLING_PUMP_SLEW);
 
     //ubyte1* tempMsg[25];
     //sprintf(tempMsg, "Motor temp: %d\n", motorTemp);
@@ -103,7 +141,7 @@ void CoolingSystem_calculations(CoolingSystem* me, sbyte2 motorControllerTemp, s
     //Motor fan / rad fan
     if(me->motorFanState == FALSE)
     {
-        if ((motorControllerTemp >= me->motorFanHigh) || (motorTemp >= me->motorFanHigh))
+        if ((motorControllerTemp >= me->motorFanHigh) || (motorTemp >= me->motorFanHigh) || me->motorPowerW >= COOLING_MOTORFAN_ON_W)
         {
             me->motorFanState = TRUE;
             SerialManager_send(me->sm, "Turning motor fans on.\n");
@@ -111,7 +149,7 @@ void CoolingSystem_calculations(CoolingSystem* me, sbyte2 motorControllerTemp, s
     }
     else  //motor fan is on
     {
-        if ((motorControllerTemp < me->motorFanLow) && (motorTemp < me->motorFanLow))
+        if ((motorControllerTemp < me->motorFanLow) && (motorTemp < me->motorFanLow) && me->motorPowerW < COOLING_MOTORFAN_OFF_W)
             // Shouldn't this be an || instead of an &&
         {
             me->motorFanState = FALSE;
@@ -122,7 +160,7 @@ void CoolingSystem_calculations(CoolingSystem* me, sbyte2 motorControllerTemp, s
     //Battery fans
     if (me->batteryFanState == TRUE)
     {
-        if (batteryTemp < me->batteryFanLow)
+        if (batteryTemp < me->batteryFanLow && me->batteryPowerW < COOLING_BATTERYFAN_OFF_W)
         {
             me->batteryFanState = FALSE;
             SerialManager_send(me->sm, "Turning battery fans off.\n");
@@ -130,7 +168,7 @@ void CoolingSystem_calculations(CoolingSystem* me, sbyte2 motorControllerTemp, s
     }
     else //fans are off
     {
-        if (batteryTemp >= me->batteryFanHigh)
+        if (batteryTemp >= me->batteryFanHigh || me->batteryPowerW >= COOLING_BATTERYFAN_ON_W)
         {
             me->batteryFanState = TRUE;
             SerialManager_send(me->sm, "Turning battery fans on.\n");
@@ -154,11 +192,18 @@ void CoolingSystem_calculations(CoolingSystem* me, sbyte2 motorControllerTemp, s
 // Cooling system control - turns fans on/off, sends water pump PWM control signal
 //Rinehart water temperature operating range: -30C to +80C before derating
 //-------------------------------------------------------------------
+static void CoolingSystem_write(CoolingSystem* me, Light output, ubyte2* lastDuty, ubyte2 duty)
+{
+    if (me->outputsWritten == TRUE && duty == *lastDuty) { return; }
+    Light_setDuty(output, duty);
+    *lastDuty = duty;
+}
+
 void CoolingSystem_enactCooling(CoolingSystem* me)
 {
     //Send PWM control signal to water pump
-    Light_set(Cooling_waterPump, me->waterPumpPercent);
-    Light_set(Cooling_motorFans, me->motorFanState == TRUE ? 1 : 0);
-    Light_set(Cooling_batteryFans, me->batteryFanState == TRUE ? 1 : 0);
-
+    CoolingSystem_write(me, Cooling_waterPump, &me->waterPumpDuty, FixedPoint_toDuty(me->waterPumpPercent));
+    CoolingSystem_write(me, Cooling_motorFans, &me->motorFanDuty, me->motorFanState == TRUE ? 0xFFFF : 0);
+    CoolingSystem_write(me, Cooling_batteryFans, &me->batteryFanDuty, me->batteryFanState == TRUE ? 0xFFFF : 0);
+    me->outputsWritten = TRUE;
 }
\ No newline at end of file
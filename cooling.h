@@ -2,17 +2,32 @@
 #define _COOLING_H
 
 #include "IO_Driver.h"
-
+#include "fixedPoint.h"
+#include "lookupTable.h"
+
+/*****************************************************************************
+* Cooling system (slow task)
+******************************************************************************
+* Pump and fans follow the higher of two demands:
+*   feedback     - temperature (pump curve, fan on/off with hysteresis)
+*   feed forward - electrical power, low-pass filtered, so cooling starts
+*                  ramping up when the heat is being made instead of after
+*                  the temperatures (and the inverter derate) catch up
+* The pump PWM is slew limited, and outputs are only written when they change.
+****************************************************************************/
 typedef struct _CoolingSystem
 {
     SerialManager* sm;
 
     //Cooling systems:
     //Water pump (motor, controller) - PWM
-    float4 waterPumpMinPercent;
-    sbyte1 waterPumpLow;  //Start ramping beyond min at this temp
-    sbyte1 waterPumpHigh;
-    float4 waterPumpPercent;
+    const LookupTable1D* waterPumpCurve;  //Hottest of motor/controller temp -> pump percent (Q15)
+    const LookupTable1D* waterPumpPowerCurve;  //Filtered MCM power (kW) -> pump percent (Q15)
+    Q15 waterPumpPercent;                 //Output, moves towards the demand by at most the slew limit per call
+
+    //Electrical power, low-pass filtered (W)
+    sbyte4 motorPowerW;
+    sbyte4 batteryPowerW;
 
     //PP fans (motor, radiator) - Relay
     //Motor fan + radiator on same circuit
@@ -26,11 +41,18 @@ typedef struct _CoolingSystem
     sbyte1 batteryFanHigh;    // Turn on at this temperature
     bool batteryFanState;
     //float4 batteryFanPercent;
+
+    //Last values written to the outputs (only valid once outputsWritten)
+    bool outputsWritten;
+    ubyte2 waterPumpDuty;
+    ubyte2 motorFanDuty;
+    ubyte2 batteryFanDuty;
 }
 CoolingSystem;
 
 CoolingSystem* CoolingSystem_new(SerialManager* sm);
-void CoolingSystem_calculations(CoolingSystem* me, sbyte2 motorControllerTemp, sbyte2 motorTemp, sbyte1 batteryTemp);
+//Slow task.  Powers in W (MCM_getPower / BMS_getPower), positive = discharging.
+void CoolingSystem_calculations(CoolingSystem* me, sbyte2 motorControllerTemp, sbyte2 motorTemp, sbyte1 batteryTemp, sbyte4 motorPowerW, sbyte4 batteryPowerW);
 void CoolingSystem_enactCooling(CoolingSystem* me);
 
 
@@ -0,0 +1,216 @@
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "dataLogger.h"
+#include "arena.h"
+#include "fixedPoint.h"
+#include "canManager.h"
+
+//Ring size.  128 records at 5 ms = 640 ms of history (3.75 KB of RAM).
+#define DATALOGGER_RECORDS 128
+#define DATALOGGER_RECORD_SIZE 30
+
+//Records kept after the trigger.  The rest of the window is before it.
+#define DATALOGGER_POST_RECORDS 48
+
+//Each 0x50E frame carries 6 bytes of a record
+#define DATALOGGER_PART_SIZE 6
+#define DATALOGGER_PARTS (DATALOGGER_RECORD_SIZE / DATALOGGER_PART_SIZE)
+
+//CAN1 frames per DataLogger_task call (medium task: 8 per 20 ms = 400 frames/s)
+#define DATALOGGER_FRAMES_PER_TASK 8
+
+#define DATALOGGER_HEADER_ID 0x50D
+#define DATALOGGER_DATA_ID   0x50E
+
+typedef enum
+{
+      DATALOGGER_RECORDING
+    , DATALOGGER_CAPTURING   //Triggered - recording the post-trigger records
+    , DATALOGGER_STREAMING   //Frozen - sending the window
+} DataLoggerState;
+
+struct _DataLogger
+{
+    DataLoggerState state;
+
+    ubyte1 records[DATALOGGER_RECORDS][DATALOGGER_RECORD_SIZE];
+    ubyte1 head;                //Next record to write
+    ubyte1 recordCount;         //Saturates at DATALOGGER_RECORDS
+
+    ubyte4 lastFaults;          //Fault word from the previous tick (to find new faults)
+    bool captureRequested;
+
+    //Capture in progress
+    ubyte2 captureNumber;
+    ubyte4 triggerFaults;
+    ubyte1 postRemaining;
+
+    //Streaming
+    bool headerSent;
+    ubyte1 streamRecord;        //0 = oldest record in the window
+    ubyte1 streamPart;
+};
+
+DataLogger* DataLogger_new(void)
+{
+    DataLogger* me = (DataLogger*)Arena_allocate(ARENA_EXTERNAL, sizeof(struct _DataLogger));
+
+    me->state = DATALOGGER_RECORDING;
+    me->head = 0;
+    me->recordCount = 0;
+    me->lastFaults = 0;
+    me->captureRequested = FALSE;
+    me->captureNumber = 0;
+    me->triggerFaults = 0;
+    me->postRemaining = 0;
+    me->headerSent = FALSE;
+    me->streamRecord = 0;
+    me->streamPart = 0;
+
+    return me;
+}
+
+/*-------------------------------------------------------------------
+* Recording
+-------------------------------------------------------------------*/
+static void DataLogger_put16(ubyte1* record, ubyte1 offset, ubyte2 value)
+{
+    record[offset] = (ubyte1)value;
+    record[offset + 1] = (ubyte1)(value >> 8);
+}
+
+static void DataLogger_put32(ubyte1* record, ubyte1 offset, ubyte4 value)
+{
+    DataLogger_put16(record, offset, (ubyte2)value);
+    DataLogger_put16(record, offset + 2, (ubyte2)(value >> 16));
+}
+
+void DataLogger_record(DataLogger* me, const VehicleState* state)
+{
+    ubyte4 faults = state->faults;
+    ubyte4 newFaults = faults & ~me->lastFaults;
+    me->lastFaults = faults;
+
+    //Don't overwrite the window while it's being sent
+    if (me->state == DATALOGGER_STREAMING) { return; }
+
+    ubyte1* record = me->records[me->head];
+    DataLogger_put16(record, 0, state->throttlePercent);
+    DataLogger_put16(record, 2, state->brakePercent);
+    DataLogger_put16(record, 4, (ubyte2)state->requestedTorqueDNm);
+    DataLogger_put16(record, 6, (ubyte2)state->commandedTorqueDNm);
+    DataLogger_put16(record, 8, state->wheelSpeed[FL]);
+    DataLogger_put16(record, 10, state->wheelSpeed[FR]);
+    DataLogger_put16(record, 12, state->wheelSpeed[RL]);
+    DataLogger_put16(record, 14, state->wheelSpeed[RR]);
+    DataLogger_put32(record, 16, faults);
+    DataLogger_put16(record, 20, state->warnings);
+    record[22] = (ubyte1)state->notices;
+    record[23] = state->mcmStartupStage;
+    DataLogger_put16(record, 24, (ubyte2)FixedPoint_clamp(state->mcmPowerW / 10, -32768, 32767));
+    DataLogger_put16(record, 26, (ubyte2)FixedPoint_clamp(state->bmsPowerW / 10, -32768, 32767));
+    record[28] = (ubyte1)FixedPoint_clamp(state->bmsDCL, 0, 0xFF);
+    record[29] = (ubyte1)FixedPoint_clamp(state->bmsCCL, 0, 0xFF);
+
+    me->head = (me->head + 1) % DATALOGGER_RECORDS;
+    if (me->recordCount < DATALOGGER_RECORDS) { me->recordCount++; }
+
+    if (me->state == DATALOGGER_RECORDING)
+    {
+        if (newFaults != 0 || me->captureRequested == TRUE)
+        {
+            me->state = DATALOGGER_CAPTURING;
+            me->captureRequested = FALSE;
+            me->triggerFaults = faults;
+            me->postRemaining = DATALOGGER_POST_RECORDS;
+        }
+    }
+    else if (--me->postRemaining == 0)  //DATALOGGER_CAPTURING
+    {
+        me->state = DATALOGGER_STREAMING;
+        me->captureNumber++;
+        me->headerSent = FALSE;
+        me->streamRecord = 0;
+        me->streamPart = 0;
+    }
+}
+
+/*-------------------------------------------------------------------
+* Streaming
+-------------------------------------------------------------------*/
+void DataLogger_task(DataLogger* me, CanManager* canMan)
+{
+    IO_CAN_DATA_FRAME canMessages[DATALOGGER_FRAMES_PER_TASK];
+    ubyte1 canMessageCount = 0;
+
+    if (me->state != DATALOGGER_STREAMING) { return; }
+
+    //Work on copies so nothing advances unless the FIFO takes the whole batch
+    bool headerSent = me->headerSent;
+    ubyte1 streamRecord = me->streamRecord;
+    ubyte1 streamPart = me->streamPart;
+
+    //Oldest record in the window (head itself once the ring is full)
+    ubyte1 oldest = (me->head + DATALOGGER_RECORDS - me->recordCount) % DATALOGGER_RECORDS;
+
+    while (canMessageCount < DATALOGGER_FRAMES_PER_TASK && streamRecord < me->recordCount)
+    {
+        IO_CAN_DATA_FRAME* canMessage = &canMessages[canMessageCount++];
+        canMessage->id_format = IO_CAN_STD_FRAME;
+        canMessage->length = 8;
+
+        if (headerSent == FALSE)
+        {
+            canMessage->id = DATALOGGER_HEADER_ID;
+            DataLogger_put16(canMessage->data, 0, me->captureNumber);
+            canMessage->data[2] = me->recordCount;
+            canMessage->data[3] = me->recordCount - 1 - DATALOGGER_POST_RECORDS;
+            DataLogger_put32(canMessage->data, 4, me->triggerFaults);
+            headerSent = TRUE;
+            continue;
+        }
+
+        const ubyte1* record = me->records[(oldest + streamRecord) % DATALOGGER_RECORDS];
+        canMessage->id = DATALOGGER_DATA_ID;
+        canMessage->data[0] = streamRecord;
+        canMessage->data[1] = streamPart;
+        for (ubyte1 i = 0; i < DATALOGGER_PART_SIZE; i++)
+        {
+            canMessage->data[2 + i] = record[streamPart * DATALOGGER_PART_SIZE + i];
+        }
+
+        if (++streamPart >= DATALOGGER_PARTS)
+        {
+            streamPart = 0;
+            streamRecord++;
+        }
+    }
+
+    if (CanManager_sendBulk(canMan, CAN1_LOPRI, canMessages, canMessageCount) != IO_E_OK) { return; }  //FIFO full - try again next time
+
+    me->headerSent = headerSent;
+    me->streamRecord = streamRecord;
+    me->streamPart = streamPart;
+
+    //Whole window sent - start recording again
+    if (streamRecord >= me->recordCount)
+    {
+        me->state = DATALOGGER_RECORDING;
+        me->recordCount = 0;
+    }
+}
+
+void DataLogger_parseCanMessage(DataLogger* me, IO_CAN_DATA_FRAME* canMessage)
+{
+	switch (canMessage->id)
+	{
+	case VCU_DEBUG_MESSAGE_ID:
+        //Capture request from the PCAN Explorer dashboard
+        if (canMessage->data[0] == VCU_DEBUG_CAPTURE && canMessage->data[2] == 0x01)
+        {
+            me->captureRequested = TRUE;
+        }
+		break;
+	}
+}
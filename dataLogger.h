@@ -0,0 +1,43 @@
+#ifndef _DATALOGGER_H
+#define _DATALOGGER_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "vehicleState.h"
+#include "canManager.h"
+
+/*****************************************************************************
+* Data logger (RAM freeze frames)
+******************************************************************************
+* Records a 30 byte snapshot every fast tick into a RAM ring.  When a new
+* fault bit sets (or a capture is requested), it keeps recording for
+* DATALOGGER_POST_RECORDS more ticks, then freezes the ring and streams the
+* whole window out on CAN1.  Streaming is spread over DataLogger_task calls so
+* it never floods the bus.  Recording resumes once the window has been sent.
+*
+* CAN1 frames:
+*   0x50D  capture header: 0-1 = capture number, 2 = records, 3 = trigger record,
+*          4-7 = fault word that triggered it
+*   0x50E  data: 0 = record number, 1 = part (0-4), 2-7 = 6 bytes of the record
+* Record layout (little endian): 0 TPS Q15, 2 BPS Q15, 4 requested torque dNm,
+*   6 commanded torque dNm (after SafetyChecker), 8-15 wheel speeds FL/FR/RL/RR mm/s,
+*   16 faults (4), 20 warnings (2), 22 notices low byte, 23 MCM startup stage,
+*   24 MCM power (10 W), 26 BMS power (10 W), 28 BMS DCL, 29 BMS CCL
+*
+* Requests on 0x5FF (CAN1): byte 0 = 0xDA (VCU_DEBUG_CAPTURE), byte 2 = 1 -> capture now
+* (byte 1 is the HVIL override, see canManager.h).
+****************************************************************************/
+typedef struct _DataLogger DataLogger;
+
+DataLogger* DataLogger_new(void);
+
+//Call at the end of every fast tick, with the snapshot that was just published
+void DataLogger_record(DataLogger* me, const VehicleState* state);
+
+//Streams a frozen window out on CAN1, a few frames per call
+void DataLogger_task(DataLogger* me, CanManager* canMan);
+
+void DataLogger_parseCanMessage(DataLogger* me, IO_CAN_DATA_FRAME* canMessage);
+
+#endif // _DATALOGGER_H
@@ -0,0 +1,220 @@
+#include "IO_Driver.h"
+#include "IO_RTC.h"
+#include "IO_EEPROM.h"
+
+#include "eepromManager.h"
+#include "arena.h"
+#include "serial.h"
+
+//Bump the version whenever EEPROMCalibration changes - old records are then ignored
+#define EEPROMMANAGER_MAGIC   0x5352  //"SR"
+#define EEPROMMANAGER_VERSION 2
+
+//Record layout: magic (2), version (1), sequence (1), 6 x ubyte2 values, 4 regen bytes, CRC (2)
+#define EEPROMMANAGER_RECORD_SIZE 22
+#define EEPROMMANAGER_REGEN_OFFSET 16
+#define EEPROMMANAGER_CRC_OFFSET  (EEPROMMANAGER_RECORD_SIZE - 2)
+
+//Slots start on 32 byte boundaries so a chunk never crosses an EEPROM page
+#define EEPROMMANAGER_SLOTS       2
+#define EEPROMMANAGER_SLOT_SIZE   32
+#define EEPROMMANAGER_CHUNK_SIZE  8
+
+#define EEPROMMANAGER_READ_TIMEOUT_US 100000
+
+struct _EEPROMManager
+{
+    SerialManager* serialMan;
+
+    EEPROMCalibration calibration;  //Last loaded or saved values
+    bool calibrationValid;
+
+    ubyte1 sequence;                //Of the newest record (loaded or written)
+    ubyte1 currentSlot;             //Slot holding the newest record - the next write goes to the other one
+
+    //Write in progress.  image must stay untouched until the driver is done with it,
+    //which is why setCalibration only changes calibration and sets dirty.
+    bool dirty;
+    bool writing;
+    ubyte1 writeSlot;
+    ubyte1 writeOffset;
+    ubyte1 image[EEPROMMANAGER_RECORD_SIZE];
+};
+
+/*-------------------------------------------------------------------
+* Record encoding
+-------------------------------------------------------------------*/
+//CRC-16/CCITT (poly 0x1021, init 0xFFFF).  Only runs at init and once per save.
+static ubyte2 EEPROMManager_crc(const ubyte1* data, ubyte1 length)
+{
+    ubyte2 crc = 0xFFFF;
+    for (ubyte1 i = 0; i < length; i++)
+    {
+        crc ^= (ubyte2)data[i] << 8;
+        for (ubyte1 bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void EEPROMManager_put(ubyte1* image, ubyte1 offset, ubyte2 value)
+{
+    image[offset] = (ubyte1)value;
+    image[offset + 1] = (ubyte1)(value >> 8);
+}
+
+static ubyte2 EEPROMManager_get(const ubyte1* image, ubyte1 offset)
+{
+    return (ubyte2)image[offset] | ((ubyte2)image[offset + 1] << 8);
+}
+
+static void EEPROMManager_encode(ubyte1* image, const EEPROMCalibration* calibration, ubyte1 sequence)
+{
+    EEPROMManager_put(image, 0, EEPROMMANAGER_MAGIC);
+    image[2] = EEPROMMANAGER_VERSION;
+    image[3] = sequence;
+    EEPROMManager_put(image, 4, calibration->tps0_calibMin);
+    EEPROMManager_put(image, 6, calibration->tps0_calibMax);
+    EEPROMManager_put(image, 8, calibration->tps1_calibMin);
+    EEPROMManager_put(image, 10, calibration->tps1_calibMax);
+    EEPROMManager_put(image, 12, calibration->bps0_calibMin);
+    EEPROMManager_put(image, 14, calibration->bps0_calibMax);
+    for (ubyte1 i = 0; i < sizeof(calibration->regen_custom); i++) { image[EEPROMMANAGER_REGEN_OFFSET + i] = calibration->regen_custom[i]; }
+    EEPROMManager_put(image, EEPROMMANAGER_CRC_OFFSET, EEPROMManager_crc(image, EEPROMMANAGER_CRC_OFFSET));
+}
+
+//Returns FALSE for blank (0xFF), torn or old-version records
+static bool EEPROMManager_decode(const ubyte1* image, EEPROMCalibration* calibration, ubyte1* sequence)
+{
+    if (EEPROMManager_get(image, 0) != EEPROMMANAGER_MAGIC) { return FALSE; }
+    if (image[2] != EEPROMMANAGER_VERSION) { return FALSE; }
+    if (EEPROMManager_get(image, EEPROMMANAGER_CRC_OFFSET) != EEPROMManager_crc(image, EEPROMMANAGER_CRC_OFFSET)) { return FALSE; }
+
+    *sequence = image[3];
+    calibration->tps0_calibMin = EEPROMManager_get(image, 4);
+    calibration->tps0_calibMax = EEPROMManager_get(image, 6);
+    calibration->tps1_calibMin = EEPROMManager_get(image, 8);
+    calibration->tps1_calibMax = EEPROMManager_get(image, 10);
+    calibration->bps0_calibMin = EEPROMManager_get(image, 12);
+    calibration->bps0_calibMax = EEPROMManager_get(image, 14);
+    for (ubyte1 i = 0; i < sizeof(calibration->regen_custom); i++) { calibration->regen_custom[i] = image[EEPROMMANAGER_REGEN_OFFSET + i]; }
+    return TRUE;
+}
+
+static bool EEPROMManager_readSlot(ubyte1 slot, ubyte1* image)
+{
+    ubyte4 timestamp_readStart;
+
+    if (IO_EEPROM_Read((ubyte2)slot * EEPROMMANAGER_SLOT_SIZE, EEPROMMANAGER_RECORD_SIZE, image) != IO_E_OK) { return FALSE; }
+
+    IO_RTC_StartTime(&timestamp_readStart);
+    while (IO_EEPROM_GetStatus() == IO_E_BUSY)
+    {
+        if (IO_RTC_GetTimeUS(timestamp_readStart) > EEPROMMANAGER_READ_TIMEOUT_US) { return FALSE; }
+    }
+    return TRUE;
+}
+
+/*****************************************************************************
+* EEPROM manager
+****************************************************************************/
+EEPROMManager* EEPROMManager_new(SerialManager* serialMan)
+{
+    EEPROMManager* me = (EEPROMManager*)Arena_allocate(ARENA_EXTERNAL, sizeof(struct _EEPROMManager));
+    me->serialMan = serialMan;
+
+    me->calibration.tps0_calibMin = 0;
+    me->calibration.tps0_calibMax = 0;
+    me->calibration.tps1_calibMin = 0;
+    me->calibration.tps1_calibMax = 0;
+    me->calibration.bps0_calibMin = 0;
+    me->calibration.bps0_calibMax = 0;
+    for (ubyte1 i = 0; i < sizeof(me->calibration.regen_custom); i++) { me->calibration.regen_custom[i] = 0; }
+    me->calibrationValid = FALSE;
+    me->sequence = 0;
+    me->currentSlot = EEPROMMANAGER_SLOTS - 1;  //Nothing stored: first write goes to slot 0
+    me->dirty = FALSE;
+    me->writing = FALSE;
+    me->writeSlot = 0;
+    me->writeOffset = 0;
+
+    IO_EEPROM_Init();
+
+    //Use the newest valid slot
+    for (ubyte1 slot = 0; slot < EEPROMMANAGER_SLOTS; slot++)
+    {
+        EEPROMCalibration calibration;
+        ubyte1 sequence;
+
+        if (EEPROMManager_readSlot(slot, me->image) == FALSE) { continue; }
+        if (EEPROMManager_decode(me->image, &calibration, &sequence) == FALSE) { continue; }
+
+        //Sequence numbers wrap, so compare the difference
+        if (me->calibrationValid == FALSE || (sbyte1)(sequence - me->sequence) > 0)
+        {
+            me->calibration = calibration;
+            me->calibrationValid = TRUE;
+            me->sequence = sequence;
+            me->currentSlot = slot;
+        }
+    }
+
+    SerialManager_send(serialMan, (me->calibrationValid == TRUE) ? "Calibration record found in EEPROM\n" : "No valid calibration record in EEPROM\n");
+
+    return me;
+}
+
+bool EEPROMManager_getCalibration(EEPROMManager* me, EEPROMCalibration* calibration)
+{
+    *calibration = me->calibration;
+    return me->calibrationValid;
+}
+
+void EEPROMManager_setCalibration(EEPROMManager* me, const EEPROMCalibration* calibration)
+{
+    me->calibration = *calibration;
+    me->calibrationValid = TRUE;
+    me->dirty = TRUE;
+}
+
+void EEPROMManager_task(EEPROMManager* me)
+{
+    //Driver is still busy with the last chunk
+    if (IO_EEPROM_GetStatus() == IO_E_BUSY) { return; }
+
+    if (me->writing == TRUE && me->writeOffset >= EEPROMMANAGER_RECORD_SIZE)
+    {
+        me->writing = FALSE;
+        me->currentSlot = me->writeSlot;
+        SerialManager_send(me->serialMan, "Calibration saved to EEPROM\n");
+    }
+
+    if (me->writing == FALSE)
+    {
+        if (me->dirty == FALSE) { return; }
+
+        //Start a new record in the slot that doesn't hold the newest one
+        me->sequence++;
+        me->writeSlot = (me->currentSlot + 1) % EEPROMMANAGER_SLOTS;
+        EEPROMManager_encode(me->image, &me->calibration, me->sequence);
+        me->writeOffset = 0;
+        me->writing = TRUE;
+        me->dirty = FALSE;
+    }
+
+    ubyte1 chunk = EEPROMMANAGER_RECORD_SIZE - me->writeOffset;
+    if (chunk > EEPROMMANAGER_CHUNK_SIZE) { chunk = EEPROMMANAGER_CHUNK_SIZE; }
+
+    //If the driver refuses (e.g. someone else started a transfer), try the same chunk next time
+    if (IO_EEPROM_Write((ubyte2)me->writeSlot * EEPROMMANAGER_SLOT_SIZE + me->writeOffset, chunk, &me->image[me->writeOffset]) == IO_E_OK)
+    {
+        me->writeOffset += chunk;
+    }
+}
+
+bool EEPROMManager_isWriting(EEPROMManager* me)
+{
+    return (me->writing == TRUE || me->dirty == TRUE);
+}
@@ -0,0 +1,53 @@
+#ifndef _EEPROMMANAGER_H
+#define _EEPROMMANAGER_H
+
+#include "IO_Driver.h"
+#include "serial.h"
+
+/*****************************************************************************
+* EEPROM manager
+******************************************************************************
+* Keeps the pedal calibration across power cycles so we don't have to hold
+* the Eco button and sweep the pedals every time the car is turned on.  The
+* user customizable regen mode (knob position 4) is stored with it.
+*
+* The record is stored twice (slot A/B) with a version, a sequence number and
+* a CRC.  Saves always go to the older slot, so pulling power in the middle of
+* a write leaves the previous calibration intact.
+*
+* Loading happens once in EEPROMManager_new.  Saving only copies the values;
+* EEPROMManager_task writes them out a few bytes at a time whenever the
+* EEPROM driver is idle, so the main loop never waits on the EEPROM.
+****************************************************************************/
+typedef struct _EEPROMManager EEPROMManager;
+
+//Values are checked against sensor limits by whoever uses them
+//(TorqueEncoder/BrakePressureSensor/MCM_load...FromEEPROM), not here
+typedef struct _EEPROMCalibration
+{
+    ubyte2 tps0_calibMin;
+    ubyte2 tps0_calibMax;
+    ubyte2 tps1_calibMin;
+    ubyte2 tps1_calibMax;
+    ubyte2 bps0_calibMin;
+    ubyte2 bps0_calibMax;
+    ubyte1 regen_custom[4];  //Regen mode 4 settings, see MCM_setCustomRegen
+} EEPROMCalibration;
+
+//Blocks (up to EEPROMMANAGER_READ_TIMEOUT_US) while both slots are read - call during init only
+EEPROMManager* EEPROMManager_new(SerialManager* serialMan);
+
+//Copies the stored calibration into *calibration.  Returns FALSE if neither slot
+//held a valid record (calibration is then all zeros, which no sensor will accept).
+bool EEPROMManager_getCalibration(EEPROMManager* me, EEPROMCalibration* calibration);
+
+//Queues the calibration to be written.  Returns immediately; if a write is already
+//in progress the new values are written as soon as it finishes.
+void EEPROMManager_setCalibration(EEPROMManager* me, const EEPROMCalibration* calibration);
+
+//Advances any pending write by one chunk.  Never blocks - run it from the scheduler background.
+void EEPROMManager_task(EEPROMManager* me);
+
+bool EEPROMManager_isWriting(EEPROMManager* me);
+
+#endif // _EEPROMMANAGER_H
@@ -0,0 +1,67 @@
+#include "IO_Driver.h"
+#include "fixedPoint.h"
+
+/*****************************************************************************
+* Fixed-point math
+* See fixedPoint.h for the number formats.  Nothing in here divides except
+* FixedPoint_setSpan and FixedPoint_percentOf.
+****************************************************************************/
+void FixedPoint_setSpan(FixedPointSpan* span, sbyte4 start, sbyte4 end)
+{
+    span->start = start;
+    span->reverse = (end < start);
+    span->length = span->reverse ? (ubyte4)(start - end) : (ubyte4)(end - start);
+
+    //FIXEDPOINT_ONE / length in Q16 = 2^31 / length.  offset * reciprocal then
+    //stays below 2^31 for any offset inside the span, so it can't overflow.
+    span->reciprocal = (span->length == 0) ? 0 : ((ubyte4)FIXEDPOINT_ONE << 16) / span->length;
+}
+
+Q15 FixedPoint_percent(const FixedPointSpan* span, sbyte4 value)
+{
+    sbyte4 offset = span->reverse ? span->start - value : value - span->start;
+
+    if (offset <= 0 || span->length == 0) { return 0; }
+    if ((ubyte4)offset >= span->length) { return FIXEDPOINT_ONE; }
+
+    return (Q15)(((ubyte4)offset * span->reciprocal + 0x8000) >> 16);
+}
+
+Q15 FixedPoint_percentOf(sbyte4 value, sbyte4 start, sbyte4 end)
+{
+    FixedPointSpan span;
+    FixedPoint_setSpan(&span, start, end);
+    return FixedPoint_percent(&span, value);
+}
+
+sbyte4 FixedPoint_mul(sbyte4 value, Q15 fraction)
+{
+    //Work on the magnitude so the shift rounds the same way for regen (negative) torque
+    if (value < 0)
+    {
+        return 0 - (sbyte4)(((ubyte4)(0 - value) * fraction) >> 15);
+    }
+    return (sbyte4)(((ubyte4)value * fraction) >> 15);
+}
+
+Q15 FixedPoint_mulQ15(Q15 a, Q15 b)
+{
+    return (Q15)(((ubyte4)a * b + 0x4000) >> 15);
+}
+
+sbyte4 FixedPoint_lerp(sbyte4 from, sbyte4 to, Q15 fraction)
+{
+    return from + FixedPoint_mul(to - from, fraction);
+}
+
+sbyte4 FixedPoint_clamp(sbyte4 value, sbyte4 min, sbyte4 max)
+{
+    if (value < min) { return min; }
+    if (value > max) { return max; }
+    return value;
+}
+
+ubyte2 FixedPoint_toDuty(Q15 fraction)
+{
+    return (fraction >= FIXEDPOINT_ONE) ? 0xFFFF : (ubyte2)(fraction << 1);
+}
@@ -0,0 +1,65 @@
+#ifndef _FIXEDPOINT_H
+#define _FIXEDPOINT_H
+
+#include "IO_Driver.h"
+
+/*****************************************************************************
+* Fixed-point math
+******************************************************************************
+* The XC2000 has no FPU, so every float4 operation is a library call.  Anything
+* that runs every cycle (pedals -> torque -> safety, cooling, telemetry) should
+* use these instead of float4 / getPercent.
+*
+* Q15 (ubyte2): a fraction from 0 to 1, where FIXEDPOINT_ONE (0x8000) = 100%.
+*               Used for pedal travel, torque multipliers, duty cycles, etc.
+* Q16 (ubyte4): unsigned 16.16.  Used for the precomputed reciprocal in a
+*               FixedPointSpan, so turning a reading into a percent is one
+*               multiply and a shift instead of a divide.
+*
+* Q15(x) converts a constant - only use it with literals so it folds at
+* compile time (e.g. "if (tps->percent > Q15(.25))").
+****************************************************************************/
+typedef ubyte2 Q15;
+typedef ubyte4 Q16;
+
+#define FIXEDPOINT_ONE ((Q15)0x8000)
+#define Q15(x) ((Q15)((x) * 32768.0 + 0.5))
+
+//A calibration range (e.g. TPS min/max).  Set it up once with FixedPoint_setSpan
+//whenever the range changes; FixedPoint_percent can then be called every cycle.
+typedef struct _FixedPointSpan
+{
+    sbyte4 start;       //Reading that is 0%
+    ubyte4 length;      //|end - start|
+    bool reverse;       //TRUE if end < start (reading goes down as percent goes up)
+    Q16 reciprocal;     //FIXEDPOINT_ONE / length.  0 if length == 0
+} FixedPointSpan;
+
+void FixedPoint_setSpan(FixedPointSpan* span, sbyte4 start, sbyte4 end);
+
+/*-------------------------------------------------------------------
+* FixedPoint_percent
+* Returns the position of value between the span's start and end, saturated
+* to 0..FIXEDPOINT_ONE.  Like getPercent(..., TRUE), but returns 0 when the
+* span has no length instead of dividing by zero.
+-------------------------------------------------------------------*/
+Q15 FixedPoint_percent(const FixedPointSpan* span, sbyte4 value);
+
+//Same as FixedPoint_percent, for ranges that aren't worth caching (costs a divide)
+Q15 FixedPoint_percentOf(sbyte4 value, sbyte4 start, sbyte4 end);
+
+//value * fraction, rounded toward zero.  |value| must be below 65536.
+sbyte4 FixedPoint_mul(sbyte4 value, Q15 fraction);
+
+//Q15 * Q15 (e.g. combining two multipliers)
+Q15 FixedPoint_mulQ15(Q15 a, Q15 b);
+
+//from + (to - from) * fraction.  |to - from| must be below 65536.
+sbyte4 FixedPoint_lerp(sbyte4 from, sbyte4 to, Q15 fraction);
+
+sbyte4 FixedPoint_clamp(sbyte4 value, sbyte4 min, sbyte4 max);
+
+//Q15 -> IO_PWM duty (0..65535)
+ubyte2 FixedPoint_toDuty(Q15 fraction);
+
+#endif // _FIXEDPOINT_H
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "IO_Driver.h"
+#include "hostBench.h"
+
+//Deepest nesting of wrapped calls (e.g. canOutput_sendDebugMessage -> CanManager_send)
+#define HOSTBENCH_MAX_DEPTH 16
+
+static HostBenchStat stats[HOSTBENCH_MAX_FUNCTIONS];
+static ubyte1 statCount = 0;
+
+//Wrapped functions currently running, innermost last (mallocs are charged to the innermost)
+static ubyte1 activeSlots[HOSTBENCH_MAX_DEPTH];
+static ubyte1 activeDepth = 0;
+
+static bool mainLoop = FALSE;
+static ubyte4 initAllocations = 0;
+static ubyte4 initBytes = 0;
+static ubyte4 mainLoopAllocations = 0;
+static ubyte4 mainLoopBytes = 0;
+
+static uint64_t HostBench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+HostBenchTimer HostBench_begin(const char* name, ubyte1* slot)
+{
+    HostBenchTimer timer;
+
+    if (*slot == HOSTBENCH_NO_SLOT)
+    {
+        if (statCount >= HOSTBENCH_MAX_FUNCTIONS)
+        {
+            fprintf(stderr, "hostBench: more than %u wrapped functions\n", HOSTBENCH_MAX_FUNCTIONS);
+            exit(2);
+        }
+        stats[statCount].name = name;
+        *slot = statCount++;
+    }
+
+    if (activeDepth < HOSTBENCH_MAX_DEPTH) { activeSlots[activeDepth] = *slot; }
+    activeDepth++;
+
+    timer.slot = *slot;
+    timer.start_ns = HostBench_now();
+    return timer;
+}
+
+void HostBench_end(const HostBenchTimer* timer)
+{
+    uint64_t elapsed = HostBench_now() - timer->start_ns;
+    HostBenchStat* stat = &stats[timer->slot];
+
+    stat->calls++;
+    stat->total_ns += elapsed;
+    if (elapsed > stat->max_ns) { stat->max_ns = elapsed; }
+
+    activeDepth--;
+}
+
+void HostBench_startMainLoop(void)
+{
+    mainLoop = TRUE;
+}
+
+ubyte4 HostBench_getMainLoopAllocations(void)
+{
+    return mainLoopAllocations;
+}
+
+/*-------------------------------------------------------------------
+* malloc (linked with -Wl,--wrap=malloc)
+-------------------------------------------------------------------*/
+void* __real_malloc(size_t size);
+
+void* __wrap_malloc(size_t size)
+{
+    if (mainLoop == TRUE)
+    {
+        mainLoopAllocations++;
+        mainLoopBytes += size;
+    }
+    else
+    {
+        initAllocations++;
+        initBytes += size;
+    }
+
+    if (activeDepth > 0 && activeDepth <= HOSTBENCH_MAX_DEPTH) { stats[activeSlots[activeDepth - 1]].allocations++; }
+
+    return __real_malloc(size);
+}
+
+/*-------------------------------------------------------------------
+* Report
+-------------------------------------------------------------------*/
+void HostBench_report(FILE* out, ubyte4 ticks)
+{
+    fprintf(out, "Allocations: init %lu (%lu bytes), main loop %lu (%lu bytes)\n"
+        , (unsigned long)initAllocations, (unsigned long)initBytes
+        , (unsigned long)mainLoopAllocations, (unsigned long)mainLoopBytes);
+
+    fprintf(out, "%-40s %9s %10s %10s %10s %7s\n", "function", "calls", "avg ns", "max ns", "ns/tick", "allocs");
+    for (ubyte1 i = 0; i < statCount; i++)
+    {
+        const HostBenchStat* stat = &stats[i];
+        fprintf(out, "%-40s %9lu %10lu %10lu %10lu %7lu\n"
+            , stat->name
+            , (unsigned long)stat->calls
+            , (unsigned long)(stat->calls == 0 ? 0 : stat->total_ns / stat->calls)
+            , (unsigned long)stat->max_ns
+            , (unsigned long)(ticks == 0 ? 0 : stat->total_ns / ticks)
+            , (unsigned long)stat->allocations);
+    }
+}
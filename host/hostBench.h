@@ -0,0 +1,76 @@
+#ifndef _HOSTBENCH_H
+#define _HOSTBENCH_H
+
+#include <stdio.h>
+#include "IO_Driver.h"
+
+/*****************************************************************************
+* Per-function cost and allocation counts (host replay build)
+******************************************************************************
+* Functions listed in hostWrappers.c are linked with -Wl,--wrap, so every
+* call from the firmware goes through a wrapper that times it (wall clock,
+* inclusive of anything it calls) and counts the mallocs made inside it.
+* malloc itself is wrapped too, so initialization and main loop allocations
+* are counted separately - the main loop should never allocate.
+****************************************************************************/
+#define HOSTBENCH_MAX_FUNCTIONS 48
+#define HOSTBENCH_NO_SLOT 0xFF
+
+typedef struct _HostBenchTimer
+{
+    ubyte1 slot;
+    uint64_t start_ns;
+} HostBenchTimer;
+
+//Cost of one function (or of a whole tick - see replay.c)
+typedef struct _HostBenchStat
+{
+    const char* name;
+    ubyte4 calls;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    ubyte4 allocations;
+} HostBenchStat;
+
+//*slot caches the function's row (start it at HOSTBENCH_NO_SLOT)
+HostBenchTimer HostBench_begin(const char* name, ubyte1* slot);
+void HostBench_end(const HostBenchTimer* timer);
+
+//Stop counting allocations as "init" (call when the main loop starts)
+void HostBench_startMainLoop(void);
+
+void HostBench_report(FILE* out, ubyte4 ticks);
+
+//Allocations made by the main loop (should be 0)
+ubyte4 HostBench_getMainLoopAllocations(void);
+
+/*-------------------------------------------------------------------
+* Wrapper definitions (see hostWrappers.c).  The Makefile collects the
+* first argument of each line to build the -Wl,--wrap list.
+* __real_/__wrap_ are declared from the firmware header's prototype, so
+* params that don't match it are a "conflicting types" error.
+-------------------------------------------------------------------*/
+#define HOSTBENCH_WRAP_VOID(function, params, args) \
+    __typeof__(function) __real_##function; \
+    __typeof__(function) __wrap_##function; \
+    void __wrap_##function params \
+    { \
+        static ubyte1 slot = HOSTBENCH_NO_SLOT; \
+        HostBenchTimer timer = HostBench_begin(#function, &slot); \
+        __real_##function args; \
+        HostBench_end(&timer); \
+    }
+
+#define HOSTBENCH_WRAP(function, type, params, args) \
+    __typeof__(function) __real_##function; \
+    __typeof__(function) __wrap_##function; \
+    type __wrap_##function params \
+    { \
+        static ubyte1 slot = HOSTBENCH_NO_SLOT; \
+        HostBenchTimer timer = HostBench_begin(#function, &slot); \
+        type result = __real_##function args; \
+        HostBench_end(&timer); \
+        return result; \
+    }
+
+#endif // _HOSTBENCH_H
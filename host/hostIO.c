@@ -0,0 +1,438 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "IO_Driver.h"
+#include "IO_ADC.h"
+#include "IO_CAN.h"
+#include "IO_DIO.h"
+#include "IO_PWD.h"
+#include "IO_PWM.h"
+#include "IO_RTC.h"
+#include "IO_UART.h"
+#include "IO_EEPROM.h"
+
+#include "hostIO.h"
+
+#define HOSTIO_CHANNELS 256
+
+#define HOSTIO_CAN_FIFOS 16
+#define HOSTIO_CAN_FIFO_MAX 128    //Message objects on the TTC 50 (all FIFOs together)
+
+#define HOSTIO_EEPROM_SIZE 0x2000
+
+//Longest busy wait allowed while the clock is stepped
+#define HOSTIO_MAX_CALLS_PER_STEP 1000000
+//Longest init allowed while the clock is free running (e.g. Arena_allocate halting)
+#define HOSTIO_MAX_INIT_US 10000000
+
+#define HOSTIO_UART_LINE 256
+
+/*-------------------------------------------------------------------
+* Channel names (for traces and the output log)
+-------------------------------------------------------------------*/
+typedef struct _HostIOChannelName
+{
+    const char* name;
+    ubyte1 channel;
+} HostIOChannelName;
+
+#define HOSTIO_CHANNEL(name) { #name, name }
+
+static const HostIOChannelName channelNames[] =
+{
+      HOSTIO_CHANNEL(IO_ADC_5V_00), HOSTIO_CHANNEL(IO_ADC_5V_01), HOSTIO_CHANNEL(IO_ADC_5V_02), HOSTIO_CHANNEL(IO_ADC_5V_03)
+    , HOSTIO_CHANNEL(IO_ADC_5V_04), HOSTIO_CHANNEL(IO_ADC_5V_05), HOSTIO_CHANNEL(IO_ADC_5V_06), HOSTIO_CHANNEL(IO_ADC_5V_07)
+    , HOSTIO_CHANNEL(IO_ADC_CUR_00), HOSTIO_CHANNEL(IO_ADC_CUR_01), HOSTIO_CHANNEL(IO_ADC_CUR_02), HOSTIO_CHANNEL(IO_ADC_CUR_03)
+    , HOSTIO_CHANNEL(IO_ADC_UBAT)
+    , HOSTIO_CHANNEL(IO_ADC_SENSOR_SUPPLY_0), HOSTIO_CHANNEL(IO_ADC_SENSOR_SUPPLY_1), HOSTIO_CHANNEL(IO_SENSOR_SUPPLY_VAR), HOSTIO_CHANNEL(IO_PIN_269)
+    , HOSTIO_CHANNEL(IO_DO_00), HOSTIO_CHANNEL(IO_DO_01), HOSTIO_CHANNEL(IO_DO_02), HOSTIO_CHANNEL(IO_DO_03)
+    , HOSTIO_CHANNEL(IO_DO_04), HOSTIO_CHANNEL(IO_DO_05), HOSTIO_CHANNEL(IO_DO_06), HOSTIO_CHANNEL(IO_DO_07)
+    , HOSTIO_CHANNEL(IO_DI_00), HOSTIO_CHANNEL(IO_DI_01), HOSTIO_CHANNEL(IO_DI_02), HOSTIO_CHANNEL(IO_DI_03)
+    , HOSTIO_CHANNEL(IO_DI_04), HOSTIO_CHANNEL(IO_DI_05), HOSTIO_CHANNEL(IO_DI_06), HOSTIO_CHANNEL(IO_DI_07)
+    , HOSTIO_CHANNEL(IO_PWD_08), HOSTIO_CHANNEL(IO_PWD_09), HOSTIO_CHANNEL(IO_PWD_10), HOSTIO_CHANNEL(IO_PWD_11)
+    , HOSTIO_CHANNEL(IO_PWM_00), HOSTIO_CHANNEL(IO_PWM_01), HOSTIO_CHANNEL(IO_PWM_02), HOSTIO_CHANNEL(IO_PWM_03)
+    , HOSTIO_CHANNEL(IO_PWM_04), HOSTIO_CHANNEL(IO_PWM_05), HOSTIO_CHANNEL(IO_PWM_06), HOSTIO_CHANNEL(IO_PWM_07)
+};
+
+#define HOSTIO_CHANNEL_NAME_COUNT (sizeof(channelNames) / sizeof(channelNames[0]))
+
+bool HostIO_findChannel(const char* name, ubyte1* channel)
+{
+    for (ubyte1 i = 0; i < HOSTIO_CHANNEL_NAME_COUNT; i++)
+    {
+        if (strcmp(channelNames[i].name, name) == 0)
+        {
+            *channel = channelNames[i].channel;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static const char* HostIO_channelName(ubyte1 channel)
+{
+    for (ubyte1 i = 0; i < HOSTIO_CHANNEL_NAME_COUNT; i++)
+    {
+        if (channelNames[i].channel == channel) { return channelNames[i].name; }
+    }
+    return "?";
+}
+
+/*-------------------------------------------------------------------
+* State
+-------------------------------------------------------------------*/
+typedef struct _HostIOFifo
+{
+    ubyte1 channel;
+    ubyte1 mode;            //IO_CAN_MSG_READ / IO_CAN_MSG_WRITE
+    ubyte1 size;
+    ubyte4 id;
+    ubyte4 mask;
+
+    IO_CAN_DATA_FRAME frames[HOSTIO_CAN_FIFO_MAX];
+    ubyte1 head;            //Oldest frame
+    ubyte1 count;
+    bool overflowed;        //Frames lost since the last read
+} HostIOFifo;
+
+static FILE* hostLog = NULL;
+
+static ubyte4 hostTime = 0;
+static bool hostFreeRunning = TRUE;
+static ubyte4 hostCallsThisStep = 0;
+
+static ubyte2 hostADC[HOSTIO_CHANNELS];
+static bool hostDI[HOSTIO_CHANNELS];
+static ubyte2 hostPWD[HOSTIO_CHANNELS];
+
+//Last value written, so only changes are logged.  -1 = never written.
+static sbyte4 hostDO[HOSTIO_CHANNELS];
+static sbyte4 hostPWM[HOSTIO_CHANNELS];
+static bool hostOutputsInitialized = FALSE;
+
+static HostIOFifo hostFifos[HOSTIO_CAN_FIFOS];
+static ubyte1 hostFifoCount = 0;
+static ubyte4 hostCANOverflows = 0;
+
+static ubyte1 hostEEPROM[HOSTIO_EEPROM_SIZE];
+
+static char hostUARTLine[HOSTIO_UART_LINE];
+static ubyte2 hostUARTLength = 0;
+
+static void HostIO_initializeOutputs(void)
+{
+    if (hostOutputsInitialized == TRUE) { return; }
+    for (ubyte2 i = 0; i < HOSTIO_CHANNELS; i++)
+    {
+        hostDO[i] = -1;
+        hostPWM[i] = -1;
+    }
+    hostOutputsInitialized = TRUE;
+}
+
+void HostIO_setLog(FILE* log)
+{
+    hostLog = log;
+}
+
+static void HostIO_log(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+static void HostIO_log(const char* format, ...)
+{
+    va_list args;
+    if (hostLog == NULL) { return; }
+
+    fprintf(hostLog, "%10lu ", (unsigned long)hostTime);
+    va_start(args, format);
+    vfprintf(hostLog, format, args);
+    va_end(args);
+    fputc('\n', hostLog);
+}
+
+/*-------------------------------------------------------------------
+* Clock
+-------------------------------------------------------------------*/
+void HostIO_setFreeRunning(bool freeRunning)
+{
+    hostFreeRunning = freeRunning;
+}
+
+void HostIO_setTime(ubyte4 time_us)
+{
+    hostTime = time_us;
+    hostCallsThisStep = 0;
+
+    //Everything queued for sending went out on the bus since the last step
+    for (ubyte1 i = 0; i < hostFifoCount; i++)
+    {
+        if (hostFifos[i].mode == IO_CAN_MSG_WRITE) { hostFifos[i].count = 0; }
+    }
+}
+
+ubyte4 HostIO_getTime(void)
+{
+    return hostTime;
+}
+
+IO_ErrorType IO_RTC_StartTime(ubyte4* timestamp)
+{
+    *timestamp = hostTime;
+    return IO_E_OK;
+}
+
+ubyte4 IO_RTC_GetTimeUS(ubyte4 timestamp)
+{
+    if (hostFreeRunning == TRUE)
+    {
+        if (++hostTime > HOSTIO_MAX_INIT_US)
+        {
+            if (hostUARTLength > 0) { hostUARTLine[hostUARTLength] = '\0'; }  //Else the last complete line
+            fprintf(stderr, "hostIO: init still running after %u us - halted?  Last UART line: %s\n", HOSTIO_MAX_INIT_US, hostUARTLine);
+            exit(2);
+        }
+    }
+    else if (++hostCallsThisStep > HOSTIO_MAX_CALLS_PER_STEP)
+    {
+        fprintf(stderr, "hostIO: IO_RTC_GetTimeUS called %u times in one tick - busy wait in the main loop?\n", HOSTIO_MAX_CALLS_PER_STEP);
+        exit(2);
+    }
+    return hostTime - timestamp;
+}
+
+/*-------------------------------------------------------------------
+* Driver
+-------------------------------------------------------------------*/
+IO_ErrorType IO_Driver_Init(void* safety_conf)
+{
+    HostIO_initializeOutputs();
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_Driver_TaskBegin(void) { return IO_E_OK; }
+IO_ErrorType IO_Driver_TaskEnd(void) { return IO_E_OK; }
+
+/*-------------------------------------------------------------------
+* Inputs
+-------------------------------------------------------------------*/
+void HostIO_setADC(ubyte1 channel, ubyte2 value) { hostADC[channel] = value; }
+void HostIO_setDI(ubyte1 channel, bool value) { hostDI[channel] = value; }
+void HostIO_setPWD(ubyte1 channel, ubyte2 frequency) { hostPWD[channel] = frequency; }
+
+IO_ErrorType IO_ADC_ChannelInit(ubyte1 adc_channel, ubyte1 type, ubyte1 range, ubyte1 pupd, ubyte1 sensor_supply, void* safety_conf) { return IO_E_OK; }
+IO_ErrorType IO_ADC_ChannelDeInit(ubyte1 adc_channel) { return IO_E_OK; }
+IO_ErrorType IO_POWER_Set(ubyte1 pin, ubyte1 mode) { return IO_E_OK; }
+
+IO_ErrorType IO_ADC_Get(ubyte1 adc_channel, ubyte2* adc_value, bool* fresh)
+{
+    *adc_value = hostADC[adc_channel];
+    *fresh = TRUE;
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_DI_Init(ubyte1 di_channel, ubyte1 pupd) { return IO_E_OK; }
+IO_ErrorType IO_DI_DeInit(ubyte1 di_channel) { return IO_E_OK; }
+
+IO_ErrorType IO_DI_Get(ubyte1 di_channel, bool* di_value)
+{
+    *di_value = hostDI[di_channel];
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_PWD_FreqInit(ubyte1 timer_channel, ubyte1 freq_mode) { return IO_E_OK; }
+IO_ErrorType IO_PWD_PulseInit(ubyte1 timer_channel, ubyte1 pulse_mode) { return IO_E_OK; }
+
+IO_ErrorType IO_PWD_FreqGet(ubyte1 timer_channel, ubyte2* frequency)
+{
+    *frequency = hostPWD[timer_channel];
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_PWD_PulseGet(ubyte1 timer_channel, ubyte4* pulse_time)
+{
+    *pulse_time = 0;
+    return IO_E_OK;
+}
+
+/*-------------------------------------------------------------------
+* Outputs
+-------------------------------------------------------------------*/
+IO_ErrorType IO_DO_Init(ubyte1 do_channel) { return IO_E_OK; }
+
+IO_ErrorType IO_DO_Set(ubyte1 do_channel, bool do_value)
+{
+    HostIO_initializeOutputs();
+    sbyte4 value = (do_value == FALSE) ? 0 : 1;
+    if (hostDO[do_channel] != value)
+    {
+        hostDO[do_channel] = value;
+        HostIO_log("DO   %s %d", HostIO_channelName(do_channel), value);
+    }
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_PWM_Init(ubyte1 pwm_channel, ubyte2 frequency, bool polarity, bool diag_margin, ubyte1 current_measurement, bool current_control, void* safety_conf) { return IO_E_OK; }
+
+IO_ErrorType IO_PWM_SetDuty(ubyte1 pwm_channel, ubyte2 duty_cycle, ubyte2* current)
+{
+    HostIO_initializeOutputs();
+    if (hostPWM[pwm_channel] != duty_cycle)
+    {
+        hostPWM[pwm_channel] = duty_cycle;
+        HostIO_log("PWM  %s %u", HostIO_channelName(pwm_channel), duty_cycle);
+    }
+    if (current != NULL) { *current = 0; }
+    return IO_E_OK;
+}
+
+/*-------------------------------------------------------------------
+* CAN
+-------------------------------------------------------------------*/
+IO_ErrorType IO_CAN_Init(ubyte1 channel, ubyte2 baudrate, ubyte1 tseg1, ubyte1 tseg2, ubyte1 sjw) { return IO_E_OK; }
+
+IO_ErrorType IO_CAN_ConfigFIFO(ubyte1* handle, ubyte1 channel, ubyte1 size, ubyte1 mode, ubyte1 id_format, ubyte4 id, ubyte4 ac_mask)
+{
+    if (hostFifoCount >= HOSTIO_CAN_FIFOS || size == 0 || size > HOSTIO_CAN_FIFO_MAX) { return IO_E_INVALID_PARAMETER; }
+
+    HostIOFifo* fifo = &hostFifos[hostFifoCount];
+    fifo->channel = channel;
+    fifo->mode = mode;
+    fifo->size = size;
+    fifo->id = id;
+    fifo->mask = ac_mask;
+    fifo->head = 0;
+    fifo->count = 0;
+    fifo->overflowed = FALSE;
+
+    *handle = hostFifoCount++;
+    return IO_E_OK;
+}
+
+bool HostIO_receiveCAN(ubyte1 channel, const IO_CAN_DATA_FRAME* frame)
+{
+    for (ubyte1 i = 0; i < hostFifoCount; i++)
+    {
+        HostIOFifo* fifo = &hostFifos[i];
+        if (fifo->channel != channel || fifo->mode != IO_CAN_MSG_READ) { continue; }
+        if ((frame->id & fifo->mask) != (fifo->id & fifo->mask)) { continue; }
+
+        if (fifo->count >= fifo->size)
+        {
+            fifo->overflowed = TRUE;
+            hostCANOverflows++;
+        }
+        else
+        {
+            fifo->frames[(fifo->head + fifo->count) % fifo->size] = *frame;
+            fifo->count++;
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+
+ubyte4 HostIO_getCANOverflows(void)
+{
+    return hostCANOverflows;
+}
+
+IO_ErrorType IO_CAN_ReadFIFO(ubyte1 handle, IO_CAN_DATA_FRAME* buffer, ubyte1 buffer_size, ubyte1* rx_frames)
+{
+    if (handle >= hostFifoCount || hostFifos[handle].mode != IO_CAN_MSG_READ) { return IO_E_CAN_WRONG_HANDLE; }
+    HostIOFifo* fifo = &hostFifos[handle];
+
+    *rx_frames = 0;
+    while (*rx_frames < buffer_size && fifo->count > 0)
+    {
+        buffer[(*rx_frames)++] = fifo->frames[fifo->head];
+        fifo->head = (fifo->head + 1) % fifo->size;
+        fifo->count--;
+    }
+
+    if (fifo->overflowed == TRUE)
+    {
+        fifo->overflowed = FALSE;
+        return IO_E_CAN_OVERFLOW;
+    }
+    return (*rx_frames == 0) ? IO_E_CAN_OLD_DATA : IO_E_OK;
+}
+
+IO_ErrorType IO_CAN_WriteFIFO(ubyte1 handle, const IO_CAN_DATA_FRAME* data, ubyte1 length)
+{
+    if (handle >= hostFifoCount || hostFifos[handle].mode != IO_CAN_MSG_WRITE) { return IO_E_CAN_WRONG_HANDLE; }
+    HostIOFifo* fifo = &hostFifos[handle];
+
+    //All or nothing, like the driver
+    if (fifo->count + length > fifo->size) { return IO_E_CAN_FIFO_FULL; }
+    fifo->count += length;
+
+    for (ubyte1 i = 0; i < length; i++)
+    {
+        char bytes[3 * 8 + 1] = "";
+        for (ubyte1 b = 0; b < data[i].length && b < 8; b++)
+        {
+            sprintf(&bytes[3 * b], " %02X", data[i].data[b]);
+        }
+        HostIO_log("CAN%u %03lX %u%s", fifo->channel, (unsigned long)data[i].id, data[i].length, bytes);
+    }
+    return IO_E_OK;
+}
+
+/*-------------------------------------------------------------------
+* UART (logged a line at a time)
+-------------------------------------------------------------------*/
+IO_ErrorType IO_UART_Init(ubyte1 channel, ubyte4 baudrate, ubyte1 dbits, ubyte1 par, ubyte1 sbits) { return IO_E_OK; }
+IO_ErrorType IO_UART_Task(void) { return IO_E_OK; }
+
+IO_ErrorType IO_UART_Write(ubyte1 channel, const ubyte1* data, ubyte1 len, ubyte1* tx_len)
+{
+    for (ubyte1 i = 0; i < len; i++)
+    {
+        if (data[i] == '\n' || hostUARTLength >= HOSTIO_UART_LINE - 1)
+        {
+            hostUARTLine[hostUARTLength] = '\0';
+            if (hostUARTLength > 0) { HostIO_log("UART %s", hostUARTLine); }
+            hostUARTLength = 0;
+            if (data[i] == '\n') { continue; }
+        }
+        if (data[i] != '\r') { hostUARTLine[hostUARTLength++] = (char)data[i]; }
+    }
+    *tx_len = len;
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_UART_GetTxStatus(ubyte1 channel, ubyte1* tx_len)
+{
+    *tx_len = 0;
+    return IO_E_OK;
+}
+
+/*-------------------------------------------------------------------
+* EEPROM (blank, transfers finish immediately)
+-------------------------------------------------------------------*/
+IO_ErrorType IO_EEPROM_Init(void)
+{
+    memset(hostEEPROM, 0xFF, sizeof(hostEEPROM));
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_EEPROM_Read(ubyte2 offset, ubyte2 length, ubyte1* data)
+{
+    if ((ubyte4)offset + length > HOSTIO_EEPROM_SIZE) { return IO_E_EEPROM_RANGE; }
+    memcpy(data, &hostEEPROM[offset], length);
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_EEPROM_Write(ubyte2 offset, ubyte2 length, const ubyte1* data)
+{
+    if ((ubyte4)offset + length > HOSTIO_EEPROM_SIZE) { return IO_E_EEPROM_RANGE; }
+    memcpy(&hostEEPROM[offset], data, length);
+    HostIO_log("EEPROM %04X %u", offset, length);
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_EEPROM_GetStatus(void)
+{
+    return IO_E_OK;
+}
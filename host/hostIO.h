@@ -0,0 +1,50 @@
+#ifndef _HOSTIO_H
+#define _HOSTIO_H
+
+#include <stdio.h>
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+/*****************************************************************************
+* Simulated IO for the host replay build
+******************************************************************************
+* Implements the stub IO driver headers in host/stubs.  The replay harness
+* sets the inputs (ADC counts, digital inputs, wheel speed frequencies,
+* received CAN frames) and the clock; everything the firmware drives (CAN
+* frames sent, digital outputs, PWM duty, serial text) is written to the
+* output log, one line per event, stamped with the simulated time.
+*
+* Clock:
+*   Free running - every IO_RTC_GetTimeUS call advances the clock by 1 us, so
+*                  the blocking loops in main()'s init sequence finish.
+*   Stepped      - the clock only moves when the harness calls
+*                  HostIO_setTime, so a tick sees one constant time.  A busy
+*                  wait in the main loop would never finish, so it is
+*                  reported as an error instead.
+*
+* CAN receive: a frame goes to the first read FIFO on its channel whose
+* filter matches ((id & mask) == (filter id & mask)), in configuration
+* order - the same as the driver's message object priority.  Write FIFOs
+* are emptied ("sent on the bus") each time the clock is stepped.
+****************************************************************************/
+
+void HostIO_setLog(FILE* log);
+
+void HostIO_setFreeRunning(bool freeRunning);
+void HostIO_setTime(ubyte4 time_us);
+ubyte4 HostIO_getTime(void);
+
+//Looks up a channel constant by name (e.g. "IO_ADC_5V_00").  FALSE if unknown.
+bool HostIO_findChannel(const char* name, ubyte1* channel);
+
+void HostIO_setADC(ubyte1 channel, ubyte2 value);
+void HostIO_setDI(ubyte1 channel, bool value);
+void HostIO_setPWD(ubyte1 channel, ubyte2 frequency);
+
+//Delivers a frame as if it had been received on the bus.  FALSE if no FIFO took it.
+bool HostIO_receiveCAN(ubyte1 channel, const IO_CAN_DATA_FRAME* frame);
+
+//Frames lost because a receive FIFO was full
+ubyte4 HostIO_getCANOverflows(void);
+
+#endif // _HOSTIO_H
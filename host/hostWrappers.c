@@ -0,0 +1,60 @@
+//Functions timed by the replay benchmark (see hostBench.h).
+//One line per function.  The Makefile builds the -Wl,--wrap list from the first argument.
+#include "hostBench.h"
+
+#include "IO_CAN.h"
+#include "scheduler.h"
+#include "sensors.h"
+#include "canManager.h"
+#include "motorController.h"
+#include "readyToDriveSound.h"
+#include "torqueEncoder.h"
+#include "brakePressureSensor.h"
+#include "wheelSpeeds.h"
+#include "safety.h"
+#include "bms.h"
+#include "cooling.h"
+#include "serial.h"
+#include "eepromManager.h"
+#include "dataLogger.h"
+#include "vehicleState.h"
+
+//Whole tick (periodic tasks + one pass of the background tasks)
+HOSTBENCH_WRAP_VOID(Scheduler_step, (Scheduler* me), (me))
+
+//Fast task
+HOSTBENCH_WRAP_VOID(sensors_updateSensors, (void), ())
+HOSTBENCH_WRAP_VOID(CanManager_readPriority, (CanManager* me), (me))
+HOSTBENCH_WRAP_VOID(WheelSpeeds_update, (WheelSpeeds* me), (me))
+HOSTBENCH_WRAP_VOID(TorqueEncoder_update, (TorqueEncoder* me), (me))
+HOSTBENCH_WRAP_VOID(TorqueEncoder_calibrationCycle, (TorqueEncoder* me, ubyte1* errorCount), (me, errorCount))
+HOSTBENCH_WRAP_VOID(BrakePressureSensor_update, (BrakePressureSensor* me, bool bench), (me, bench))
+HOSTBENCH_WRAP_VOID(BrakePressureSensor_calibrationCycle, (BrakePressureSensor* me, ubyte1* errorCount), (me, errorCount))
+HOSTBENCH_WRAP_VOID(MCM_calculateCommands, (MotorController* mcm, const VehicleState* state), (mcm, state))
+HOSTBENCH_WRAP_VOID(SafetyChecker_updateFast, (SafetyChecker* me, const VehicleState* state), (me, state))
+HOSTBENCH_WRAP_VOID(SafetyChecker_reduceTorque, (SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms), (me, mcm, bms))
+HOSTBENCH_WRAP_VOID(MCM_relayControl, (MotorController* mcm, Sensor* HVILTermSense), (mcm, HVILTermSense))
+HOSTBENCH_WRAP_VOID(MCM_inverterControl, (MotorController* mcm, TorqueEncoder* tps, BrakePressureSensor* bps, ReadyToDriveSound* rtds), (mcm, tps, bps, rtds))
+HOSTBENCH_WRAP_VOID(canOutput_sendMCMCommand, (CanManager* me, const VehicleState* state), (me, state))
+HOSTBENCH_WRAP_VOID(DataLogger_record, (DataLogger* me, const VehicleState* state), (me, state))
+
+//Medium task
+HOSTBENCH_WRAP_VOID(CanManager_read, (CanManager* me, CanChannel channel), (me, channel))
+HOSTBENCH_WRAP_VOID(MCM_readTCSSettings, (MotorController* me, Sensor* TCSSwitchUp, Sensor* TCSSwitchDown, Sensor* TCSPot), (me, TCSSwitchUp, TCSSwitchDown, TCSPot))
+HOSTBENCH_WRAP_VOID(SafetyChecker_update, (SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, const VehicleState* state), (me, mcm, bms, state))
+HOSTBENCH_WRAP_VOID(RTDS_shutdownHelper, (ReadyToDriveSound* rtds), (rtds))
+HOSTBENCH_WRAP_VOID(DataLogger_task, (DataLogger* me, CanManager* canMan), (me, canMan))
+
+//Slow task
+HOSTBENCH_WRAP_VOID(CoolingSystem_calculations, (CoolingSystem* me, sbyte2 motorControllerTemp, sbyte2 motorTemp, sbyte1 batteryTemp, sbyte4 motorPowerW, sbyte4 batteryPowerW), (me, motorControllerTemp, motorTemp, batteryTemp, motorPowerW, batteryPowerW))
+HOSTBENCH_WRAP_VOID(CoolingSystem_enactCooling, (CoolingSystem* me), (me))
+HOSTBENCH_WRAP_VOID(canOutput_sendDebugMessage, (CanManager* me, const VehicleState* state, TorqueEncoder* tps, BrakePressureSensor* bps, MotorController* mcm), (me, state, tps, bps, mcm))
+HOSTBENCH_WRAP_VOID(CanManager_publishBusStats, (CanManager* me), (me))
+
+//Receive handlers (called through CanManager's receiver table)
+HOSTBENCH_WRAP_VOID(MCM_parseCanMessage, (MotorController* mcm, IO_CAN_DATA_FRAME* mcmCanMessage), (mcm, mcmCanMessage))
+HOSTBENCH_WRAP_VOID(BMS_parseCanMessage, (BatteryManagementSystem* bms, IO_CAN_DATA_FRAME* bmsCanMessage), (bms, bmsCanMessage))
+
+//Background
+HOSTBENCH_WRAP_VOID(SerialManager_task, (SerialManager* me), (me))
+HOSTBENCH_WRAP_VOID(EEPROMManager_task, (EEPROMManager* me), (me))
@@ -0,0 +1,341 @@
+/*****************************************************************************
+* Host replay benchmark
+******************************************************************************
+* Runs the VCU firmware on a PC against the simulated IO in hostIO.c:
+*   1. Inputs at t = 0 from the trace are applied, then the firmware's main()
+*      runs its normal init sequence (free running clock).
+*   2. main() hands its scheduler to Scheduler_run, which is wrapped here to
+*      return instead of looping forever.
+*   3. The harness then steps one 5 ms tick at a time (Scheduler_step),
+*      applying each trace event before the first tick at or after its time.
+*
+* Everything the firmware outputs goes to the log (see hostIO.h).  The log
+* can be recorded as a golden file and later runs compared against it, so a
+* refactor that's meant to be bit-exact can be checked on the PC.
+*
+* Usage: replay <trace> [--record <golden>] [--golden <golden>] [--log <file>]
+* Trace format: see host/README.md
+****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+#include "scheduler.h"
+
+#include "hostIO.h"
+#include "hostBench.h"
+
+//Must match MAIN_TICK_US in main.c
+#define REPLAY_TICK_US 5000
+
+#define REPLAY_MAX_EVENTS 65536
+#define REPLAY_LINE 256
+
+typedef enum
+{
+      REPLAY_ADC
+    , REPLAY_DI
+    , REPLAY_PWD
+    , REPLAY_CAN
+    , REPLAY_END
+} ReplayEventType;
+
+typedef struct _ReplayEvent
+{
+    ubyte4 time_us;
+    ReplayEventType type;
+    ubyte1 channel;         //IO channel, or CAN channel
+    ubyte2 value;
+    IO_CAN_DATA_FRAME frame;
+} ReplayEvent;
+
+//Static so the trace doesn't show up in the allocation counts
+static ReplayEvent events[REPLAY_MAX_EVENTS];
+static ubyte4 eventCount = 0;
+
+void vcu_main(void);  //main.c, built with -Dmain=vcu_main
+
+/*-------------------------------------------------------------------
+* Scheduler_run (linked with -Wl,--wrap=Scheduler_run)
+* main() calls this once init is done.  Keep the scheduler and return.
+-------------------------------------------------------------------*/
+static Scheduler* scheduler = NULL;
+
+void __wrap_Scheduler_run(Scheduler* me)
+{
+    scheduler = me;
+}
+
+/*-------------------------------------------------------------------
+* Trace loading
+-------------------------------------------------------------------*/
+static bool Replay_parseLine(const char* line, ubyte4 lineNumber, ReplayEvent* event)
+{
+    char type[16];
+    char argument[64];
+    unsigned long time_ms;
+    int consumed;
+
+    if (sscanf(line, "%lu %15s%n", &time_ms, type, &consumed) < 2)
+    {
+        fprintf(stderr, "line %lu: expected <time ms> <type> ...\n", (unsigned long)lineNumber);
+        return FALSE;
+    }
+    event->time_us = (ubyte4)(time_ms * 1000);
+    line += consumed;
+
+    if (strcmp(type, "END") == 0)
+    {
+        event->type = REPLAY_END;
+        return TRUE;
+    }
+
+    if (strcmp(type, "CAN") == 0)
+    {
+        unsigned int channel;
+        unsigned int id;
+        unsigned int byte;
+
+        if (sscanf(line, "%u %x%n", &channel, &id, &consumed) < 2 || channel > 1)
+        {
+            fprintf(stderr, "line %lu: expected CAN <0|1> <id hex> <data bytes hex...>\n", (unsigned long)lineNumber);
+            return FALSE;
+        }
+        line += consumed;
+
+        event->type = REPLAY_CAN;
+        event->channel = (ubyte1)channel;
+        event->frame.id = id;
+        event->frame.id_format = IO_CAN_STD_FRAME;
+        event->frame.length = 0;
+        while (event->frame.length < 8 && sscanf(line, "%x%n", &byte, &consumed) == 1)
+        {
+            event->frame.data[event->frame.length++] = (ubyte1)byte;
+            line += consumed;
+        }
+        return TRUE;
+    }
+
+    unsigned long value;
+    if (sscanf(line, "%63s %lu", argument, &value) < 2 || HostIO_findChannel(argument, &event->channel) == FALSE)
+    {
+        fprintf(stderr, "line %lu: expected %s <channel name> <value>\n", (unsigned long)lineNumber, type);
+        return FALSE;
+    }
+    event->value = (ubyte2)value;
+
+    if (strcmp(type, "ADC") == 0) { event->type = REPLAY_ADC; }
+    else if (strcmp(type, "DI") == 0) { event->type = REPLAY_DI; }
+    else if (strcmp(type, "PWD") == 0) { event->type = REPLAY_PWD; }
+    else
+    {
+        fprintf(stderr, "line %lu: unknown event type %s\n", (unsigned long)lineNumber, type);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static bool Replay_loadTrace(const char* path)
+{
+    char line[REPLAY_LINE];
+    ubyte4 lineNumber = 0;
+    FILE* trace = fopen(path, "r");
+
+    if (trace == NULL)
+    {
+        perror(path);
+        return FALSE;
+    }
+
+    while (fgets(line, sizeof(line), trace) != NULL)
+    {
+        lineNumber++;
+
+        char* start = line;
+        while (*start == ' ' || *start == '\t') { start++; }
+        if (*start == '#' || *start == '\n' || *start == '\r' || *start == '\0') { continue; }
+
+        if (eventCount >= REPLAY_MAX_EVENTS)
+        {
+            fprintf(stderr, "%s: more than %u events\n", path, REPLAY_MAX_EVENTS);
+            fclose(trace);
+            return FALSE;
+        }
+        if (Replay_parseLine(start, lineNumber, &events[eventCount]) == FALSE)
+        {
+            fclose(trace);
+            return FALSE;
+        }
+        if (eventCount > 0 && events[eventCount].time_us < events[eventCount - 1].time_us)
+        {
+            fprintf(stderr, "line %lu: events must be in time order\n", (unsigned long)lineNumber);
+            fclose(trace);
+            return FALSE;
+        }
+        eventCount++;
+    }
+
+    fclose(trace);
+    return TRUE;
+}
+
+static void Replay_apply(const ReplayEvent* event)
+{
+    switch (event->type)
+    {
+    case REPLAY_ADC: HostIO_setADC(event->channel, event->value); break;
+    case REPLAY_DI:  HostIO_setDI(event->channel, event->value != 0); break;
+    case REPLAY_PWD: HostIO_setPWD(event->channel, event->value); break;
+    case REPLAY_CAN: HostIO_receiveCAN(event->channel, &event->frame); break;
+    case REPLAY_END: break;
+    }
+}
+
+/*-------------------------------------------------------------------
+* Golden file comparison
+-------------------------------------------------------------------*/
+static bool Replay_compare(const char* output, const char* goldenPath)
+{
+    char expected[REPLAY_LINE];
+    FILE* golden = fopen(goldenPath, "r");
+    ubyte4 lineNumber = 0;
+
+    if (golden == NULL)
+    {
+        perror(goldenPath);
+        return FALSE;
+    }
+
+    while (TRUE)
+    {
+        const char* end = strchr(output, '\n');
+        bool haveExpected = (fgets(expected, sizeof(expected), golden) != NULL);
+        lineNumber++;
+
+        if (*output == '\0' && haveExpected == FALSE) { break; }
+
+        size_t length = (end == NULL) ? strlen(output) : (size_t)(end - output);
+        size_t expectedLength = haveExpected ? strcspn(expected, "\r\n") : 0;
+        if (*output == '\0' || haveExpected == FALSE || length != expectedLength || strncmp(output, expected, length) != 0)
+        {
+            printf("MISMATCH at line %lu of %s\n", (unsigned long)lineNumber, goldenPath);
+            printf("  expected: %.*s\n", (int)expectedLength, haveExpected ? expected : "<end of file>");
+            printf("  got:      %.*s\n", (int)length, *output != '\0' ? output : "<end of output>");
+            fclose(golden);
+            return FALSE;
+        }
+        output = (end == NULL) ? output + length : end + 1;
+    }
+
+    fclose(golden);
+    return TRUE;
+}
+
+static bool Replay_writeFile(const char* path, const char* text, size_t length)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL)
+    {
+        perror(path);
+        return FALSE;
+    }
+    fwrite(text, 1, length, file);
+    fclose(file);
+    return TRUE;
+}
+
+/*****************************************************************************
+* Main
+****************************************************************************/
+int main(int argc, char** argv)
+{
+    const char* tracePath = NULL;
+    const char* goldenPath = NULL;
+    const char* recordPath = NULL;
+    const char* logPath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) { goldenPath = argv[++i]; }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) { recordPath = argv[++i]; }
+        else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) { logPath = argv[++i]; }
+        else if (argv[i][0] != '-' && tracePath == NULL) { tracePath = argv[i]; }
+        else { tracePath = NULL; break; }
+    }
+    if (tracePath == NULL)
+    {
+        fprintf(stderr, "usage: %s <trace> [--record <golden>] [--golden <golden>] [--log <file>]\n", argv[0]);
+        return 2;
+    }
+    if (Replay_loadTrace(tracePath) == FALSE) { return 2; }
+
+    char* output = NULL;
+    size_t outputLength = 0;
+    FILE* log = open_memstream(&output, &outputLength);
+    HostIO_setLog(log);
+
+    //----------------------------------------------------------------------------
+    // Power up: inputs present at t = 0, then the firmware's init
+    //----------------------------------------------------------------------------
+    ubyte4 next = 0;
+    while (next < eventCount && events[next].time_us == 0) { Replay_apply(&events[next++]); }
+
+    HostIO_setFreeRunning(TRUE);
+    HostIO_setTime(0);
+    vcu_main();
+    if (scheduler == NULL)
+    {
+        fprintf(stderr, "main() returned without starting the scheduler\n");
+        return 2;
+    }
+
+    //----------------------------------------------------------------------------
+    // Main loop: first tick on the next 5 ms boundary after init
+    //----------------------------------------------------------------------------
+    HostIO_setFreeRunning(FALSE);
+    HostBench_startMainLoop();
+
+    ubyte4 initTime = HostIO_getTime();
+    ubyte4 endTime = (eventCount > 0) ? events[eventCount - 1].time_us : 0;
+    ubyte4 ticks = 0;
+
+    for (ubyte4 time = (initTime / REPLAY_TICK_US + 1) * REPLAY_TICK_US; time <= endTime; time += REPLAY_TICK_US)
+    {
+        HostIO_setTime(time);
+        while (next < eventCount && events[next].time_us <= time) { Replay_apply(&events[next++]); }
+
+        Scheduler_step(scheduler);
+        ticks++;
+    }
+    fclose(log);
+
+    //----------------------------------------------------------------------------
+    // Report
+    //----------------------------------------------------------------------------
+    printf("Trace %s: %lu events, init took %lu us (simulated), %lu ticks, %lu CAN frames lost to full receive FIFOs\n"
+        , tracePath, (unsigned long)eventCount, (unsigned long)initTime, (unsigned long)ticks, (unsigned long)HostIO_getCANOverflows());
+    HostBench_report(stdout, ticks);
+
+    int result = 0;
+    if (HostBench_getMainLoopAllocations() != 0)
+    {
+        printf("FAIL: the main loop allocated memory\n");
+        result = 1;
+    }
+    if (logPath != NULL && Replay_writeFile(logPath, output, outputLength) == FALSE) { result = 2; }
+    if (recordPath != NULL)
+    {
+        if (Replay_writeFile(recordPath, output, outputLength) == FALSE) { result = 2; }
+        else { printf("Recorded %s\n", recordPath); }
+    }
+    if (goldenPath != NULL)
+    {
+        if (Replay_compare(output, goldenPath) == TRUE) { printf("Output matches %s\n", goldenPath); }
+        else { result = 1; }
+    }
+
+    free(output);
+    return result;
+}
@@ -0,0 +1,42 @@
+//Host stub - see IO_Driver.h
+#ifndef _IO_ADC_H
+#define _IO_ADC_H
+
+#include "IO_Driver.h"
+
+//Channel numbers are arbitrary on the host, but unique across all stub headers
+//(the firmware uses IO_ADC_CUR_xx as digital outputs too)
+#define IO_ADC_5V_00  0
+#define IO_ADC_5V_01  1
+#define IO_ADC_5V_02  2
+#define IO_ADC_5V_03  3
+#define IO_ADC_5V_04  4
+#define IO_ADC_5V_05  5
+#define IO_ADC_5V_06  6
+#define IO_ADC_5V_07  7
+#define IO_ADC_CUR_00 20
+#define IO_ADC_CUR_01 21
+#define IO_ADC_CUR_02 22
+#define IO_ADC_CUR_03 23
+#define IO_ADC_UBAT   40
+
+#define IO_ADC_SENSOR_SUPPLY_0 50
+#define IO_ADC_SENSOR_SUPPLY_1 51
+#define IO_SENSOR_SUPPLY_VAR   52
+#define IO_PIN_269             53
+
+#define IO_ADC_RATIOMETRIC 0
+#define IO_ADC_RESISTIVE   1
+#define IO_ADC_ABSOLUTE    2
+
+#define IO_POWER_OFF    0
+#define IO_POWER_ON     1
+#define IO_POWER_8_5_V  2
+#define IO_POWER_14_5_V 3
+
+IO_ErrorType IO_ADC_ChannelInit(ubyte1 adc_channel, ubyte1 type, ubyte1 range, ubyte1 pupd, ubyte1 sensor_supply, void* safety_conf);
+IO_ErrorType IO_ADC_ChannelDeInit(ubyte1 adc_channel);
+IO_ErrorType IO_ADC_Get(ubyte1 adc_channel, ubyte2* adc_value, bool* fresh);
+IO_ErrorType IO_POWER_Set(ubyte1 pin, ubyte1 mode);
+
+#endif // _IO_ADC_H
@@ -0,0 +1,29 @@
+//Host stub - see IO_Driver.h
+#ifndef _IO_CAN_H
+#define _IO_CAN_H
+
+#include "IO_Driver.h"
+
+typedef struct _io_can_data_frame
+{
+    ubyte1 data[8];
+    ubyte1 length;
+    ubyte1 id_format;
+    ubyte4 id;
+} IO_CAN_DATA_FRAME;
+
+#define IO_CAN_CHANNEL_0 0
+#define IO_CAN_CHANNEL_1 1
+
+#define IO_CAN_MSG_READ  0
+#define IO_CAN_MSG_WRITE 1
+
+#define IO_CAN_STD_FRAME 0
+#define IO_CAN_EXT_FRAME 1
+
+IO_ErrorType IO_CAN_Init(ubyte1 channel, ubyte2 baudrate, ubyte1 tseg1, ubyte1 tseg2, ubyte1 sjw);
+IO_ErrorType IO_CAN_ConfigFIFO(ubyte1* handle, ubyte1 channel, ubyte1 size, ubyte1 mode, ubyte1 id_format, ubyte4 id, ubyte4 ac_mask);
+IO_ErrorType IO_CAN_ReadFIFO(ubyte1 handle, IO_CAN_DATA_FRAME* buffer, ubyte1 buffer_size, ubyte1* rx_frames);
+IO_ErrorType IO_CAN_WriteFIFO(ubyte1 handle, const IO_CAN_DATA_FRAME* data, ubyte1 length);
+
+#endif // _IO_CAN_H
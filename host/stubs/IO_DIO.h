@@ -0,0 +1,34 @@
+//Host stub - see IO_Driver.h
+#ifndef _IO_DIO_H
+#define _IO_DIO_H
+
+#include "IO_Driver.h"
+
+#define IO_DO_00 100
+#define IO_DO_01 101
+#define IO_DO_02 102
+#define IO_DO_03 103
+#define IO_DO_04 104
+#define IO_DO_05 105
+#define IO_DO_06 106
+#define IO_DO_07 107
+
+#define IO_DI_00 150
+#define IO_DI_01 151
+#define IO_DI_02 152
+#define IO_DI_03 153
+#define IO_DI_04 154
+#define IO_DI_05 155
+#define IO_DI_06 156
+#define IO_DI_07 157
+
+#define IO_DI_PD_10K 0
+#define IO_DI_PU_10K 1
+
+IO_ErrorType IO_DO_Init(ubyte1 do_channel);
+IO_ErrorType IO_DO_Set(ubyte1 do_channel, bool do_value);
+IO_ErrorType IO_DI_Init(ubyte1 di_channel, ubyte1 pupd);
+IO_ErrorType IO_DI_DeInit(ubyte1 di_channel);
+IO_ErrorType IO_DI_Get(ubyte1 di_channel, bool* di_value);
+
+#endif // _IO_DIO_H
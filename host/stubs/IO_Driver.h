@@ -0,0 +1,46 @@
+/*****************************************************************************
+* Host stub of the TTTech IO driver (host replay build only - see host/README.md)
+******************************************************************************
+* Just enough of the IO driver API for the VCU modules to compile and run on
+* a PC.  Types keep the target widths (ubyte4 = 32 bits), but the host's int
+* is 32 bits where the XC2000's is 16, so integer promotion can differ.
+****************************************************************************/
+#ifndef _IO_DRIVER_H
+#define _IO_DRIVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t  ubyte1;
+typedef uint16_t ubyte2;
+typedef uint32_t ubyte4;
+typedef int8_t   sbyte1;
+typedef int16_t  sbyte2;
+typedef int32_t  sbyte4;
+typedef float    float4;
+typedef double   float8;
+typedef ubyte1   bool;
+
+#define TRUE  1
+#define FALSE 0
+
+typedef ubyte2 IO_ErrorType;
+#define IO_E_OK                     0
+#define IO_E_BUSY                   1
+#define IO_E_NULL_POINTER           2
+#define IO_E_INVALID_PARAMETER      3
+#define IO_E_CHANNEL_NOT_CONFIGURED 4
+#define IO_E_CAN_BUS_OFF            10
+#define IO_E_CAN_FIFO_FULL          11
+#define IO_E_CAN_OLD_DATA           12
+#define IO_E_CAN_WRONG_HANDLE       13
+#define IO_E_CAN_OVERFLOW           14
+#define IO_E_CAN_ERROR_PASSIVE      15
+#define IO_E_CAN_ERROR_WARNING      16
+#define IO_E_EEPROM_RANGE           20
+
+IO_ErrorType IO_Driver_Init(void* safety_conf);
+IO_ErrorType IO_Driver_TaskBegin(void);
+IO_ErrorType IO_Driver_TaskEnd(void);
+
+#endif // _IO_DRIVER_H
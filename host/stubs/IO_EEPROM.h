@@ -0,0 +1,12 @@
+//Host stub - see IO_Driver.h
+#ifndef _IO_EEPROM_H
+#define _IO_EEPROM_H
+
+#include "IO_Driver.h"
+
+IO_ErrorType IO_EEPROM_Init(void);
+IO_ErrorType IO_EEPROM_Read(ubyte2 offset, ubyte2 length, ubyte1* data);
+IO_ErrorType IO_EEPROM_Write(ubyte2 offset, ubyte2 length, const ubyte1* data);
+IO_ErrorType IO_EEPROM_GetStatus(void);
+
+#endif // _IO_EEPROM_H
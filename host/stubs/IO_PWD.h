@@ -0,0 +1,20 @@
+//Host stub - see IO_Driver.h
+#ifndef _IO_PWD_H
+#define _IO_PWD_H
+
+#include "IO_Driver.h"
+
+#define IO_PWD_08 120
+#define IO_PWD_09 121
+#define IO_PWD_10 122
+#define IO_PWD_11 123
+
+#define IO_PWD_FALLING_VAR 0
+#define IO_PWD_HIGH_TIME   1
+
+IO_ErrorType IO_PWD_FreqInit(ubyte1 timer_channel, ubyte1 freq_mode);
+IO_ErrorType IO_PWD_FreqGet(ubyte1 timer_channel, ubyte2* frequency);
+IO_ErrorType IO_PWD_PulseInit(ubyte1 timer_channel, ubyte1 pulse_mode);
+IO_ErrorType IO_PWD_PulseGet(ubyte1 timer_channel, ubyte4* pulse_time);
+
+#endif // _IO_PWD_H
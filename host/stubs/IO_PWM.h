@@ -0,0 +1,20 @@
+//Host stub - see IO_Driver.h
+#ifndef _IO_PWM_H
+#define _IO_PWM_H
+
+#include "IO_Driver.h"
+#include "IO_PWD.h"
+
+#define IO_PWM_00 200
+#define IO_PWM_01 201
+#define IO_PWM_02 202
+#define IO_PWM_03 203
+#define IO_PWM_04 204
+#define IO_PWM_05 205
+#define IO_PWM_06 206
+#define IO_PWM_07 207
+
+IO_ErrorType IO_PWM_Init(ubyte1 pwm_channel, ubyte2 frequency, bool polarity, bool diag_margin, ubyte1 current_measurement, bool current_control, void* safety_conf);
+IO_ErrorType IO_PWM_SetDuty(ubyte1 pwm_channel, ubyte2 duty_cycle, ubyte2* current);
+
+#endif // _IO_PWM_H
@@ -0,0 +1,10 @@
+//Host stub - see IO_Driver.h.  The clock is simulated (host/hostIO.c).
+#ifndef _IO_RTC_H
+#define _IO_RTC_H
+
+#include "IO_Driver.h"
+
+IO_ErrorType IO_RTC_StartTime(ubyte4* timestamp);
+ubyte4 IO_RTC_GetTimeUS(ubyte4 timestamp);
+
+#endif // _IO_RTC_H
@@ -0,0 +1,16 @@
+//Host stub - see IO_Driver.h
+#ifndef _IO_UART_H
+#define _IO_UART_H
+
+#include "IO_Driver.h"
+
+#define IO_UART_CH0         0
+#define IO_UART_RS232       0
+#define IO_UART_PARITY_NONE 0
+
+IO_ErrorType IO_UART_Init(ubyte1 channel, ubyte4 baudrate, ubyte1 dbits, ubyte1 par, ubyte1 sbits);
+IO_ErrorType IO_UART_Write(ubyte1 channel, const ubyte1* data, ubyte1 len, ubyte1* tx_len);
+IO_ErrorType IO_UART_GetTxStatus(ubyte1 channel, ubyte1* tx_len);
+IO_ErrorType IO_UART_Task(void);
+
+#endif // _IO_UART_H
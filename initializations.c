@@ -8,9 +8,11 @@
 #include "IO_PWM.h"
 #include "IO_CAN.h"
 #include "IO_DIO.h"
+#include "IO_RTC.h"
 
 #include "sensors.h"
 #include "initializations.h"
+#include "serial.h"
 //#include "can.h"
 
 /*****************************************************************************
@@ -115,39 +117,66 @@ void vcu_initializeADC(bool benchMode)
 	Sensor_TCSSwitchDown.ioErr_signalInit = IO_DI_Init(IO_DI_03, IO_DI_PD_10K); //TCS Switch B
     Sensor_HVILTerminationSense.ioErr_signalInit = IO_DI_Init(IO_DI_07, IO_DI_PD_10K); //HVIL Term sense, high = HV present
 
-    //
+    //----------------------------------------------------------------------------
+    //Filters (see sensors.h).  Anything not listed here is unfiltered.
+    //----------------------------------------------------------------------------
+    //Pedals: median of 3 so a single noisy sample never reaches the torque command.
+    //Anything slower would add lag to the pedal -> torque response.
+    Sensor_setFilter(&Sensor_TPS0, SENSOR_FILTER_MEDIAN3, 0);
+    Sensor_setFilter(&Sensor_TPS1, SENSOR_FILTER_MEDIAN3, 0);
+    Sensor_setFilter(&Sensor_BPS0, SENSOR_FILTER_MEDIAN3, 0);
 
+    //Regen knob: average of 4, so the reading doesn't chatter between positions
+    Sensor_setFilter(&Sensor_TCSKnob, SENSOR_FILTER_MOVING_AVERAGE, 2);
+
+    //LV battery: slow low pass (1/16 per sample), it sags under load
+    Sensor_setFilter(&Sensor_LVBattery, SENSOR_FILTER_IIR, 4);
 }
 
 //----------------------------------------------------------------------------
-// Waste CPU cycles until we have valid data
+// Wait until we have valid data
+//----------------------------------------------------------------------------
+// Cycles the IO driver (and reads every sensor channel) until all channels
+// have given VCU_SENSOR_READY_READINGS good readings, instead of always
+// waiting a fixed time.  Anything that doesn't need sensor data (object
+// constructors, CAN setup) should run before this so it overlaps the settle
+// time.  Gives up after timeoutUS and logs which channels weren't ready.
 //----------------------------------------------------------------------------
-void vcu_ADCWasteLoop(void)
+#define VCU_SENSOR_READY_READINGS 3
+#define VCU_STARTUP_CYCLE_US 1000
+
+bool vcu_waitForSensors(SerialManager* serialMan, ubyte4 timeoutUS)
 {
-    bool tempFresh = FALSE;
-    ubyte2 tempData;
-    ubyte4 timestamp_sensorpoll = 0;
-    IO_RTC_StartTime(&timestamp_sensorpoll);
-    while (IO_RTC_GetTimeUS(timestamp_sensorpoll) < 1000000)
+    ubyte4 timestamp_waitStart;
+    IO_RTC_StartTime(&timestamp_waitStart);
+
+    while (TRUE)
     {
+        ubyte4 timestamp_cycle;
+        IO_RTC_StartTime(&timestamp_cycle);
         IO_Driver_TaskBegin();
 
+        //Keep the RTDS and MCM relay off until the main loop takes over
         IO_PWM_SetDuty(IO_PWM_07, 0, NULL);  //Pin 103
-
         IO_DO_Set(IO_DO_00, FALSE); //False = low
-        //IO_DO_Set(IO_DO_01, FALSE); //HVIL shutdown relay
-        //IO_DO_Set(IO_DO_06, FALSE); //Front WSS x2
-        //IO_DO_Set(IO_DO_07, FALSE); //Rear  WSS x2
 
-        //IO_DI (digital inputs) supposed to take 2 cycles before they return valid data
-        IO_DI_Get(IO_DI_04, &tempData);
-        IO_DI_Get(IO_DI_05, &tempData);
-        IO_ADC_Get(IO_ADC_5V_00, &tempData, &tempFresh);
-        IO_ADC_Get(IO_ADC_5V_01, &tempData, &tempFresh);
+        sensors_updateAllSensors();
+        SerialManager_task(serialMan);
 
         IO_Driver_TaskEnd();
-        //TODO: Find out if EACH pin needs 2 cycles or just the entire DIO unit
-        while (IO_RTC_GetTimeUS(timestamp_sensorpoll) < 12500);   // wait until 1/8/10s (125ms) have passed
+
+        if (sensors_isReady(VCU_SENSOR_READY_READINGS) == TRUE)
+        {
+            return TRUE;
+        }
+        if (IO_RTC_GetTimeUS(timestamp_waitStart) >= timeoutUS)
+        {
+            SerialManager_log(serialMan, SERIAL_WARNING, "Sensors not ready - starting anyway\n");
+            sensors_logNotReady(serialMan, VCU_SENSOR_READY_READINGS);
+            return FALSE;
+        }
+
+        while (IO_RTC_GetTimeUS(timestamp_cycle) < VCU_STARTUP_CYCLE_US);
     }
 }
 
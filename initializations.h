@@ -13,6 +13,7 @@
 
 #include "IO_Driver.h"
 #include "APDB.h"
+#include "serial.h"
 
 //Application Database, needed for TTC-Downloader
 //APDB appl_db;
@@ -22,5 +23,6 @@ void vcu_initializeVCU(void);
 void vcu_initializeADC(bool benchMode);
 void vcu_initializeCAN(void);
 void vcu_initializeMCU(void);
-void vcu_ADCWasteLoop(void);
+//Returns FALSE if it gave up waiting (the reasons are logged)
+bool vcu_waitForSensors(SerialManager* serialMan, ubyte4 timeoutUS);
 #endif //  _INITIALIZEVCU_H
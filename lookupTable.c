@@ -0,0 +1,108 @@
+#include "IO_Driver.h"
+#include "lookupTable.h"
+#include "fixedPoint.h"
+
+/*****************************************************************************
+* Lookup tables
+****************************************************************************/
+static sbyte4 LookupAxis_point(const LookupAxis* axis, ubyte1 index)
+{
+    return (axis->points != NULL) ? axis->points[index] : (sbyte4)axis->start + (sbyte4)index * axis->step;
+}
+
+/*-------------------------------------------------------------------
+* LookupAxis_locate
+* Finds the segment (breakpoint index .. index+1) that value falls in, and
+* how far along that segment it is.  Saturates at both ends of the axis.
+-------------------------------------------------------------------*/
+static void LookupAxis_locate(const LookupAxis* axis, sbyte4 value, ubyte1* segment, Q15* fraction)
+{
+    ubyte1 last = axis->count - 1;
+    sbyte4 segmentStart;
+    ubyte4 segmentWidth;
+
+    if (value <= LookupAxis_point(axis, 0))
+    {
+        *segment = 0;
+        *fraction = 0;
+        return;
+    }
+    if (value >= LookupAxis_point(axis, last))
+    {
+        *segment = last - 1;
+        *fraction = FIXEDPOINT_ONE;
+        return;
+    }
+
+    if (axis->points == NULL)
+    {
+        //Evenly spaced: index directly
+        *segment = (ubyte1)((value - axis->start) / axis->step);
+        segmentWidth = axis->step;
+    }
+    else
+    {
+        //Binary search for the last breakpoint <= value
+        ubyte1 low = 0;
+        ubyte1 high = last;
+        while (high - low > 1)
+        {
+            ubyte1 middle = (low + high) / 2;
+            if (axis->points[middle] <= value) { low = middle; }
+            else { high = middle; }
+        }
+        *segment = low;
+        segmentWidth = (ubyte4)((sbyte4)axis->points[low + 1] - axis->points[low]);
+    }
+
+    segmentStart = LookupAxis_point(axis, *segment);
+    *fraction = (segmentWidth == 0) ? 0 : (Q15)(((ubyte4)(value - segmentStart) * FIXEDPOINT_ONE) / segmentWidth);
+}
+
+sbyte4 LookupTable_evaluate(const LookupTable1D* table, sbyte4 x)
+{
+    ubyte1 segment;
+    Q15 fraction;
+
+    LookupAxis_locate(&table->x, x, &segment, &fraction);
+    return FixedPoint_lerp(table->values[segment], table->values[segment + 1], fraction);
+}
+
+sbyte4 LookupTable_evaluate2D(const LookupTable2D* table, sbyte4 x, sbyte4 y)
+{
+    ubyte1 column;
+    ubyte1 row;
+    Q15 xFraction;
+    Q15 yFraction;
+
+    LookupAxis_locate(&table->x, x, &column, &xFraction);
+    LookupAxis_locate(&table->y, y, &row, &yFraction);
+
+    //Interpolate along x on the two rows, then between the rows
+    const sbyte4* below = &table->values[(ubyte2)row * table->x.count + column];
+    const sbyte4* above = below + table->x.count;
+    sbyte4 valueBelow = FixedPoint_lerp(below[0], below[1], xFraction);
+    sbyte4 valueAbove = FixedPoint_lerp(above[0], above[1], xFraction);
+    return FixedPoint_lerp(valueBelow, valueAbove, yFraction);
+}
+
+ubyte1 LookupTable_band(const LookupAxis* axis, sbyte4 value)
+{
+    if (axis->points == NULL)
+    {
+        if (value < axis->start) { return 0; }
+        sbyte4 band = (value - axis->start) / axis->step + 1;
+        return (band > axis->count) ? axis->count : (ubyte1)band;
+    }
+
+    //Binary search for the first breakpoint > value
+    ubyte1 low = 0;
+    ubyte1 high = axis->count;
+    while (low < high)
+    {
+        ubyte1 middle = (low + high) / 2;
+        if (axis->points[middle] <= value) { low = middle + 1; }
+        else { high = middle; }
+    }
+    return low;
+}
@@ -0,0 +1,62 @@
+#ifndef _LOOKUPTABLE_H
+#define _LOOKUPTABLE_H
+
+#include "IO_Driver.h"
+#include "fixedPoint.h"
+
+/*****************************************************************************
+* Lookup tables (piecewise-linear curves)
+******************************************************************************
+* For curves that used to be if-chains (SOC vs voltage, pump duty vs temp...).
+* Tables are meant to be declared static const so they live in flash, and a
+* curve can be re-tuned by changing numbers instead of code:
+*
+*     static const sbyte2 lvSocVoltage[] = { 9200, 12730, ... };
+*     static const sbyte4 lvSocPercent[] = {    0,    10, ... };
+*     static const LookupTable1D lvSocCurve = { LOOKUPTABLE_AXIS(lvSocVoltage), lvSocPercent };
+*     soc = LookupTable_evaluate(&lvSocCurve, Sensor_LVBattery.sensorValue);
+*
+* An axis is either a list of ascending breakpoints (binary search) or evenly
+* spaced (start + n * step, found directly with a divide).  Inputs outside the
+* axis saturate to the first/last value.  Evaluation takes the same handful of
+* steps wherever on the curve the input falls (at most 8 search steps for 255
+* breakpoints), and never uses float.
+*
+* Neighbouring values must be less than 65536 apart (see FixedPoint_lerp).
+****************************************************************************/
+typedef struct _LookupAxis
+{
+    ubyte1 count;               //Number of breakpoints (at least 2)
+    const sbyte2* points;       //Ascending breakpoints, or NULL for an evenly spaced axis
+    sbyte2 start;               //Evenly spaced axis: first breakpoint
+    sbyte2 step;                //Evenly spaced axis: distance between breakpoints (> 0)
+} LookupAxis;
+
+#define LOOKUPTABLE_COUNT(array) ((ubyte1)(sizeof(array) / sizeof((array)[0])))
+#define LOOKUPTABLE_AXIS(points) { LOOKUPTABLE_COUNT(points), points, 0, 0 }
+#define LOOKUPTABLE_EVEN_AXIS(count, start, step) { count, NULL, start, step }
+
+typedef struct _LookupTable1D
+{
+    LookupAxis x;
+    const sbyte4* values;       //One per x breakpoint
+} LookupTable1D;
+
+typedef struct _LookupTable2D
+{
+    LookupAxis x;
+    LookupAxis y;
+    const sbyte4* values;       //Row per y breakpoint: values[yIndex * x.count + xIndex]
+} LookupTable2D;
+
+sbyte4 LookupTable_evaluate(const LookupTable1D* table, sbyte4 x);
+sbyte4 LookupTable_evaluate2D(const LookupTable2D* table, sbyte4 x, sbyte4 y);
+
+/*-------------------------------------------------------------------
+* LookupTable_band
+* For step functions (e.g. knob positions): returns how many breakpoints
+* are <= value, from 0 (below the first) to count (at/above the last).
+-------------------------------------------------------------------*/
+ubyte1 LookupTable_band(const LookupAxis* axis, sbyte4 value);
+
+#endif // _LOOKUPTABLE_H
@@ -0,0 +1,116 @@
+#include "IO_Driver.h"
+#include "IO_RTC.h"
+#include "IO_CAN.h"
+
+#include "loopTiming.h"
+#include "canManager.h"
+#include "canSignals.h"
+
+#if LOOPTIMING_ENABLED
+
+//Histogram bucket upper limits (us).  Last bucket is everything above.
+#define LOOPTIMING_BUCKETS 7
+static const ubyte2 loopTimingBucketLimits[LOOPTIMING_BUCKETS - 1] = { 100, 250, 500, 1000, 2500, 5000 };
+
+#define LOOPTIMING_PUBLISH_PERIOD_US 1000000
+
+typedef struct _LoopTimingStats
+{
+    ubyte4 timestamp_start;
+    ubyte4 budgetus;        //0 = no budget
+
+    //Current window (reset after each publish)
+    ubyte2 samples;
+    ubyte2 minus;
+    ubyte2 maxus;
+    ubyte4 totalus;
+    ubyte1 histogram[LOOPTIMING_BUCKETS];
+
+    //Since power on
+    ubyte2 overBudget;
+    ubyte4 totalSamples;
+} LoopTimingStats;
+
+//Only ever one loop, so this is a module-level singleton (like the Sensor objects)
+static LoopTimingStats loopTimingStats[LOOPTIMING_STAGE_COUNT];
+static ubyte4 timestamp_lastPublish = 0;
+
+static const CanSignal canSignals_timingStats[] =
+    { CANSIGNAL_LE(0, 8), CANSIGNAL_LE(8, 8), CANSIGNAL_LE(16, 16), CANSIGNAL_LE(32, 16), CANSIGNAL_LE(48, 16) };
+static const CanSignal canSignals_timingHistogram[] =
+    { CANSIGNAL_LE(0, 8), CANSIGNAL_LE(8, 8), CANSIGNAL_LE(16, 8), CANSIGNAL_LE(24, 8), CANSIGNAL_LE(32, 8), CANSIGNAL_LE(40, 8), CANSIGNAL_LE(48, 8), CANSIGNAL_LE(56, 8) };
+static const CanSignal canSignals_timingTotals[] =
+    { CANSIGNAL_LE(0, 8), CANSIGNAL_LE(8, 16), CANSIGNAL_LE(24, 32) };
+
+static const CanMessageDefinition canMessage_timingStats = CANMESSAGE(0x50A, 8, canSignals_timingStats);
+static const CanMessageDefinition canMessage_timingHistogram = CANMESSAGE(0x50B, 8, canSignals_timingHistogram);
+static const CanMessageDefinition canMessage_timingTotals = CANMESSAGE(0x50C, 7, canSignals_timingTotals);
+
+void LoopTiming_start(LoopTimingStage stage)
+{
+    IO_RTC_StartTime(&loopTimingStats[stage].timestamp_start);
+}
+
+void LoopTiming_stop(LoopTimingStage stage)
+{
+    LoopTimingStats* stats = &loopTimingStats[stage];
+    ubyte4 elapsed = IO_RTC_GetTimeUS(stats->timestamp_start);
+    ubyte2 elapsed16 = (elapsed > 0xFFFF) ? 0xFFFF : (ubyte2)elapsed;
+
+    if (stats->samples == 0 || elapsed16 < stats->minus) { stats->minus = elapsed16; }
+    if (stats->samples == 0 || elapsed16 > stats->maxus) { stats->maxus = elapsed16; }
+    stats->totalus += elapsed16;
+    if (stats->samples < 0xFFFF) { stats->samples++; }
+
+    ubyte1 bucket = 0;
+    while (bucket < LOOPTIMING_BUCKETS - 1 && elapsed16 >= loopTimingBucketLimits[bucket]) { bucket++; }
+    if (stats->histogram[bucket] < 0xFF) { stats->histogram[bucket]++; }
+
+    if (stats->budgetus > 0 && elapsed > stats->budgetus && stats->overBudget < 0xFFFF) { stats->overBudget++; }
+    stats->totalSamples++;
+}
+
+void LoopTiming_setBudget(LoopTimingStage stage, ubyte4 budgetus)
+{
+    loopTimingStats[stage].budgetus = budgetus;
+}
+
+void LoopTiming_publish(CanManager* canMan)
+{
+    IO_CAN_DATA_FRAME canMessages[LOOPTIMING_FRAME_COUNT];
+    ubyte1 canMessageCount = 0;
+
+    if (timestamp_lastPublish != 0 && IO_RTC_GetTimeUS(timestamp_lastPublish) < LOOPTIMING_PUBLISH_PERIOD_US) { return; }
+    IO_RTC_StartTime(&timestamp_lastPublish);
+
+    for (ubyte1 stage = 0; stage < LOOPTIMING_STAGE_COUNT; stage++)
+    {
+        LoopTimingStats* stats = &loopTimingStats[stage];
+        ubyte2 avgus = (stats->samples == 0) ? 0 : stats->totalus / stats->samples;
+        {
+            sbyte4 values[] = { stage, (stats->samples > 0xFF) ? 0xFF : stats->samples, stats->minus, stats->maxus, avgus };
+            CanSignal_packMessage(&canMessage_timingStats, values, &canMessages[canMessageCount++]);
+        }
+        {
+            sbyte4 values[1 + LOOPTIMING_BUCKETS];
+            values[0] = stage;
+            for (ubyte1 bucket = 0; bucket < LOOPTIMING_BUCKETS; bucket++) { values[1 + bucket] = stats->histogram[bucket]; }
+            CanSignal_packMessage(&canMessage_timingHistogram, values, &canMessages[canMessageCount++]);
+        }
+        {
+            sbyte4 values[] = { stage, stats->overBudget, stats->totalSamples };
+            CanSignal_packMessage(&canMessage_timingTotals, values, &canMessages[canMessageCount++]);
+        }
+
+        //Start a new window
+        stats->samples = 0;
+        stats->minus = 0;
+        stats->maxus = 0;
+        stats->totalus = 0;
+        for (ubyte1 bucket = 0; bucket < LOOPTIMING_BUCKETS; bucket++) { stats->histogram[bucket] = 0; }
+    }
+
+    CanManager_send(canMan, CAN1_LOPRI, canMessages, canMessageCount);
+}
+
+#endif // LOOPTIMING_ENABLED
@@ -0,0 +1,60 @@
+#ifndef _LOOPTIMING_H
+#define _LOOPTIMING_H
+
+#include "IO_Driver.h"
+#include "canManager.h"
+
+/*****************************************************************************
+* Loop timing instrumentation
+******************************************************************************
+* Measures how long each stage of the control loop takes, using the RTC:
+*     LOOPTIMING_START(LOOPTIMING_SENSORS);
+*     sensors_updateSensors();
+*     LOOPTIMING_STOP(LOOPTIMING_SENSORS);
+*
+* For each stage we keep min/max/avg and a histogram over the current 1 s
+* window, plus a count of samples that went over the stage's budget (if one
+* was set).  LOOPTIMING_PUBLISH sends the stats on CAN1 once per second:
+*   0x50A  byte 0 = stage, 1 = samples, 2-3 = min us, 4-5 = max us, 6-7 = avg us
+*   0x50B  byte 0 = stage, 1-7 = histogram (see loopTiming.c for buckets)
+*   0x50C  byte 0 = stage, 1-2 = over budget (total), 3-6 = samples (total)
+* One frame of each per stage; times saturate at 65535 us, counts at 255/65535.
+*
+* Build with LOOPTIMING_ENABLED defined to 0 to compile all of this out.
+****************************************************************************/
+#ifndef LOOPTIMING_ENABLED
+#define LOOPTIMING_ENABLED 1
+#endif
+
+typedef enum
+{
+    LOOPTIMING_TICK,            //All periodic tasks in one scheduler tick
+    LOOPTIMING_SENSORS,         //sensors_updateSensors
+    LOOPTIMING_CAN_READ,        //CanManager_readPriority (fast task)
+    LOOPTIMING_SAFETY_UPDATE,   //SafetyChecker_update
+    LOOPTIMING_TELEMETRY,       //canOutput_sendDebugMessage
+    LOOPTIMING_SERIAL,          //SerialManager_send
+    LOOPTIMING_STAGE_COUNT
+} LoopTimingStage;
+
+//Frames sent by one LOOPTIMING_PUBLISH (0x50A-0x50C per stage)
+#define LOOPTIMING_FRAME_COUNT (3 * LOOPTIMING_STAGE_COUNT)
+
+#if LOOPTIMING_ENABLED
+    #define LOOPTIMING_START(stage)              LoopTiming_start(stage)
+    #define LOOPTIMING_STOP(stage)               LoopTiming_stop(stage)
+    #define LOOPTIMING_SET_BUDGET(stage, budgetus) LoopTiming_setBudget(stage, budgetus)
+    #define LOOPTIMING_PUBLISH(canMan)           LoopTiming_publish(canMan)
+
+    void LoopTiming_start(LoopTimingStage stage);
+    void LoopTiming_stop(LoopTimingStage stage);
+    void LoopTiming_setBudget(LoopTimingStage stage, ubyte4 budgetus);
+    void LoopTiming_publish(CanManager* canMan);  //Safe to call often - only sends once per second
+#else
+    #define LOOPTIMING_START(stage)
+    #define LOOPTIMING_STOP(stage)
+    #define LOOPTIMING_SET_BUDGET(stage, budgetus)
+    #define LOOPTIMING_PUBLISH(canMan)
+#endif
+
+#endif // _LOOPTIMING_H
@@ -46,6 +46,12 @@
 #include "sensorCalculations.h"
 #include "serial.h"
 #include "cooling.h"
+#include "scheduler.h"
+#include "loopTiming.h"
+#include "eepromManager.h"
+#include "dataLogger.h"
+#include "vehicleState.h"
+#include "arena.h"
 
 //Application Database, needed for TTC-Downloader
 APDB appl_db =
@@ -99,6 +105,256 @@ extern Sensor Sensor_RTDButton;
 extern Sensor Sensor_TEMP_BrakingSwitch;
 extern Sensor Sensor_EcoButton;
 
+/*****************************************************************************
+* Periodic tasks
+******************************************************************************
+* The main loop is a cyclic executive (see scheduler.h) with a 5 ms tick:
+*   Fast   -   5 ms: inverter feedback -> pedals -> vehicle state inputs -> torque command -> safety torque
+*                    reduction -> vehicle state outputs, publish -> 0xC0 -> data logger
+*   Medium -  20 ms: bulk CAN read (BMS, CAN1), safety checks, buttons/knobs, freeze frame streaming
+*   Slow   - 100 ms: cooling, debug telemetry
+* Phases put the medium and slow tasks on different ticks.  Everything after the
+* publish reads the fast task's published VehicleState (see vehicleState.h).
+****************************************************************************/
+#define MAIN_TICK_US 5000
+
+//Objects shared by the tasks (created in main)
+typedef struct _VCUTaskObjects
+{
+    bool bench;
+    SerialManager* serialMan;
+    EEPROMManager* eeprom;
+    CanManager* canMan;
+    ReadyToDriveSound* rtds;
+    MotorController* mcm0;
+    TorqueEncoder* tps;
+    BrakePressureSensor* bps;
+    WheelSpeeds* wss;
+    SafetyChecker* sc;
+    BatteryManagementSystem* bms;
+    CoolingSystem* cs;
+    DataLogger* logger;
+    VehicleStateBuffer* state;
+
+    ubyte4 timestamp_EcoButton;
+    ubyte1 calibrationErrors;  //NOT USED
+} VCUTaskObjects;
+
+//Vehicle state inputs: once the sensors, pedals and wheel speeds are up to date
+static void vcu_captureInputs(VCUTaskObjects* vcu, VehicleState* state)
+{
+    TorqueEncoder* tps = vcu->tps;
+    BrakePressureSensor* bps = vcu->bps;
+
+    state->mcmPowerW = MCM_getPower(vcu->mcm0);
+    state->bmsPowerW = BMS_getPower(vcu->bms);
+    state->throttlePercent = tps->percent;
+    state->tps0Percent = tps->tps0_percent;
+    state->tps1Percent = tps->tps1_percent;
+    state->brakePercent = bps->percent;
+    state->tps0Value = (ubyte2)tps->tps0->sensorValue;
+    state->tps1Value = (ubyte2)tps->tps1_value;
+    state->bps0Value = (ubyte2)bps->bps0_value;
+    for (ubyte1 wheel = FL; wheel <= RR; wheel++) { state->wheelSpeed[wheel] = WheelSpeeds_getWheelSpeed(vcu->wss, (Wheel)wheel); }
+    state->wheelSpeedSensor[FL] = (ubyte2)Sensor_WSS_FL.sensorValue;
+    state->wheelSpeedSensor[FR] = (ubyte2)Sensor_WSS_FR.sensorValue;
+    state->wheelSpeedSensor[RL] = (ubyte2)Sensor_WSS_RL.sensorValue;
+    state->wheelSpeedSensor[RR] = (ubyte2)Sensor_WSS_RR.sensorValue;
+    state->lvBatteryMV = (ubyte2)Sensor_LVBattery.sensorValue;
+    state->bmsDCL = BMS_getDCL(vcu->bms);
+    state->bmsCCL = BMS_getCCL(vcu->bms);
+    state->mcmTemp = MCM_getTemp(vcu->mcm0);
+    state->motorTemp = MCM_getMotorTemp(vcu->mcm0);
+    state->batteryMaxTemp = BMS_getMaxTemp(vcu->bms);
+    state->hvilTermSense = Sensor_HVILTerminationSense.sensorValue;
+
+    //Pedal sensor health, for the safety rules
+    Sensor* tps0 = tps->tps0;
+    Sensor* tps1 = tps->tps1;
+    Sensor* bps0 = bps->bps0;
+    ubyte1 status = 0;
+    if (tps0->ioErr_powerInit != IO_E_OK || tps1->ioErr_powerInit != IO_E_OK
+     || tps0->ioErr_powerSet != IO_E_OK || tps1->ioErr_powerSet != IO_E_OK) { status |= VEHICLESTATE_TPS_POWER_ERROR; }
+    if (bps0->ioErr_powerInit != IO_E_OK || bps0->ioErr_powerSet != IO_E_OK) { status |= VEHICLESTATE_BPS_POWER_ERROR; }
+    if (tps0->ioErr_signalInit != IO_E_OK || tps1->ioErr_signalInit != IO_E_OK
+     || tps0->ioErr_signalGet != IO_E_OK || tps1->ioErr_signalGet != IO_E_OK) { status |= VEHICLESTATE_TPS_SIGNAL_ERROR; }
+    if (bps0->ioErr_signalInit != IO_E_OK || bps0->ioErr_signalGet != IO_E_OK) { status |= VEHICLESTATE_BPS_SIGNAL_ERROR; }
+    if (tps0->sensorValue < tps0->specMin || tps0->sensorValue > tps0->specMax
+     || tps1->sensorValue < tps1->specMin || tps1->sensorValue > tps1->specMax) { status |= VEHICLESTATE_TPS_OUT_OF_SPEC; }
+    if (bps0->sensorValue < bps0->specMin || bps0->sensorValue > bps0->specMax) { status |= VEHICLESTATE_BPS_OUT_OF_SPEC; }
+    if (tps->calibrated == TRUE) { status |= VEHICLESTATE_TPS_CALIBRATED; }
+    if (bps->calibrated == TRUE) { status |= VEHICLESTATE_BPS_CALIBRATED; }
+    state->pedalStatus = status;
+}
+
+//Vehicle state outputs: once the torque command and inverter state are final
+static void vcu_captureOutputs(VCUTaskObjects* vcu, VehicleState* state)
+{
+    PowerLimiter* powerLimiter = SafetyChecker_getPowerLimiter(vcu->sc);
+
+    state->mcmStartupStage = MCM_getStartupStage(vcu->mcm0);
+    state->faults = SafetyChecker_getFaults(vcu->sc);
+    state->powerLimitTrimW = PowerLimiter_getTrimW(powerLimiter);
+    state->warnings = (ubyte2)SafetyChecker_getWarnings(vcu->sc);
+    state->notices = (ubyte2)SafetyChecker_getNotices(vcu->sc);
+    state->commandedTorqueDNm = MCM_commands_getTorque(vcu->mcm0);
+    state->torqueLimitDNm = MCM_commands_getTorqueLimit(vcu->mcm0);
+    state->torqueCeilingDNm = PowerLimiter_getTorqueCeilingDNm(powerLimiter);
+    state->direction = (ubyte1)MCM_commands_getDirection(vcu->mcm0);
+    state->powerLimit = (ubyte1)PowerLimiter_getActiveLimit(powerLimiter);
+    state->inverterEnabled = (MCM_commands_getInverter(vcu->mcm0) == ENABLED);
+}
+
+static void task_fast(void* object)
+{
+    VCUTaskObjects* vcu = (VCUTaskObjects*)object;
+
+    /*******************************************/
+    /*              Read Inputs                */
+    /*******************************************/
+    //Get readings from our sensors and other local devices (buttons, 12v battery, etc)
+    LOOPTIMING_START(LOOPTIMING_SENSORS);
+    sensors_updateSensors();
+    LOOPTIMING_STOP(LOOPTIMING_SENSORS);
+
+    //Pull inverter feedback from its own CAN FIFO and update our object representations.
+    //Also forwards can0 messages to can1 for DAQ.  Bulk traffic (BMS etc) is read in the
+    //medium task and in the background.
+    LOOPTIMING_START(LOOPTIMING_CAN_READ);
+    CanManager_readPriority(vcu->canMan);
+    LOOPTIMING_STOP(LOOPTIMING_CAN_READ);
+
+    /*******************************************/
+    /*          Perform Calculations           */
+    /*******************************************/
+    //Wheel speeds are read every tick (sensors_updateSensors), so slip is only ever 5 ms old
+    WheelSpeeds_update(vcu->wss);
+    //TractionControl_update(tps, mcm0, wss, daq);
+
+    TorqueEncoder_update(vcu->tps);
+    //Every cycle: if the calibration was started and hasn't finished, check the values again
+    bool tpsCalibrating = vcu->tps->runCalibration;
+    TorqueEncoder_calibrationCycle(vcu->tps, &vcu->calibrationErrors); //Todo: deal with calibration errors
+    BrakePressureSensor_update(vcu->bps, vcu->bench);
+    bool bpsCalibrating = vcu->bps->runCalibration;
+    BrakePressureSensor_calibrationCycle(vcu->bps, &vcu->calibrationErrors);
+
+    //Store a finished calibration (only queued here - the background task does the writing)
+    if (tpsCalibrating == TRUE && vcu->tps->runCalibration == FALSE) { TorqueEncoder_saveCalibrationToEEPROM(vcu->tps, vcu->eeprom); }
+    if (bpsCalibrating == TRUE && vcu->bps->runCalibration == FALSE) { BrakePressureSensor_saveCalibrationToEEPROM(vcu->bps, vcu->eeprom); }
+
+    //Everything from here on works from this tick's snapshot
+    VehicleState* state = VehicleStateBuffer_getBack(vcu->state);
+    vcu_captureInputs(vcu, state);
+
+    //Assign motor controls to MCM command message
+    //DOES NOT set inverter command or rtds flag
+    MCM_calculateCommands(vcu->mcm0, state);
+    state->requestedTorqueDNm = MCM_commands_getTorque(vcu->mcm0);  //Before the safety checker
+
+    /*******************************************/
+    /*  Output Adjustments by Safety Checker   */
+    /*******************************************/
+    SafetyChecker_updateFast(vcu->sc, state);
+    SafetyChecker_reduceTorque(vcu->sc, vcu->mcm0, vcu->bms);
+
+    /*******************************************/
+    /*              Enact Outputs              */
+    /*******************************************/
+    //Handle motor controller startup procedures
+    MCM_relayControl(vcu->mcm0, &Sensor_HVILTerminationSense);
+    MCM_inverterControl(vcu->mcm0, vcu->tps, vcu->bps, vcu->rtds);
+
+    vcu_captureOutputs(vcu, state);
+    VehicleStateBuffer_publish(vcu->state);
+
+    //Startup handshake steps go out this tick, not on 0xC0's next change/period
+    if (MCM_commands_takeSendRequest(vcu->mcm0) == TRUE) { CanManager_requestSend(vcu->canMan, 0xC0); }
+    canOutput_sendMCMCommand(vcu->canMan, state);
+    DataLogger_record(vcu->logger, state);
+}
+
+static void task_medium(void* object)
+{
+    VCUTaskObjects* vcu = (VCUTaskObjects*)object;
+
+    //General CAN0 FIFO (BMS) and CAN1 (debug control, dash, DAQ).  The background task also drains them when there's time.
+    CanManager_read(vcu->canMan, CAN0_HIPRI);
+    CanManager_read(vcu->canMan, CAN1_LOPRI);
+
+    //Run calibration if commanded
+    if (Sensor_EcoButton.sensorValue == TRUE)
+    {
+        if (vcu->timestamp_EcoButton == 0)
+        {
+            SerialManager_send(vcu->serialMan, "Eco button detected\n");
+            IO_RTC_StartTime(&vcu->timestamp_EcoButton);
+        }
+        else if (IO_RTC_GetTimeUS(vcu->timestamp_EcoButton) >= 3000000)
+        {
+            SerialManager_send(vcu->serialMan, "Eco button held 3s - starting calibrations\n");
+            TorqueEncoder_startCalibration(vcu->tps, 5);
+            BrakePressureSensor_startCalibration(vcu->bps, 5);
+            Light_set(Light_dashTCS, 1);
+            //DIGITAL OUTPUT 4 for STATUS LED
+        }
+    }
+    else
+    {
+        if (IO_RTC_GetTimeUS(vcu->timestamp_EcoButton) > 10000 && IO_RTC_GetTimeUS(vcu->timestamp_EcoButton) < 1000000)
+        {
+            SerialManager_send(vcu->serialMan, "Eco mode requested\n");
+        }
+        vcu->timestamp_EcoButton = 0;
+    }
+
+    //DataAquisition_update(); //includes accelerometer
+    //TireModel_update()
+    //ControlLaw_update();
+
+    MCM_readTCSSettings(vcu->mcm0, &Sensor_TCSSwitchUp, &Sensor_TCSSwitchDown, &Sensor_TCSKnob);
+    if (MCM_customRegenSaveRequested(vcu->mcm0) == TRUE) { MCM_saveCustomRegenToEEPROM(vcu->mcm0, vcu->eeprom); }
+
+    LOOPTIMING_START(LOOPTIMING_SAFETY_UPDATE);
+    SafetyChecker_update(vcu->sc, vcu->mcm0, vcu->bms, VehicleStateBuffer_getFront(vcu->state));
+    LOOPTIMING_STOP(LOOPTIMING_SAFETY_UPDATE);
+    //MOVE INTO SAFETYCHECKER
+    Light_set(Light_dashError, (SafetyChecker_getFaults(vcu->sc) == 0) ? 0 : 1);
+
+    RTDS_shutdownHelper(vcu->rtds); //Stops the RTDS from playing if the set time has elapsed
+
+    //Freeze frames out on CAN1 (only does anything after a capture)
+    DataLogger_task(vcu->logger, vcu->canMan);
+}
+
+static void task_slow(void* object)
+{
+    VCUTaskObjects* vcu = (VCUTaskObjects*)object;
+    const VehicleState* state = VehicleStateBuffer_getFront(vcu->state);
+
+    CoolingSystem_calculations(vcu->cs, state->mcmTemp, state->motorTemp, state->batteryMaxTemp, state->mcmPowerW, state->bmsPowerW);
+    CoolingSystem_enactCooling(vcu->cs);
+
+    //Send debug data (each message is only built when it's due)
+    LOOPTIMING_START(LOOPTIMING_TELEMETRY);
+    canOutput_sendDebugMessage(vcu->canMan, state, vcu->tps, vcu->bps, vcu->mcm0);
+    LOOPTIMING_STOP(LOOPTIMING_TELEMETRY);
+
+    //Loop timing stats on 0x50A-0x50C (1 Hz)
+    LOOPTIMING_PUBLISH(vcu->canMan);
+
+    //Bus load and FIFO stats on 0x50F (1 Hz)
+    CanManager_publishBusStats(vcu->canMan);
+}
+
+//Spare time in each tick: keep the general CAN receive FIFOs drained so they don't overflow between medium ticks
+static void task_background_readCan(void* object)
+{
+    VCUTaskObjects* vcu = (VCUTaskObjects*)object;
+    CanManager_read(vcu->canMan, CAN0_HIPRI);
+    CanManager_read(vcu->canMan, CAN1_LOPRI);
+}
+
 /*****************************************************************************
 * Main!
 * Initializes I/O
@@ -107,8 +363,6 @@ extern Sensor Sensor_EcoButton;
 void main(void)
 {
     ubyte4 timestamp_startTime = 0;
-    ubyte4 timestamp_EcoButton = 0;
-    ubyte1 calibrationErrors;  //NOT USED
     
     /*******************************************/
     /*        Low Level Initializations        */
@@ -122,7 +376,7 @@ void main(void)
     SerialManager_send(serialMan, "VCU serial is online.\n");
 
     //Read initial values from EEPROM
-    //EEPROMManager* EEPROMManager_new();
+    EEPROMManager* eeprom = EEPROMManager_new(serialMan);
 
 
     /*******************************************/
@@ -133,21 +387,27 @@ void main(void)
     //----------------------------------------------------------------------------
     // Check if we're on the bench or not
     //----------------------------------------------------------------------------
-    bool bench;
+    //IO_DI (digital inputs) take a couple of driver cycles before they return valid data,
+    //so stop as soon as the pin has read OK twice.  55 ms is only the fallback.
+    bool bench = FALSE;
+    ubyte1 benchReadings = 0;
+    ubyte4 timestamp_benchProbe = 0;
     IO_DI_Init(IO_DI_06, IO_DI_PD_10K);
-    IO_RTC_StartTime(&timestamp_startTime);
-    while (IO_RTC_GetTimeUS(timestamp_startTime) < 55555)
+    IO_RTC_StartTime(&timestamp_benchProbe);
+    while (benchReadings < 2 && IO_RTC_GetTimeUS(timestamp_benchProbe) < 55555)
     {
+        ubyte4 timestamp_cycle;
+        IO_RTC_StartTime(&timestamp_cycle);
         IO_Driver_TaskBegin();
 
-        //IO_DI (digital inputs) supposed to take 2 cycles before they return valid data
-        IO_DI_Get(IO_DI_06, &bench);
+        if (IO_DI_Get(IO_DI_06, &bench) == IO_E_OK) { benchReadings++; }
+        SerialManager_task(serialMan);
 
         IO_Driver_TaskEnd();
-        //TODO: Find out if EACH pin needs 2 cycles or just the entire DIO unit
-        while (IO_RTC_GetTimeUS(timestamp_startTime) < 10000);   // wait until 10ms have passed
+        while (IO_RTC_GetTimeUS(timestamp_cycle) < 1000);   //1 ms driver cycle
     }
     IO_DI_DeInit(IO_DI_06);
+    if (benchReadings < 2) { SerialManager_log(serialMan, SERIAL_WARNING, "Bench detect pin never read OK\n"); }
     SerialManager_send(serialMan, bench == TRUE ? "VCU is in bench mode.\n" : "VCU is NOT in bench mode.\n");
     
     //----------------------------------------------------------------------------
@@ -160,11 +420,12 @@ void main(void)
     //vcu_initializeCAN();
     //vcu_initializeMCU();
 
-    //Do some loops until the ADC stops outputting garbage values
-    vcu_ADCWasteLoop();
+    //The ADC/sensors settle while the objects below are created - see vcu_waitForSensors
 
     //vcu_init functions may have to be performed BEFORE creating CAN Manager object
-    CanManager* canMan = CanManager_new(500, 40, 40, 500, 20, 20, 200000, serialMan);  //3rd param = messages per node (can0/can1; read/write)
+    //CAN0 only sends the inverter command, so most of the write objects go to CAN1 (telemetry,
+    //loop timing and bus stats, up to ~40 frames in the 1 Hz tick, plus the gateway and freeze frames)
+    CanManager* canMan = CanManager_new(500, 32, 8, 500, 20, 52, 200000, serialMan);  //3rd param = messages per node (can0/can1; read/write).  Sum + 8 (inverter FIFO) must be < 128
     //can0_busSpeed ---------------------^    ^   ^   ^    ^   ^     ^         ^
     //can0_read_messageLimit -----------------|   |   |    |   |     |         |
     //can0_write_messageLimit---------------------+   |    |   |     |         |
@@ -183,166 +444,83 @@ void main(void)
     MotorController* mcm0 = MotorController_new(serialMan, 0xA0, FORWARD, 1000, 5, 15); //CAN addr, direction, torque limit x10 (100 = 10Nm)
 	TorqueEncoder* tps = TorqueEncoder_new(bench);
 	BrakePressureSensor* bps = BrakePressureSensor_new();
+    //Stored calibrations replace the defaults above (skipping the Eco button + pedal sweep at power up)
+    SerialManager_send(serialMan, TorqueEncoder_loadCalibrationFromEEPROM(tps, eeprom) == TRUE ? "TPS calibration loaded from EEPROM\n" : "TPS using default calibration\n");
+    SerialManager_send(serialMan, BrakePressureSensor_loadCalibrationFromEEPROM(bps, eeprom) == TRUE ? "BPS calibration loaded from EEPROM\n" : "BPS using default calibration\n");
+    SerialManager_send(serialMan, MCM_loadCustomRegenFromEEPROM(mcm0, eeprom) == TRUE ? "Custom regen mode loaded from EEPROM\n" : "Custom regen mode off (nothing in EEPROM)\n");
 	WheelSpeeds* wss = WheelSpeeds_new(18, 18, 16, 16);
 	SafetyChecker* sc = SafetyChecker_new(serialMan, 320, 32);  //Must match amp limits 
 	BatteryManagementSystem* bms = BMS_new(serialMan, 0x620);
     CoolingSystem* cs = CoolingSystem_new(serialMan);
+    DataLogger* logger = DataLogger_new();
+    VehicleStateBuffer* state = VehicleStateBuffer_new();
+
+    //----------------------------------------------------------------------------
+    // Tell the CAN manager which objects receive which messages
+    //----------------------------------------------------------------------------
+    CanManager_registerReceiver(canMan, CAN0_HIPRI, 0xA0, 0xAF, (CanMessageParser)MCM_parseCanMessage, mcm0);  //Motor controller
+    CanManager_registerReceiver(canMan, CAN0_HIPRI, 0x620, 0x629, (CanMessageParser)BMS_parseCanMessage, bms);  //BMS
+    for (ubyte2 messageID = 0x620; messageID <= 0x629; messageID++)
+    {
+        BMS_setMessageTimeout(bms, messageID, CanManager_getMessageTimeout(canMan, messageID));  //Stale check (SafetyChecker)
+    }
+    CanManager_registerReceiver(canMan, CAN1_LOPRI, VCU_DEBUG_MESSAGE_ID, VCU_DEBUG_MESSAGE_ID, (CanMessageParser)SafetyChecker_parseCanMessage, sc);  //VCU debug control
+    CanManager_registerReceiver(canMan, CAN1_LOPRI, VCU_DEBUG_MESSAGE_ID, VCU_DEBUG_MESSAGE_ID, (CanMessageParser)MCM_parseCanMessage, mcm0);  //VCU debug control (HVIL override, custom regen)
+    CanManager_registerReceiver(canMan, CAN1_LOPRI, VCU_DEBUG_MESSAGE_ID, VCU_DEBUG_MESSAGE_ID, (CanMessageParser)DataLogger_parseCanMessage, logger);  //VCU debug control (capture request)
+
+    //----------------------------------------------------------------------------
+    // Wait for valid sensor data (usually done well before the timeout, since the
+    // constructors above already used up most of the settle time)
+    //----------------------------------------------------------------------------
+    if (vcu_waitForSensors(serialMan, 300000) == TRUE)
+    {
+        ubyte1 message[48];
+        sprintf(message, "Sensors ready %lu ms after power up\n", (unsigned long)(IO_RTC_GetTimeUS(timestamp_startTime) / 1000));
+        SerialManager_send(serialMan, message);
+    }
 
     //----------------------------------------------------------------------------
     // TODO: Additional Initial Power-up functions
     //----------------------------------------------------------------------------
-    //TODO: Read calibration data from EEPROM?
     //TODO: Run calibration functions?
     //TODO: Power-on error checking?
 
     /*******************************************/
     /*       PERIODIC APPLICATION CODE         */
     /*******************************************/
-    /* main loop, executed periodically with a defined cycle time (here: 5 ms) */
-    ubyte4 timestamp_mainLoopStart = 0;
-    //IO_RTC_StartTime(&timestamp_calibStart);
-    SerialManager_send(serialMan, "VCU initializations complete.  Entering main loop.\n");
-    while (1)
-    {
-        //----------------------------------------------------------------------------
-        // Task management stuff (start)
-        //----------------------------------------------------------------------------
-        //Get a timestamp of when this task started from the Real Time Clock
-        IO_RTC_StartTime(&timestamp_mainLoopStart);
-        //Mark the beginning of a task - what does this actually do?
-        IO_Driver_TaskBegin();
-
-        //SerialManager_send(serialMan, "VCU has entered main loop.");
-
-        
-        /*******************************************/
-        /*              Read Inputs                */
-        /*******************************************/
-        //----------------------------------------------------------------------------
-        // Handle data input streams
-        //----------------------------------------------------------------------------
-        //Get readings from our sensors and other local devices (buttons, 12v battery, etc)
-		sensors_updateSensors();
-
-        //Pull messages from CAN FIFO and update our object representations.
-        //Also echoes can0 messages to can1 for DAQ.
-        CanManager_read(canMan, CAN0_HIPRI, mcm0, bms, sc);
-        /*switch (CanManager_getReadStatus(canMan, CAN0_HIPRI))
-        {
-            case IO_E_OK: SerialManager_send(serialMan, "IO_E_OK: everything fine\n"); break;
-            case IO_E_NULL_POINTER: SerialManager_send(serialMan, "IO_E_NULL_POINTER: null pointer has been passed to function\n"); break;
-            case IO_E_CAN_FIFO_FULL: SerialManager_send(serialMan, "IO_E_CAN_FIFO_FULL: overflow of FIFO buffer\n"); break;
-            case IO_E_CAN_WRONG_HANDLE: SerialManager_send(serialMan, "IO_E_CAN_WRONG_HANDLE: invalid handle has been passed\n"); break;
-            case IO_E_CHANNEL_NOT_CONFIGURED: SerialManager_send(serialMan, "IO_E_CHANNEL_NOT_CONFIGURED: the given handle has not been configured\n"); break;
-            case IO_E_CAN_OLD_DATA: SerialManager_send(serialMan, "IO_E_CAN_OLD_DATA: no data has been received\n"); break;
-            default: SerialManager_send(serialMan, "Warning: Unknown CAN read status\n"); break;
-        }*/
-
-
-        /*******************************************/
-        /*          Perform Calculations           */
-        /*******************************************/
-        //calculations - Now that we have local sensor data and external data from CAN, we can
-        //do actual processing work, from pedal travel calcs to traction control
-        //calculations_calculateStuff();
-
-        //Run calibration if commanded
-		//if (IO_RTC_GetTimeUS(timestamp_calibStart) < (ubyte4)5000000)
-		if (Sensor_EcoButton.sensorValue == TRUE)
-		{
-            if (timestamp_EcoButton == 0)
-            {
-                SerialManager_send(serialMan, "Eco button detected\n");
-                IO_RTC_StartTime(&timestamp_EcoButton);
-            }
-            else if (IO_RTC_GetTimeUS(timestamp_EcoButton) >= 3000000)
-            {
-                SerialManager_send(serialMan, "Eco button held 3s - starting calibrations\n");
-                //calibrateTPS(TRUE, 5);
-                TorqueEncoder_startCalibration(tps, 5);
-                BrakePressureSensor_startCalibration(bps, 5);
-                Light_set(Light_dashTCS, 1);
-                //DIGITAL OUTPUT 4 for STATUS LED
-            }
-		}
-        else
-        {
-            if (IO_RTC_GetTimeUS(timestamp_EcoButton) > 10000 && IO_RTC_GetTimeUS(timestamp_EcoButton) < 1000000)
-            {
-                SerialManager_send(serialMan, "Eco mode requested\n");
-            }
-            timestamp_EcoButton = 0;
-        }
-		TorqueEncoder_update(tps);
-        //Every cycle: if the calibration was started and hasn't finished, check the values again
-        TorqueEncoder_calibrationCycle(tps, &calibrationErrors); //Todo: deal with calibration errors
-		BrakePressureSensor_update(bps, bench);
-		BrakePressureSensor_calibrationCycle(bps, &calibrationErrors);
-
-		//TractionControl_update(tps, mcm0, wss, daq);
-
-		WheelSpeeds_update(wss);
-		//DataAquisition_update(); //includes accelerometer
-		//TireModel_update()
-		//ControlLaw_update();
-		/*
-		ControlLaw //Tq command
-			TireModel //used by control law -> read from WSS, accelerometer
-			StateObserver //choose driver command or ctrl law
-		*/	
-
-        CoolingSystem_calculations(cs, MCM_getTemp(mcm0), MCM_getMotorTemp(mcm0), BMS_getMaxTemp(bms));
-        //CoolingSystem_calculations(cs, 20, 20, 20);
-        CoolingSystem_enactCooling(cs); //This belongs under outputs but it doesn't really matter for cooling
-
-        //Assign motor controls to MCM command message
-        //motorController_setCommands(rtds);
-        //DOES NOT set inverter command or rtds flag
-        MCM_readTCSSettings(mcm0, &Sensor_TCSSwitchUp, &Sensor_TCSSwitchDown, &Sensor_TCSKnob);
-        MCM_calculateCommands(mcm0, tps, bps);
-
-        SafetyChecker_update(sc, mcm0, bms, tps, bps, &Sensor_HVILTerminationSense, &Sensor_LVBattery);
-
-        /*******************************************/
-        /*  Output Adjustments by Safety Checker   */
-        /*******************************************/
-        SafetyChecker_reduceTorque(sc, mcm0, bms);
-
-        /*******************************************/
-        /*              Enact Outputs              */
-        /*******************************************/
-        //MOVE INTO SAFETYCHECKER
-        //SafetyChecker_setErrorLight(sc);
-        Light_set(Light_dashError, (SafetyChecker_getFaults(sc) == 0) ? 0 : 1);
-        //Handle motor controller startup procedures
-        MCM_relayControl(mcm0, &Sensor_HVILTerminationSense);
-        MCM_inverterControl(mcm0, tps, bps, rtds);
-        //CanManager_sendMCMCommandMessage(mcm0, canMan, FALSE);
-
-        //Drop the sensor readings into CAN (just raw data, not calculated stuff)
-        //canOutput_sendMCUControl(mcm0, FALSE);
-
-        //Send debug data
-        canOutput_sendDebugMessage(canMan, tps, bps, mcm0, wss, sc);
-        //canOutput_sendSensorMessages();
-        //canOutput_sendStatusMessages(mcm0);
-
-        
-
-        //----------------------------------------------------------------------------
-        // Task management stuff (end)
-        //----------------------------------------------------------------------------
-        RTDS_shutdownHelper(rtds); //Stops the RTDS from playing if the set time has elapsed
-
-        //Task end function for IO Driver - This function needs to be called at the end of every SW cycle
-        IO_Driver_TaskEnd();
-        //wait until the cycle time is over
-        while (IO_RTC_GetTimeUS(timestamp_mainLoopStart) < 33000) // 1000 = 1ms
-        {
-            IO_UART_Task();  //The task function shall be called every SW cycle.
-        }
+    static VCUTaskObjects vcu;
+    vcu.bench = bench;
+    vcu.serialMan = serialMan;
+    vcu.eeprom = eeprom;
+    vcu.canMan = canMan;
+    vcu.rtds = rtds;
+    vcu.mcm0 = mcm0;
+    vcu.tps = tps;
+    vcu.bps = bps;
+    vcu.wss = wss;
+    vcu.sc = sc;
+    vcu.bms = bms;
+    vcu.cs = cs;
+    vcu.logger = logger;
+    vcu.state = state;
+    vcu.timestamp_EcoButton = 0;
+
+    Scheduler* scheduler = Scheduler_new(MAIN_TICK_US);
+    LOOPTIMING_SET_BUDGET(LOOPTIMING_TICK, MAIN_TICK_US);  //Count ticks that finished late
+    //                                        period (ticks)  phase (ticks)
+    Scheduler_addTask(scheduler, task_fast,   &vcu,  1,              0);  //5 ms
+    Scheduler_addTask(scheduler, task_medium, &vcu,  4,              1);  //20 ms
+    Scheduler_addTask(scheduler, task_slow,   &vcu, 20,              2);  //100 ms
+    Scheduler_addBackgroundTask(scheduler, (SchedulerTaskFunction)CanManager_transmit, canMan);  //Telemetry queued by this tick's tasks
+    Scheduler_addBackgroundTask(scheduler, task_background_readCan, &vcu);
+    Scheduler_addBackgroundTask(scheduler, (SchedulerTaskFunction)SerialManager_task, serialMan);
+    Scheduler_addBackgroundTask(scheduler, (SchedulerTaskFunction)EEPROMManager_task, eeprom);
+
+    //Every object has been created by now (see arena.h)
+    Arena_report(serialMan);
 
-    } //end of main loop
+    SerialManager_send(serialMan, "VCU initializations complete.  Entering main loop.\n");
+    Scheduler_run(scheduler);  //Never returns
 
     //----------------------------------------------------------------------------
     // VCU Subsystem Deinitializations
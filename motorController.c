@@ -1,11 +1,14 @@
-#include <stdlib.h>  //Needed for malloc
+#include <stddef.h>  //offsetof
 #include "IO_Driver.h"
 #include "IO_DIO.h"     //TEMPORARY - until MCM relay control  / ADC stuff gets its own object
 #include "IO_RTC.h"
 #include "IO_CAN.h"
 
 #include "motorController.h"
+#include "arena.h"
 #include "mathFunctions.h"
+#include "fixedPoint.h"
+#include "lookupTable.h"
 #include "sensors.h"
 #include "sensorCalculations.h"
 
@@ -15,6 +18,7 @@
 #include "serial.h"
 
 #include "canManager.h"
+#include "canSignals.h"
 
 
 extern Sensor Sensor_BenchTPS0;
@@ -27,6 +31,34 @@ extern Sensor Sensor_TCSSwitchDown; // used currently for regen
 extern Sensor Sensor_TCSKnob;    // used currently for regen
 extern Sensor Sensor_HVILTerminationSense;
 
+//Regen knob filtering: a new position has to be past the band edge by REGEN_KNOB_HYSTERESIS
+//counts for REGEN_KNOB_DEBOUNCE consecutive readings (one per medium task = 60 ms)
+#define MCM_REGEN_KNOB_HYSTERESIS 24
+#define MCM_REGEN_KNOB_DEBOUNCE   3
+#define MCM_REGEN_KNOB_UNREAD     0xFF
+
+//Inverter startup waits.  Lockout: the MCM has to boot after the relay closes.
+#define MCM_STARTUP_LOCKOUT_TIMEOUT_US  2000000
+#define MCM_STARTUP_ENABLE_TIMEOUT_US   1000000
+#define MCM_STARTUP_RETRIES             3
+
+//Mode 4 / VCU debug control (0x5FF byte 0)
+#define MCM_REGEN_CUSTOM_MODE     4
+
+//Pedals -> torque for one set of regen settings, all worked out when the settings change.
+//Slopes are dNm per Q15 count of pedal travel (16.16), so each pedal costs one multiply.
+//  APPS above the coasting point: drive   = (tps - appsCoasting) * driveSlope
+//  APPS below the coasting point: regen   = (appsCoasting - tps) * coastRegenSlope
+//  BPS:                           regen  += min(bps, bpsForMaxRegen) * brakeRegenSlope
+typedef struct _RegenTorqueMap
+{
+    Q15 appsCoasting;
+    Q15 bpsForMaxRegen;
+    ubyte4 driveSlope;
+    ubyte4 coastRegenSlope;
+    ubyte4 brakeRegenSlope;
+} RegenTorqueMap;
+
 /*****************************************************************************
  * Motor Controller (MCM)
  ******************************************************************************
@@ -53,8 +85,19 @@ struct _MotorController {
 	ubyte1 regen_mode;					  //Software reading of regen knob position.  Each mode has different regen behavior (variables below).
 	ubyte2 regen_torqueLimitDNm;          //Tuneable value.  Regen torque (in Nm) at full regen.  Positive value.
 	ubyte2 regen_torqueAtZeroPedalDNm;    //Tuneable value.  Amount of regen torque (in Nm) to apply when both pedals at 0% travel.  Positive value.
-	float4 regen_percentBPSForMaxRegen;   //Tuneable value.  Amount of brake pedal required for full regen. Value between zero and one.
-	float4 regen_percentAPPSForCoasting;  //Tuneable value.  Amount of accel pedal required to exit regen.  Value between zero and one.
+	Q15 regen_percentBPSForMaxRegen;      //Tuneable value.  Amount of brake pedal required for full regen. Value between zero and FIXEDPOINT_ONE.
+	Q15 regen_percentAPPSForCoasting;     //Tuneable value.  Amount of accel pedal required to exit regen.  Value between zero and FIXEDPOINT_ONE.
+
+    //Torque map for the current regen settings (see MCM_setRegenMap)
+    RegenTorqueMap regen_map;
+
+    //Knob position filtering (see MCM_readTCSSettings)
+    ubyte1 regen_knobBand;                //Accepted knob position (band of regenKnobAxis)
+    ubyte1 regen_knobCandidate;           //Position the knob has moved to, waiting out the debounce
+    ubyte1 regen_knobCount;               //Consecutive readings at the candidate position
+
+    ubyte1 regen_custom[4];               //Mode 4 settings, 0-255 each (see MCM_setCustomRegen)
+    bool regen_customSaveRequested;
     sbyte1 regen_minimumSpeedKPH;  //Assigned by main
     sbyte1 regen_SpeedRampStart;
 
@@ -63,9 +106,15 @@ struct _MotorController {
     ubyte4 timeStamp_HVILLost;
 
     ubyte4 timeStamp_HVILOverrideCommandReceived;
+    bool HVILOverrideRequested;   //A request has arrived since the last one expired (the timestamp means nothing until then)
     bool HVILOverride;
 
-    ubyte1 startupStage;
+    ubyte1 startupStage;                  //McmStartupStage
+    ubyte4 timeStamp_startupStage;        //When startupStage was entered
+    ubyte2 startupStageTime_ms[MCM_STARTUP_STAGES];
+    ubyte1 startupRetries;
+    bool startupButtonHeld;               //Enable timed out: ignore the RTD button until it's been released (needs a new press)
+    bool commandSendRequested;            //Send the next 0xC0 now
     Status lockoutStatus;
 	Status inverterStatus;
 	bool startRTDS;
@@ -127,9 +176,28 @@ struct _MotorController {
     //};
 };
 
+//Torque (dNm) per Q15 count of pedal travel, as 16.16.  torque * 2^16 fits a ubyte4 and
+//pedal travel never exceeds the span it was made for, so slope * travel can't overflow.
+static ubyte4 MCM_regenSlope(ubyte2 torqueDNm, Q15 pedalTravel)
+{
+    return (pedalTravel == 0) ? 0 : ((ubyte4)torqueDNm << 16) / (ubyte2)pedalTravel;
+}
+
+//Precomputes the torque map for the current regen settings, so calculateCommands doesn't divide
+static void MCM_setRegenMap(MotorController* me)
+{
+    RegenTorqueMap* map = &me->regen_map;
+
+    map->appsCoasting = me->regen_percentAPPSForCoasting;
+    map->bpsForMaxRegen = me->regen_percentBPSForMaxRegen;
+    map->driveSlope = MCM_regenSlope(me->torqueMaximumDNm, FIXEDPOINT_ONE - me->regen_percentAPPSForCoasting);
+    map->coastRegenSlope = MCM_regenSlope(me->regen_torqueAtZeroPedalDNm, me->regen_percentAPPSForCoasting);
+    map->brakeRegenSlope = MCM_regenSlope(me->regen_torqueLimitDNm - me->regen_torqueAtZeroPedalDNm, me->regen_percentBPSForMaxRegen);
+}
+
 MotorController* MotorController_new(SerialManager* sm, ubyte2 canMessageBaseID, Direction initialDirection, sbyte2 torqueMaxInDNm, sbyte1 minRegenSpeedKPH, sbyte1 regenRampdownStartSpeed)
 {
-	MotorController* me = (MotorController*)malloc(sizeof(struct _MotorController));
+	MotorController* me = (MotorController*)Arena_allocate(ARENA_INTERNAL, sizeof(struct _MotorController));
     me->serialMan = sm;
 
 	me->canMessageBaseId = canMessageBaseID;
@@ -150,16 +218,29 @@ MotorController* MotorController_new(SerialManager* sm, ubyte2 canMessageBaseID,
 	me->regen_mode = 0xFF;
 	me->regen_torqueLimitDNm = 0;
 	me->regen_torqueAtZeroPedalDNm = 0;
-    me->regen_percentBPSForMaxRegen = 1; //zero to one.. 1 = 100%
+    me->regen_percentBPSForMaxRegen = FIXEDPOINT_ONE; //zero to one.. 1 = 100%
 	me->regen_percentAPPSForCoasting = 0;
+    MCM_setRegenMap(me);
+    me->regen_knobBand = MCM_REGEN_KNOB_UNREAD;
+    me->regen_knobCandidate = MCM_REGEN_KNOB_UNREAD;
+    me->regen_knobCount = 0;
+    for (ubyte1 i = 0; i < sizeof(me->regen_custom); i++) { me->regen_custom[i] = 0; }
+    me->regen_customSaveRequested = FALSE;
     me->regen_minimumSpeedKPH = minRegenSpeedKPH;  //Assigned by main
     me->regen_SpeedRampStart = regenRampdownStartSpeed;  //Assigned by main
 
     //me->faultHistory = { 0,0,0,0,0,0,0,0 };  //Todo: read from eeprom instead of defaulting to 0
 
-	me->startupStage = 0; //Off
+	me->startupStage = MCM_STARTUP_HV_OFF;
+    IO_RTC_StartTime(&me->timeStamp_startupStage);
+    for (ubyte1 stage = 0; stage < MCM_STARTUP_STAGES; stage++) { me->startupStageTime_ms[stage] = 0; }
+    me->startupRetries = 0;
+    me->startupButtonHeld = FALSE;
+    me->commandSendRequested = FALSE;
     
     me->relayState = FALSE; //Low
+    me->HVILOverrideRequested = FALSE;  //Starts expired
+    me->HVILOverride = FALSE;
 
     me->motor_temp = 99;
 	/*
@@ -190,60 +271,144 @@ me->getInverterStatus = &getInverterStatus;
 // 4    3DA  986
 // .    3DA  986
 
+//Pot reading -> knob position.  Each breakpoint is where the next position starts;
+//regenKnobModes has one entry per band (below the first breakpoint .. above the last).
+static const sbyte2 regenKnobThresholds[] = { 0xA1, 0x230, 0x383, 5001 };
+static const ubyte1 regenKnobModes[] = { 1, 2, 3, 4, 0 };  //>5000 = clicked off (resistance goes to FFFF)
+static const LookupAxis regenKnobAxis = LOOKUPTABLE_AXIS(regenKnobThresholds);
+
+typedef struct _RegenSettings
+{
+    Q15 torqueLimit;             //Fraction of torqueMaximumDNm
+    Q15 torqueAtZeroPedal;       //Fraction of the regen torque limit
+    Q15 percentAPPSForCoasting;
+    Q15 percentBPSForMaxRegen;
+} RegenSettings;
+
+static const RegenSettings regenModeSettings[] =
+{
+    { 0,       0,              0,        0        },  //0 = Regen off
+    { Q15(.5), 0,              0,        Q15(.3)  },  //1 = Coasting mode (Formula E mode)
+    { Q15(.5), Q15(.3),        Q15(.2),  Q15(.3)  },  //2 = Light "engine braking" (Hybrid mode)
+    { Q15(.5), FIXEDPOINT_ONE, Q15(.1),  0        },  //3 = One pedal driving (Tesla mode)
+    { 0,       0,              0,        0        },  //4 = User customizable
+};
+
+//Applies a regen profile: torque values from the profile's fractions, then the torque map
+static void MCM_setRegenSettings(MotorController* me, ubyte1 mode, const RegenSettings* settings)
+{
+    me->regen_mode = mode;
+    me->regen_torqueLimitDNm = FixedPoint_mul(me->torqueMaximumDNm, settings->torqueLimit);
+    me->regen_torqueAtZeroPedalDNm = FixedPoint_mul(me->regen_torqueLimitDNm, settings->torqueAtZeroPedal);
+    me->regen_percentAPPSForCoasting = settings->percentAPPSForCoasting;
+    me->regen_percentBPSForMaxRegen = settings->percentBPSForMaxRegen;
+    MCM_setRegenMap(me);
+}
+
+static void MCM_selectRegenMode(MotorController* me, ubyte1 mode)
+{
+    if (mode == MCM_REGEN_CUSTOM_MODE)
+    {
+        //Stored as 0-255 (EEPROM / CAN) - same order as RegenSettings
+        RegenSettings custom;
+        custom.torqueLimit = FixedPoint_percentOf(me->regen_custom[0], 0, 0xFF);
+        custom.torqueAtZeroPedal = FixedPoint_percentOf(me->regen_custom[1], 0, 0xFF);
+        custom.percentAPPSForCoasting = FixedPoint_percentOf(me->regen_custom[2], 0, 0xFF);
+        custom.percentBPSForMaxRegen = FixedPoint_percentOf(me->regen_custom[3], 0, 0xFF);
+        MCM_setRegenSettings(me, mode, &custom);
+    }
+    else
+    {
+        MCM_setRegenSettings(me, mode, &regenModeSettings[mode]);
+    }
+}
+
+//Knob band with hysteresis: the reading has to be MCM_REGEN_KNOB_HYSTERESIS past
+//an edge before it counts as the neighbouring position
+static ubyte1 MCM_regenKnobBand(MotorController* me, sbyte4 reading)
+{
+    ubyte1 band = LookupTable_band(&regenKnobAxis, reading - MCM_REGEN_KNOB_HYSTERESIS);
+    if (band > me->regen_knobBand) { return band; }
+
+    band = LookupTable_band(&regenKnobAxis, reading + MCM_REGEN_KNOB_HYSTERESIS);
+    if (band < me->regen_knobBand) { return band; }
+
+    return me->regen_knobBand;
+}
+
 void MCM_readTCSSettings(MotorController* me, Sensor* TCSSwitchUp, Sensor* TCSSwitchDown, Sensor* TCSPot)
-{	
-	 
+{
+    sbyte4 reading = (sbyte4)TCSPot->sensorValue;
+    ubyte1 band;
 
-	//If the pot is clicked off (resistance goes to FFFF)
-	if (TCSPot->sensorValue > 5000)  //Position 0 = Regen Off
+    //First reading after power up is taken as is
+    if (me->regen_knobBand == MCM_REGEN_KNOB_UNREAD)
     {
-		me->regen_mode = 0;  
+        me->regen_knobBand = LookupTable_band(&regenKnobAxis, reading);
+        MCM_selectRegenMode(me, regenKnobModes[me->regen_knobBand]);
+        return;
+    }
 
-		me->regen_torqueLimitDNm = 0;
-		me->regen_torqueAtZeroPedalDNm = 0;
-		me->regen_percentAPPSForCoasting = 0;
-		me->regen_percentBPSForMaxRegen = 0; //zero to one.. 1 = 100%
-	}
-	else if (TCSPot->sensorValue < 0xA1)  //Position 1 = Coasting mode (Formula E mode)
-	{
-		me->regen_mode = 1;
-		me->regen_torqueLimitDNm = me->torqueMaximumDNm * 0.5;
-		me->regen_torqueAtZeroPedalDNm = 0;
-		me->regen_percentAPPSForCoasting = 0;
-		me->regen_percentBPSForMaxRegen = .3; //zero to one.. 1 = 100%
-	}
-	else if (TCSPot->sensorValue < 0x230)  //Position 2 = light "engine braking" (Hybrid mode)
-	{
-		me->regen_mode = 2;
-		me->regen_torqueLimitDNm = me->torqueMaximumDNm * 0.5;
-		me->regen_torqueAtZeroPedalDNm = me->regen_torqueLimitDNm * 0.3;
-		me->regen_percentAPPSForCoasting = .2;
-		me->regen_percentBPSForMaxRegen = .3; //zero to one.. 1 = 100%
-	}
-	else if (TCSPot->sensorValue < 0x383)  //Position 3 = One pedal driving (Tesla mode)
-	{
-		me->regen_mode = 3;
-		me->regen_torqueLimitDNm = me->torqueMaximumDNm * 0.5;
-		me->regen_torqueAtZeroPedalDNm = me->regen_torqueLimitDNm;
-		me->regen_percentAPPSForCoasting = .1;
-		me->regen_percentBPSForMaxRegen = 0;
-	}
-	else if (TCSPot->sensorValue >= 0x383)  //Position 4 = User customizable
-	{
-		me->regen_mode = 4;
-		me->regen_torqueLimitDNm = 0;
-		me->regen_torqueAtZeroPedalDNm = 0;
-		me->regen_percentBPSForMaxRegen = 0; //zero to one.. 1 = 100%
-		me->regen_percentAPPSForCoasting = 0;
-	}
-	else  //This should never happen
-	{
-		me->regen_mode = 0xFFFF;  //Default: Regen off
-		me->regen_torqueLimitDNm = 0;
-		me->regen_torqueAtZeroPedalDNm = 0;
-		me->regen_percentBPSForMaxRegen = 0; //zero to one.. 1 = 100%
-		me->regen_percentAPPSForCoasting = 0;
-	}
+    //Only switch profiles once the knob has settled in a new position
+    band = MCM_regenKnobBand(me, reading);
+    if (band == me->regen_knobBand)
+    {
+        me->regen_knobCount = 0;
+        return;
+    }
+    if (band != me->regen_knobCandidate)
+    {
+        me->regen_knobCandidate = band;
+        me->regen_knobCount = 0;
+    }
+    if (++me->regen_knobCount < MCM_REGEN_KNOB_DEBOUNCE) { return; }
+
+    me->regen_knobBand = band;
+    me->regen_knobCount = 0;
+    MCM_selectRegenMode(me, regenKnobModes[band]);
+}
+
+void MCM_setCustomRegen(MotorController* me, ubyte1 torqueLimit, ubyte1 torqueAtZeroPedal, ubyte1 appsForCoasting, ubyte1 bpsForMaxRegen)
+{
+    me->regen_custom[0] = torqueLimit;
+    me->regen_custom[1] = torqueAtZeroPedal;
+    me->regen_custom[2] = appsForCoasting;
+    me->regen_custom[3] = bpsForMaxRegen;
+
+    //Takes effect immediately if the knob is already on the custom position
+    if (me->regen_mode == MCM_REGEN_CUSTOM_MODE) { MCM_selectRegenMode(me, MCM_REGEN_CUSTOM_MODE); }
+}
+
+bool MCM_loadCustomRegenFromEEPROM(MotorController* me, EEPROMManager* eeprom)
+{
+    EEPROMCalibration calibration;
+
+    if (EEPROMManager_getCalibration(eeprom, &calibration) == FALSE) { return FALSE; }
+
+    MCM_setCustomRegen(me, calibration.regen_custom[0], calibration.regen_custom[1], calibration.regen_custom[2], calibration.regen_custom[3]);
+    return TRUE;
+}
+
+void MCM_saveCustomRegenToEEPROM(MotorController* me, EEPROMManager* eeprom)
+{
+    EEPROMCalibration calibration;
+    bool changed = (EEPROMManager_getCalibration(eeprom, &calibration) == FALSE);  //Keep the pedal calibrations
+
+    for (ubyte1 i = 0; i < sizeof(me->regen_custom); i++)
+    {
+        if (calibration.regen_custom[i] != me->regen_custom[i]) { changed = TRUE; }
+        calibration.regen_custom[i] = me->regen_custom[i];
+    }
+
+    //PCAN repeats the 0x5FF frame every cycle, so a held save bit asks again and again -
+    //only rewrite the record when there is something new in it
+    if (changed == TRUE) { EEPROMManager_setCalibration(eeprom, &calibration); }
+    me->regen_customSaveRequested = FALSE;
+}
+
+bool MCM_customRegenSaveRequested(MotorController* me)
+{
+    return me->regen_customSaveRequested;
 }
 
 /*****************************************************************************
@@ -267,7 +432,7 @@ void MCM_readTCSSettings(MotorController* me, Sensor* TCSSwitchUp, Sensor* TCSSw
 * > Enable inverter
 * > Play RTDS
 ****************************************************************************/
-void MCM_calculateCommands(MotorController* me, TorqueEncoder* tps, BrakePressureSensor* bps)
+void MCM_calculateCommands(MotorController* me, const VehicleState* state)
 {
 	//----------------------------------------------------------------------------
 	// Control commands
@@ -282,14 +447,26 @@ void MCM_calculateCommands(MotorController* me, TorqueEncoder* tps, BrakePressur
 	sbyte2 appsTorque = 0;
 	sbyte2 bpsTorque = 0;
 
-	appsTorque = me->torqueMaximumDNm * getPercent(tps->percent, me->regen_percentAPPSForCoasting, 1, TRUE) - me->regen_torqueAtZeroPedalDNm * getPercent(tps->percent, me->regen_percentAPPSForCoasting, 0, TRUE);
-	bpsTorque = 0 - (me->regen_torqueLimitDNm - me->regen_torqueAtZeroPedalDNm) * getPercent(bps->percent, 0, me->regen_percentBPSForMaxRegen, TRUE);
+	//Torque map is precomputed for the current regen mode (MCM_setRegenMap)
+	const RegenTorqueMap* map = &me->regen_map;
+	Q15 throttle = state->throttlePercent;
+	Q15 brake = state->brakePercent;
+	if (throttle >= map->appsCoasting)
+	{
+	    appsTorque = (sbyte2)(((ubyte4)(throttle - map->appsCoasting) * map->driveSlope) >> 16);
+	}
+	else
+	{
+	    appsTorque = 0 - (sbyte2)(((ubyte4)(map->appsCoasting - throttle) * map->coastRegenSlope) >> 16);
+	}
+	bpsTorque = 0 - (sbyte2)(((ubyte4)(brake < map->bpsForMaxRegen ? brake : map->bpsForMaxRegen) * map->brakeRegenSlope) >> 16);
 	
 	torqueOutput = appsTorque + bpsTorque;
-    //torqueOutput = me->torqueMaximumDNm * tps->percent;  //REMOVE THIS LINE TO ENABLE REGEN
+    //torqueOutput = me->torqueMaximumDNm * throttle;  //REMOVE THIS LINE TO ENABLE REGEN
     MCM_commands_setTorqueDNm(me, torqueOutput);
 
-    me->HVILOverride = (IO_RTC_GetTimeUS(me->timeStamp_HVILOverrideCommandReceived) < 1000000);
+    me->HVILOverride = (me->HVILOverrideRequested == TRUE && IO_RTC_GetTimeUS(me->timeStamp_HVILOverrideCommandReceived) < 1000000);
+    me->HVILOverrideRequested = me->HVILOverride;
 }
 
 void MCM_relayControl(MotorController* me, Sensor* HVILTermSense)
@@ -320,7 +497,7 @@ void MCM_relayControl(MotorController* me, Sensor* HVILTermSense)
                 //For now do nothing
             }
         }
-        MCM_setStartupStage(me, 0);
+        MCM_setStartupStage(me, MCM_STARTUP_HV_OFF);
         MCM_updateInverterStatus(me, UNKNOWN);
         MCM_updateLockoutStatus(me, UNKNOWN);
 
@@ -332,7 +509,11 @@ void MCM_relayControl(MotorController* me, Sensor* HVILTermSense)
         if (me->previousHVILState == FALSE)
         {
             SerialManager_send(me->serialMan, "Term sense went high\n");
-            if (MCM_getStartupStage(me) == 0) { MCM_setStartupStage(me, 1); }  //Reset the startup procedure because HV just went high and we are now turning on the MCM
+            if (MCM_getStartupStage(me) == MCM_STARTUP_HV_OFF)  //Reset the startup procedure because HV just went high and we are now turning on the MCM
+            {
+                MCM_setStartupStage(me, MCM_STARTUP_LOCKOUT);
+                me->commandSendRequested = TRUE;  //First disable out now, not on 0xC0's next period
+            }
         }
         me->previousHVILState = TRUE;
 
@@ -342,7 +523,61 @@ void MCM_relayControl(MotorController* me, Sensor* HVILTermSense)
     }
 }
 
+//Adds the time since the stage timer started to the current stage's total, and restarts the timer
+static void MCM_startupStageTimeAdd(MotorController* me)
+{
+    if (me->startupStage != MCM_STARTUP_HV_OFF && me->startupStage < MCM_STARTUP_STAGES)
+    {
+        ubyte4 total = me->startupStageTime_ms[me->startupStage] + IO_RTC_GetTimeUS(me->timeStamp_startupStage) / 1000;
+        me->startupStageTime_ms[me->startupStage] = (total > 0xFFFF) ? 0xFFFF : (ubyte2)total;
+    }
+    IO_RTC_StartTime(&me->timeStamp_startupStage);
+}
+
+//A wait on the inverter timed out.  Returns FALSE (and stalls until HV is cycled) when out of retries.
+static bool MCM_startupRetry(MotorController* me, const ubyte1* message)
+{
+    SerialManager_log(me->serialMan, SERIAL_WARNING, message);
+    me->commandSendRequested = TRUE;
+    if (me->startupRetries >= MCM_STARTUP_RETRIES)
+    {
+        SerialManager_log(me->serialMan, SERIAL_ERROR, "MCM startup stalled - cycle HV to retry.\n");
+        MCM_setStartupStage(me, MCM_STARTUP_STALLED);
+        return FALSE;
+    }
+    me->startupRetries++;
+    return TRUE;
+}
+
+//0xAA just arrived: take the transitions it allows now, instead of on the next inverterControl
+static void MCM_startupStatusReceived(MotorController* me)
+{
+    switch (MCM_getStartupStage(me))
+    {
+    case MCM_STARTUP_LOCKOUT:
+        if (MCM_getLockoutStatus(me) == DISABLED)
+        {
+            SerialManager_send(me->serialMan, "MCM lockout has been disabled.\n");
+            MCM_setStartupStage(me, MCM_STARTUP_WAIT_RTD);
+        }
+        break;
+
+    case MCM_STARTUP_ENABLING:
+        if (MCM_getInverterStatus(me) == ENABLED)
+        {
+            SerialManager_send(me->serialMan, "Inverter has been enabled.  Starting RTDS.  Car is ready to drive.\n");
+            MCM_setStartupStage(me, MCM_STARTUP_RTDS);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
 //See diagram at https://onedrive.live.com/redir?resid=F9BB8F0F8FDB5CF8!30410&authkey=!ABSF-uVH-VxQRAs&ithint=file%2chtml
+//Stages that wait on the inverter move when 0xAA arrives (MCM_startupStatusReceived); this handles
+//the driver side, the timeouts and the RTDS.
 void MCM_inverterControl(MotorController* me, TorqueEncoder* tps, BrakePressureSensor* bps, ReadyToDriveSound* rtds)
 {
     float4 RTDPercent;
@@ -354,78 +589,73 @@ void MCM_inverterControl(MotorController* me, TorqueEncoder* tps, BrakePressureS
 	//New Handshake NOTE: Switches connected to ground.. TRUE = high = off = disconnected = open circuit, FALSE = low = grounded = on = connected = closed circuit
     switch (MCM_getStartupStage(me))
     {
-    case 0: //MCM relay is off --> stay until lockout is enabled;
-        //It shouldn't be necessary to check mcm relayState or inverter status <> UNKNOWN
-        //but if we have trouble we can add that here.
+    case MCM_STARTUP_HV_OFF: //MCM relay is off --> stay until HV comes up (MCM_relayControl)
+    case MCM_STARTUP_STALLED:
+        MCM_commands_setInverter(me, DISABLED);
+        break;
 
-    case 1: //MCM relay is on, lockout=enabled, inverter=disabled --> stay until lockout is disabled
-        //Actions to perform upon entering this state ------------------------------------------------
+    case MCM_STARTUP_LOCKOUT: //MCM relay is on, lockout=enabled, inverter=disabled --> stay until lockout is disabled
+        //The disable command is what releases the lockout
         MCM_commands_setInverter(me, DISABLED);
         //Light_set(Light_dashRTD, 0);
 
-        //How to transition to next state ------------------------------------------------
-        if (MCM_getLockoutStatus(me) == DISABLED)
+        if (IO_RTC_GetTimeUS(me->timeStamp_startupStage) >= MCM_STARTUP_LOCKOUT_TIMEOUT_US)
         {
-            SerialManager_send(me->serialMan, "MCM lockout has been disabled.\n");
-            MCM_setStartupStage(me, 2); //MCM_getStartupStage(me) + 1);
+            if (MCM_startupRetry(me, "MCM lockout not released - sending disable again.\n") == TRUE)
+            {
+                MCM_startupStageTimeAdd(me);  //Same stage, new wait
+            }
         }
         break;
 
-    case 2: //MCM on, lockout=disabled, inverter=disabled --> stay until RTD button pressed
-        //Actions to perform upon entering this state ------------------------------------------------
-        //Nothing: wait for RTD button
+    case MCM_STARTUP_WAIT_RTD: //MCM on, lockout=disabled, inverter=disabled --> stay until RTD button pressed
+    {
+        //Ready to drive is always the driver's call: after an enable timeout, the press that started
+        //the failed attempt doesn't count - wait for the button to be released and pressed again
+        if (Sensor_RTDButton.sensorValue == FALSE) { me->startupButtonHeld = FALSE; }
 
-        //How to transition to next state ------------------------------------------------
-        if (Sensor_RTDButton.sensorValue == TRUE 
+        if (Sensor_RTDButton.sensorValue == TRUE
+            && me->startupButtonHeld == FALSE
             && tps->calibrated == TRUE
             && bps->calibrated == TRUE
-            && tps->percent < .1
-            && bps->percent > .25
+            && tps->percent < Q15(.1)
+            && bps->percent > Q15(.25)
             )
         {
             MCM_commands_setInverter(me, ENABLED);  //Change the inverter command to enable
+            me->commandSendRequested = TRUE;
             SerialManager_send(me->serialMan, "Changed MCM inverter command to ENABLE.\n");
-            MCM_setStartupStage(me, 3); // MCM_getStartupStage(me) + 1);
-            //RTDPercent = 1; //This line is redundant
+            MCM_setStartupStage(me, MCM_STARTUP_ENABLING);
         }
         break;
+    }
 
-    case 3: //inverted=disabled, rtd=pressed, waiting for inverter to be enabled
-        //Actions to perform upon entering this state ------------------------------------------------
-        //Nothing: wait for mcm to say it's enabled
-
-        //How to transition to next state ------------------------------------------------
-        if (MCM_getInverterStatus(me) == ENABLED)
+    case MCM_STARTUP_ENABLING: //inverter=disabled, rtd=pressed, waiting for inverter to be enabled
+        //If the inverter doesn't pick up the enable, go back through disable -> lockout clear -> RTD again
+        if (IO_RTC_GetTimeUS(me->timeStamp_startupStage) >= MCM_STARTUP_ENABLE_TIMEOUT_US)
         {
-            RTDPercent = 1; //Doesn't matter if button is no longer pressed - RTD light should be on if car is driveable
-            SerialManager_send(me->serialMan, "Inverter has been enabled.  Starting RTDS.  Car is ready to drive.\n");
-            RTDS_setVolume(rtds, .0025, 500000);
-            MCM_setStartupStage(me, 4); //MCM_getStartupStage(me) + 1);  //leave this stage since we've already kicked off the RTDS
+            MCM_commands_setInverter(me, DISABLED);
+            if (MCM_startupRetry(me, "MCM inverter not enabled - retrying the handshake.\n") == TRUE)
+            {
+                me->startupButtonHeld = TRUE;
+                MCM_setStartupStage(me, MCM_STARTUP_LOCKOUT);
+            }
         }
         break;
 
-    case 4: //inverter=disabled, rtds=already started
-        //Actions to perform upon entering this state ------------------------------------------------
-        SerialManager_send(me->serialMan, "RTD procedure complete.\n");  //Just send a message
-        RTDPercent = 1; //This line is redundant
-
-        //How to transition to next state ------------------------------------------------
-        //Always do, since we sent a message.
-        MCM_setStartupStage(me, MCM_getStartupStage(me) + 1);
+    case MCM_STARTUP_RTDS: //inverter=enabled, rtds=not started
+        RTDPercent = 1; //Doesn't matter if button is no longer pressed - RTD light should be on if car is driveable
+        RTDS_setVolume(rtds, .0025, 500000);
+        SerialManager_send(me->serialMan, "RTD procedure complete.\n");
+        MCM_setStartupStage(me, MCM_STARTUP_READY);
         break;
 
-    case 5: //inverter=enabled, rtds=notstarted
-        //What happens in this state ------------------------------------------------
-        RTDPercent = 1; //This line is redundant
-        //This case is here so we don't send a message anymore
-        
-        //How to transition to next state ------------------------------------------------
-        //Don't. //MCM_setStartupStage(me, MCM_getStartupStage(me) + 1);
+    case MCM_STARTUP_READY: //inverter=enabled, rtds=already started
+        RTDPercent = 1;
         break;
 
-
     default:
-        SerialManager_send(me->serialMan, "ERROR: Lost track of MCM startup status.\n");
+        SerialManager_log(me->serialMan, SERIAL_ERROR, "ERROR: Lost track of MCM startup status.\n");
         break;
     }
     
@@ -435,137 +665,67 @@ void MCM_inverterControl(MotorController* me, TorqueEncoder* tps, BrakePressureS
 }
 
 
+/*****************************************************************************
+* CAN signals
+******************************************************************************
+* Rinehart PM100 broadcast messages (all little-endian).  Only the fields we
+* use are listed; see the CAN protocol doc for the rest:
+*   0x0A0  module A/B/C temps, gate driver board temp
+*   0x0A1  control board temp, RTD 1-3 temps
+*   0x0A2  RTD 4-5 temps, motor temp, torque shudder
+*   0x0A3  analog inputs 1-4
+*   0x0A4  digital inputs 1-8
+*   0x0A5  motor angle, motor speed, electrical output freq, delta resolver
+*   0x0A6  phase A/B/C currents, DC bus current
+*   0x0A7  DC bus voltage, output voltage, phase AB/BC voltage
+*   0x0A8  flux command/feedback, id/iq feedback
+*   0x0A9  1.5V/2.5V/5V/12V reference voltages
+*   0x0AA  VSM state, inverter state, relay state, run mode/discharge state,
+*          command mode, internal states, direction command
+*   0x0AB  faults
+*   0x0AC  commanded torque, torque feedback
+****************************************************************************/
+#define MCM_FIELD(messageID, signal, field) { messageID, signal, offsetof(struct _MotorController, field), sizeof(((MotorController*)0)->field) }
+
+static const CanSignalField mcmSignals[] =
+{
+      MCM_FIELD(0x0A2, CANSIGNAL_LE_SCALED(32, 16, 1, 10), motor_temp)
+    , MCM_FIELD(0x0A5, CANSIGNAL_LE_SIGNED(16, 16), motorRPM)
+    , MCM_FIELD(0x0A6, CANSIGNAL_LE_SIGNED_SCALED(48, 16, 1, 10), DC_Current)  //Negative in regen
+    , MCM_FIELD(0x0A7, CANSIGNAL_LE_SCALED( 0, 16, 1, 10), DC_Voltage)
+    , MCM_FIELD(0x0AC, CANSIGNAL_LE_SCALED( 0, 16, 1, 10), commandedTorque)
+};
+
+//0x0AA byte 6: internal states
+static const CanSignal mcmSignal_inverterEnableState = CANSIGNAL_LE(48, 1);
+static const CanSignal mcmSignal_inverterEnableLockout = CANSIGNAL_LE(55, 1);
+
 void MCM_parseCanMessage(MotorController* me, IO_CAN_DATA_FRAME* mcmCanMessage)
 {
-    //0xAA
-    static const ubyte1 bitInverter = 1; //bit 1
-    static const ubyte1 bitLockout = 128; //bit 7
+    CanSignal_unpackFields(mcmSignals, sizeof(mcmSignals) / sizeof(mcmSignals[0]), mcmCanMessage, me);
 
     switch (mcmCanMessage->id)
     {
-    case 0x0A0:
-        //0,1 module A temperature
-        //2,3 module B temperature
-        //4,5 module C temperature
-        //6,7 gate driver board temperature
-        break;
-
-    case 0x0A1:
-        //0,1 control board temp
-        //2,3 rtd 1 temp
-        //4,5 rtd 2 temp
-        //6,7 rtd 3 temp
-        break;
-
-    case 0x0A2:
-        //0,1 rtd 4 temp
-        //2,3 rtd 5 temp
-        //4,5 motor temperature***
-        me->motor_temp = ((ubyte2)mcmCanMessage->data[5] << 8 | mcmCanMessage->data[4]) / 10;
-        //6,7 torque shudder
-        break;
-
-    case 0x0A3:
-        //0,1 voltage analog input #1
-        //2,3 voltage analog input #2
-        //4,5 voltage analog input #3
-        //6,7 voltage analog input #4
-        break;
-
-    case 0x0A4:
-        // booleans //
-        // 0 digital input #1
-        // 1 digital input #2
-        // 2 digital input #3
-        // 4 digital input #5
-        // 5 digital input #6
-        // 6 digital input #7
-        // 7 digital input #8
-        break;
-
-    case 0x0A5:
-        //0,1 motor angle (electrical)
-        //2,3 motor speed*** // in rpms
-        //Cast may be required - needs testing
-        me->motorRPM = (ubyte2)mcmCanMessage->data[3] << 8 | mcmCanMessage->data[2];
-        //me->motorRPM = ((mcmCanMessage->data[2] << 8) | (mcmCanMessage->data[3]));
-        //4,5 electrical output frequency
-        //6,7 delta resolver filtered
-        break;
-
-    case 0x0A6:
-        //0,1 Phase A current
-        //2,3 Phase B current
-        //4,5 Phase C current
-        //6,7 DC bus current
-        me->DC_Current = ((ubyte2)mcmCanMessage->data[7] << 8 | mcmCanMessage->data[6]) / 10;
-        //me->DC_Current = (((mcmCanMessage->data[6] << 8) | (mcmCanMessage->data[7])) / 10);
-        break;
-
-    case 0x0A7:
-        //0,1 DC bus voltage***
-        me->DC_Voltage = ((ubyte2)mcmCanMessage->data[1] << 8 | mcmCanMessage->data[0]) / 10;
-        //me->DC_Voltage = (((mcmCanMessage->data[0] << 8) | (mcmCanMessage->data[1])) / 10);
-        //2,3 output voltage
-        //4,5 Phase AB voltage
-        //6,7 Phase BC voltage
-        break;
-
-    case 0x0A8:
-        //0,1 Flux Command
-        //2,3 flux feedback
-        //4,5 id feedback
-        //6,7 iq feedback
-        break;
-
-    case 0x0A9:
-        // 0,1 1.5V reference voltage
-        // 2,3 2.5V reference voltage
-        // 4,5 5.0V reference voltage
-        // 6,7 12V reference voltage
-        break;
-
     case 0x0AA:
-        //0,1 VSM state
-        //2   Inverter state
-        //3   Relay State
-        //4   bit-0 inverter run mode
-        //4   bit5-7 inverter active discharge state
-        //5   inverter command mode
-
-        //6   internal states
-        //    bit0 inverter enable state***
-        me->inverterStatus = (mcmCanMessage->data[6] & bitInverter) > 0 ? ENABLED : DISABLED;
-        //    bit7 inverter enable lockout***
-        me->lockoutStatus = (mcmCanMessage->data[6] & bitLockout) > 0 ? ENABLED : DISABLED;
-
-        //7   direction command
+        me->inverterStatus = CanSignal_unpack(&mcmSignal_inverterEnableState, mcmCanMessage->data) > 0 ? ENABLED : DISABLED;
+        me->lockoutStatus = CanSignal_unpack(&mcmSignal_inverterEnableLockout, mcmCanMessage->data) > 0 ? ENABLED : DISABLED;
+        MCM_startupStatusReceived(me);
         break;
 
-
-    case 0x0AB: //Faults
-        //mcmCanMessage->data;
-        //me->faultHistory |= data stuff //????????
-
-        break;
-
-
-    case 0x0AC:
-        //0,1 Commanded Torque
-        me->commandedTorque = ((ubyte2)mcmCanMessage->data[1] << 8 | mcmCanMessage->data[0]) / 10;
-        //2,3 Torque Feedback
-        break;
-
-
-    case 0x5FF:
-        //0,1 Commanded Torque
+    case VCU_DEBUG_MESSAGE_ID:
+        //VCU debug control (see canManager.h): HVIL override request in byte 1, whatever the command
         if (mcmCanMessage->data[1] > 0)
         {
             IO_RTC_StartTime(&me->timeStamp_HVILOverrideCommandReceived);
+            me->HVILOverrideRequested = TRUE;
+        }
+        //Regen mode 4 settings in bytes 2-5, byte 6 bit 0 = save to EEPROM
+        if (mcmCanMessage->data[0] == VCU_DEBUG_CUSTOM_REGEN && mcmCanMessage->length >= 7)
+        {
+            MCM_setCustomRegen(me, mcmCanMessage->data[2], mcmCanMessage->data[3], mcmCanMessage->data[4], mcmCanMessage->data[5]);
+            if ((mcmCanMessage->data[6] & 0x01) != 0) { me->regen_customSaveRequested = TRUE; }
         }
-        //2,3 Torque Feedback
         break;
-
     }
 }
 
@@ -681,6 +841,13 @@ ubyte2 MCM_commands_getUpdateCount(MotorController* me)
 	return me->updateCount;
 }
 
+bool MCM_commands_takeSendRequest(MotorController* me)
+{
+    bool requested = me->commandSendRequested;
+    me->commandSendRequested = FALSE;
+    return requested;
+}
+
 void MCM_commands_resetUpdateCountAndTime(MotorController* me)
 {
 	me->updateCount = 0;
@@ -720,12 +887,15 @@ sbyte2 MCM_getMotorTemp(MotorController* me)
     return me->motor_temp;
 }
 
+sbyte2 MCM_getMotorRPM(MotorController* me)
+{
+    return me->motorRPM;
+}
+
+//Motor RPM / 3 (gear ratio) * 1.436 m (18" tire circumference) * 60 / 1000 = motor RPM * 0.02873
 sbyte2 MCM_getGroundSpeedKPH(MotorController* me)
 {
-    sbyte2 wheelRPM = me->motorRPM / 3;
-    float4 tireCircumference = 3.141592653589 * 18 * .0254; // (pi * diameter * in to m) = circumference in meters
-    sbyte2 groundKPH = wheelRPM / 60 * tireCircumference;
-    return groundKPH;
+    return (sbyte2)((sbyte4)me->motorRPM * 2873 / 100000);
 }
 
 ubyte1 MCM_getRegenMode(MotorController* me)
@@ -742,11 +912,11 @@ sbyte2 MCM_getRegenTorqueAtZeroPedalDNm(MotorController* me)
 }
 sbyte2 MCM_getRegenBPSForMaxRegenZeroToFF(MotorController* me)
 {
-	return 0xFF * me->regen_percentBPSForMaxRegen;
+	return FixedPoint_mul(0xFF, me->regen_percentBPSForMaxRegen);
 }
 sbyte2 MCM_getRegenAPPSForMaxCoastingZeroToFF(MotorController* me)
 {
-	return 0xFF * me->regen_percentAPPSForCoasting;
+	return FixedPoint_mul(0xFF, me->regen_percentAPPSForCoasting);
 }
 
 sbyte1 MCM_getRegenMinSpeed(MotorController* me)
@@ -759,11 +929,32 @@ sbyte1 MCM_getRegenRampdownStartSpeed(MotorController* me)
 }
 
 
+//Also keeps the per-stage times: a new startup (HV just came up) starts them from zero
 void MCM_setStartupStage(MotorController* me, ubyte1 stage)
 {
+    if (stage == me->startupStage) { return; }
+
+    if (me->startupStage == MCM_STARTUP_HV_OFF)
+    {
+        for (ubyte1 i = 0; i < MCM_STARTUP_STAGES; i++) { me->startupStageTime_ms[i] = 0; }
+        me->startupRetries = 0;
+        me->startupButtonHeld = FALSE;
+    }
+    MCM_startupStageTimeAdd(me);
+
 	me->startupStage = stage;
 }
 
+ubyte2 MCM_getStartupStageTimeMs(MotorController* me, ubyte1 stage)
+{
+    return (stage < MCM_STARTUP_STAGES) ? me->startupStageTime_ms[stage] : 0;
+}
+
+ubyte1 MCM_getStartupRetries(MotorController* me)
+{
+    return me->startupRetries;
+}
+
 ubyte1 MCM_getStartupStage(MotorController* me)
 {
 	return me->startupStage;
@@ -9,6 +9,8 @@
 #include "readyToDriveSound.h"
 //#include "safety.h"
 #include "serial.h"
+#include "eepromManager.h"
+#include "vehicleState.h"
 
 //typedef enum { TORQUE, DIRECTION, INVERTER, DISCHARGE, TORQUELIMIT} MCMCommand;
 typedef enum { ENABLED, DISABLED, UNKNOWN } Status;
@@ -20,6 +22,30 @@ typedef enum { CLOCKWISE, COUNTERCLOCKWISE, FORWARD, REVERSE, _0, _1 } Direction
 
 typedef struct _MotorController MotorController;
 
+/*****************************************************************************
+* Inverter startup (RMS CAN protocol: the inverter only accepts an enable
+* after it has seen a disable, which is what releases the lockout)
+******************************************************************************
+* Lockout and inverter transitions happen as soon as the 0xAA that reports
+* them is parsed, and each handshake step asks for an immediate 0xC0 (see
+* MCM_commands_takeSendRequest).  Waits on the inverter time out and retry;
+* after MCM_STARTUP_RETRIES the sequence stalls until HV is cycled.  An
+* enable that times out goes back through the lockout to WAIT_RTD, and needs
+* a new RTD press (brake on) like the first one.
+* Values match the old stage numbers (data logger, 0x520).
+****************************************************************************/
+typedef enum
+{
+      MCM_STARTUP_HV_OFF        //0: HVIL low, MCM relay off
+    , MCM_STARTUP_LOCKOUT       //1: relay on, disable commanded, waiting for the lockout to clear
+    , MCM_STARTUP_WAIT_RTD      //2: lockout clear, waiting for RTD (button, brake on, throttle off)
+    , MCM_STARTUP_ENABLING      //3: enable commanded, waiting for the inverter to report enabled
+    , MCM_STARTUP_RTDS          //4: inverter enabled, start the RTDS
+    , MCM_STARTUP_READY         //5: ready to drive
+    , MCM_STARTUP_STALLED       //6: out of retries (until HV cycles)
+    , MCM_STARTUP_STAGES
+} McmStartupStage;
+
 MotorController* MotorController_new(SerialManager* sm, ubyte2 canMessageBaseID, Direction initialDirection, sbyte2 torqueMaxInDNm, sbyte1 minRegenSpeedKPH, sbyte1 regenRampdownStartSpeed);
 
 //----------------------------------------------------------------------------
@@ -42,6 +68,8 @@ Status MCM_commands_getDischarge(MotorController* me);
 sbyte2 MCM_commands_getTorqueLimit(MotorController* me); 
 
 ubyte2 MCM_commands_getUpdateCount(MotorController* me);
+//TRUE (once) if the startup sequence wants the next 0xC0 sent right away, whether or not it's due
+bool MCM_commands_takeSendRequest(MotorController* me);
 void MCM_commands_resetUpdateCountAndTime(MotorController* me);
 ubyte4 MCM_commands_getTimeSinceLastCommandSent(MotorController* me);
 
@@ -58,7 +86,7 @@ void MCM_updateInverterStatus(MotorController* me, Status newState);
 Status MCM_getLockoutStatus(MotorController* me);
 Status MCM_getInverterStatus(MotorController* me);
 
-sbyte4 MCM_getPower(MotorController* me);
+sbyte4 MCM_getPower(MotorController* me);  //W, DC bus voltage x current (negative in regen)
 ubyte2 MCM_getCommandedTorque(MotorController* me);
 
 bool MCM_getHvilOverrideStatus(MotorController* me);
@@ -74,6 +102,7 @@ bool MCM_getRTDSFlag(MotorController* me);
 sbyte2 MCM_getTemp(MotorController* me);
 sbyte2 MCM_getMotorTemp(MotorController* me);
 
+sbyte2 MCM_getMotorRPM(MotorController* me);
 sbyte2 MCM_getGroundSpeedKPH(MotorController* me);
 sbyte1 MCM_getRegenMinSpeed(MotorController* me);
 sbyte1 MCM_getRegenRampdownStartSpeed(MotorController* me);
@@ -87,15 +116,28 @@ sbyte2 MCM_getRegenAPPSForMaxCoastingZeroToFF(MotorController* me);
 //----------------------------------------------------------------------------
 //Inter-object functions
 //----------------------------------------------------------------------------
+//Picks the regen mode from the dash knob (medium task).  A new position has to hold
+//for a few readings before the profile changes, so a knob sitting on a band edge doesn't flicker.
 void MCM_readTCSSettings(MotorController* me, Sensor* TCSSwitchUp, Sensor* TCSSwitchDown, Sensor* TCSPot);
-void MCM_calculateCommands(MotorController* mcm, TorqueEncoder* tps, BrakePressureSensor* bps);
+
+//Regen mode 4 ("user customizable"), each setting 0-255 = 0-100% (same scale as the 0x508 telemetry):
+//torque limit (of max torque), torque at zero pedal (of the regen limit), APPS for coasting, BPS for max regen.
+//Also settable on 0x5FF (CAN1): byte 0 = 0x4D (VCU_DEBUG_CUSTOM_REGEN), bytes 2-5 = settings, byte 6 bit 0 = save to EEPROM
+void MCM_setCustomRegen(MotorController* me, ubyte1 torqueLimit, ubyte1 torqueAtZeroPedal, ubyte1 appsForCoasting, ubyte1 bpsForMaxRegen);
+bool MCM_loadCustomRegenFromEEPROM(MotorController* me, EEPROMManager* eeprom);
+void MCM_saveCustomRegenToEEPROM(MotorController* me, EEPROMManager* eeprom);  //Only queues the write, and only if the settings changed
+bool MCM_customRegenSaveRequested(MotorController* me);  //Set by the 0x5FF command, cleared by the save
+void MCM_calculateCommands(MotorController* mcm, const VehicleState* state);  //Pedal percents from the snapshot being built
 
 void MCM_relayControl(MotorController* mcm, Sensor* HVILTermSense);
 void MCM_inverterControl(MotorController* mcm, TorqueEncoder* tps, BrakePressureSensor* bps, ReadyToDriveSound* rtds);
 
 void MCM_parseCanMessage(MotorController* mcm, IO_CAN_DATA_FRAME* mcmCanMessage);
 
-ubyte1 MCM_getStartupStage(MotorController* me);
+ubyte1 MCM_getStartupStage(MotorController* me);  //McmStartupStage
 void MCM_setStartupStage(MotorController* me, ubyte1 stage);
+//Time spent in a stage since HV last came up (ms, finished visits only, saturates), and retries so far
+ubyte2 MCM_getStartupStageTimeMs(MotorController* me, ubyte1 stage);
+ubyte1 MCM_getStartupRetries(MotorController* me);
 
 #endif // _MOTORCONTROLLER_H
@@ -0,0 +1,154 @@
+#include <stddef.h> //NULL
+
+#include "IO_Driver.h"
+
+#include "powerLimiter.h"
+#include "arena.h"
+#include "fixedPoint.h"
+#include "motorController.h"
+#include "bms.h"
+
+//Rules limit is 80 kW at the energy meter.  The target leaves 1 kW for meter/sensor differences;
+//the PI loop takes care of the rest, so this doesn't need a bigger margin.
+#define POWERLIMIT_TARGET_W       79000
+
+//PI gains on the power error (W), per fast tick.  Starting points - tune on the dyno.
+#define POWERLIMIT_KP             Q15(.25)
+#define POWERLIMIT_KI             Q15(.02)
+
+//Errors are clamped to this before the gains so FixedPoint_mul can't overflow (< 2^17)
+#define POWERLIMIT_MAX_ERROR_W    100000
+
+//T [dNm] = P [W] * 60 / (2 pi rpm) * 10 = P * 95.5 / rpm.  Below POWERLIMIT_MIN_RPM the
+//ceiling is far above max torque anyway, so the RPM is floored there to keep the divide sane.
+#define POWERLIMIT_DNM_RPM_PER_10W 955
+#define POWERLIMIT_MIN_RPM        200
+
+//No ceiling (above any torque command)
+#define POWERLIMIT_UNLIMITED      0x7FFF
+
+struct _PowerLimiter
+{
+    sbyte4 integral;            //W, -target..0
+    sbyte4 trim;                //W, P + I, -target..0
+    PowerLimitSource activeLimit;
+    ubyte2 torqueCeiling;       //dNm
+};
+
+PowerLimiter* PowerLimiter_new(void)
+{
+    PowerLimiter* me = (PowerLimiter*)Arena_allocate(ARENA_INTERNAL, sizeof(struct _PowerLimiter));
+
+    me->integral = 0;
+    me->trim = 0;
+    me->activeLimit = POWERLIMIT_NONE;
+    me->torqueCeiling = POWERLIMIT_UNLIMITED;
+    return me;
+}
+
+//Power -> torque at the current motor speed, saturated at POWERLIMIT_UNLIMITED
+static ubyte2 PowerLimiter_torqueForPower(ubyte4 powerW, ubyte2 rpm)
+{
+    if (powerW > POWERLIMIT_TARGET_W) { powerW = POWERLIMIT_TARGET_W; }  //Keeps powerW * 955 in range
+
+    ubyte4 torque = powerW * POWERLIMIT_DNM_RPM_PER_10W / ((ubyte4)rpm * 10);
+    return (torque > POWERLIMIT_UNLIMITED) ? POWERLIMIT_UNLIMITED : (ubyte2)torque;
+}
+
+//Pack voltage is 100 mV, current limits are A
+static ubyte4 PowerLimiter_bmsPower(ubyte2 currentLimitA, ubyte2 packVoltage)
+{
+    return (ubyte4)currentLimitA * packVoltage / 10;
+}
+
+sbyte2 PowerLimiter_limitTorque(PowerLimiter* me, MotorController* mcm, BatteryManagementSystem* bms, sbyte2 torqueDNm)
+{
+    sbyte2 motorRPM = MCM_getMotorRPM(mcm);
+    ubyte2 rpm = (motorRPM < 0) ? (ubyte2)(0 - motorRPM) : (ubyte2)motorRPM;
+    if (rpm < POWERLIMIT_MIN_RPM) { rpm = POWERLIMIT_MIN_RPM; }
+
+    ubyte2 packVoltage = BMS_getPackVoltage(bms);  //0 until the BMS reports
+
+    //----------------------------------------------------------------------------
+    // Drive power target, and the PI trim on the measured power.  Runs in regen
+    // too, so the integrator unwinds while we're not pulling power.
+    //----------------------------------------------------------------------------
+    sbyte4 target = POWERLIMIT_TARGET_W;
+    PowerLimitSource driveLimit = POWERLIMIT_POWER;
+    if (packVoltage > 0)
+    {
+        ubyte4 dclPower = PowerLimiter_bmsPower(BMS_getDCL(bms), packVoltage);
+        if (dclPower < (ubyte4)target)
+        {
+            target = (sbyte4)dclPower;
+            driveLimit = POWERLIMIT_DCL;
+        }
+    }
+
+    sbyte4 measured = BMS_getPower(bms);
+    sbyte4 mcmPower = MCM_getPower(mcm);  //Negative in regen - that isn't drive power
+    if (mcmPower < 0) { mcmPower = 0; }
+    if (mcmPower > measured) { measured = mcmPower; }
+
+    sbyte4 error = FixedPoint_clamp(target - measured, 0 - POWERLIMIT_MAX_ERROR_W, POWERLIMIT_MAX_ERROR_W);
+    me->integral = FixedPoint_clamp(me->integral + FixedPoint_mul(error, POWERLIMIT_KI), 0 - target, 0);
+    me->trim = FixedPoint_clamp(FixedPoint_mul(error, POWERLIMIT_KP) + me->integral, 0 - target, 0);
+
+    //----------------------------------------------------------------------------
+    // Ceiling for the direction of the request
+    //----------------------------------------------------------------------------
+    ubyte2 ceiling;
+    PowerLimitSource limit;
+    ubyte2 request;
+
+    if (torqueDNm >= 0)
+    {
+        request = (ubyte2)torqueDNm;
+        ceiling = PowerLimiter_torqueForPower((ubyte4)(target + me->trim), rpm);
+        limit = driveLimit;
+    }
+    else
+    {
+        request = (ubyte2)(0 - torqueDNm);
+        ceiling = POWERLIMIT_UNLIMITED;
+        limit = POWERLIMIT_NONE;
+        if (packVoltage > 0)
+        {
+            ceiling = PowerLimiter_torqueForPower(PowerLimiter_bmsPower(BMS_getCCL(bms), packVoltage), rpm);
+            limit = POWERLIMIT_CCL;
+        }
+
+        Q15 rampdown = FixedPoint_percentOf(MCM_getGroundSpeedKPH(mcm), MCM_getRegenMinSpeed(mcm), MCM_getRegenRampdownStartSpeed(mcm));
+        ubyte2 rampCeiling = (ubyte2)FixedPoint_mul(request, rampdown);
+        if (rampCeiling < ceiling)
+        {
+            ceiling = rampCeiling;
+            limit = POWERLIMIT_REGEN_SPEED;
+        }
+    }
+
+    me->torqueCeiling = ceiling;
+    if (request <= ceiling)
+    {
+        me->activeLimit = POWERLIMIT_NONE;
+        return torqueDNm;
+    }
+
+    me->activeLimit = limit;
+    return (torqueDNm >= 0) ? (sbyte2)ceiling : 0 - (sbyte2)ceiling;
+}
+
+PowerLimitSource PowerLimiter_getActiveLimit(PowerLimiter* me)
+{
+    return me->activeLimit;
+}
+
+ubyte2 PowerLimiter_getTorqueCeilingDNm(PowerLimiter* me)
+{
+    return me->torqueCeiling;
+}
+
+sbyte4 PowerLimiter_getTrimW(PowerLimiter* me)
+{
+    return me->trim;
+}
@@ -0,0 +1,51 @@
+#ifndef _POWERLIMITER_H
+#define _POWERLIMITER_H
+
+#include "IO_Driver.h"
+
+#include "motorController.h"
+#include "bms.h"
+
+/*****************************************************************************
+* Power limiter
+******************************************************************************
+* Puts a ceiling on the torque command every fast tick, so we can drive right
+* at the 80 kW limit (EV2.2) and the BMS current limits instead of staying
+* well below them.
+*
+* Drive: the power target is POWERLIMIT_TARGET_W, or DCL x pack voltage if
+* that is lower.  The target is turned into a torque ceiling by motor speed
+* (feed forward, T = P / w).  A PI loop on the measured power - the higher of
+* BMS and MCM - trims the target for losses and sensor differences.  The
+* integrator is clamped between -target and 0 (anti-windup), so it can only
+* pull the limit down and unwinds as soon as we're under it.
+*
+* Regen: CCL x pack voltage as a torque ceiling (feed forward only), and the
+* MCM's low speed ramp (no regen below the minimum speed, full regen from the
+* ramp start speed).
+*
+* BMS ceilings are skipped until the BMS has reported a pack voltage; a
+* missing BMS is the stale message rule's job (SafetyChecker).
+****************************************************************************/
+typedef enum
+{
+      POWERLIMIT_NONE           //Request was below every ceiling
+    , POWERLIMIT_POWER          //80 kW
+    , POWERLIMIT_DCL            //BMS discharge current limit
+    , POWERLIMIT_CCL            //BMS charge current limit (regen)
+    , POWERLIMIT_REGEN_SPEED    //Low speed regen ramp
+} PowerLimitSource;
+
+typedef struct _PowerLimiter PowerLimiter;
+
+PowerLimiter* PowerLimiter_new(void);
+
+//Returns torqueDNm, limited to the lowest ceiling for its direction.  Call every fast tick.
+sbyte2 PowerLimiter_limitTorque(PowerLimiter* me, MotorController* mcm, BatteryManagementSystem* bms, sbyte2 torqueDNm);
+
+//Last limitTorque result, for telemetry
+PowerLimitSource PowerLimiter_getActiveLimit(PowerLimiter* me);
+ubyte2 PowerLimiter_getTorqueCeilingDNm(PowerLimiter* me);   //For the direction of the last request
+sbyte4 PowerLimiter_getTrimW(PowerLimiter* me);              //PI output, <= 0
+
+#endif // _POWERLIMITER_H
@@ -1,9 +1,11 @@
-#include <stdlib.h>  //Needed for malloc
+#include <stddef.h>  //NULL
 
 #include "IO_Driver.h"  //Includes datatypes, constants, etc - should be included in every c file
 #include "IO_PWM.h"
+#include "IO_RTC.h"
 
 #include "readyToDriveSound.h"
+#include "arena.h"
 
 
 struct _ReadyToDriveSound
@@ -15,19 +17,11 @@ struct _ReadyToDriveSound
 
 ReadyToDriveSound* RTDS_new(void)
 {
-    ReadyToDriveSound* rtds = (ReadyToDriveSound*)malloc(sizeof(struct _ReadyToDriveSound));
+    ReadyToDriveSound* rtds = (ReadyToDriveSound*)Arena_allocate(ARENA_EXTERNAL, sizeof(struct _ReadyToDriveSound));
     RTDS_setVolume(rtds, 0, 0);
     return rtds;
 }
 
-void RTDS_delete(ReadyToDriveSound* rtds)
-{
-    // some implementations pass a Person** to set the reference to 0
-    // this implementation requires that the caller sets his own references to 0
-    //free(person->name);
-    free(rtds);
-}
-
 void RTDS_setVolume(ReadyToDriveSound* rtds, float4 volumePercent, ubyte4 timeToPlay)
 {
     IO_PWM_SetDuty(IO_PWM_07, 65535 * volumePercent, NULL);  //Pin 103
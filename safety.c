@@ -1,4 +1,4 @@
-#include <stdlib.h> //malloc
+#include <stddef.h> //NULL
 //#include <math.h>
 #include "IO_Driver.h"
 #include "IO_RTC.h"
@@ -6,7 +6,9 @@
 #include "IO_CAN.h"
 
 #include "safety.h"
+#include "arena.h"
 #include "mathFunctions.h"
+#include "fixedPoint.h"
 
 #include "sensors.h"
 
@@ -15,60 +17,114 @@
 
 #include "motorController.h"
 #include "bms.h"
+#include "powerLimiter.h"
 #include "serial.h"
+#include "canManager.h"
 
 //----------------------------------------------------------------------------
 //Faults
 //last flag is 0x 8000 0000 (32 flags, 8 hex characters)
+//(#defines rather than consts so the rule table can use them)
 //----------------------------------------------------------------------------
 //nibble 1
-static const ubyte4 F_tpsOutOfRange = 1;
-static const ubyte4 F_bpsOutOfRange = 2;
-static const ubyte4 F_tpsPowerFailure = 4;
-static const ubyte4 F_bpsPowerFailure = 8;
+#define F_tpsOutOfRange 1
+#define F_bpsOutOfRange 2
+#define F_tpsPowerFailure 4
+#define F_bpsPowerFailure 8
 //nibble 2
-static const ubyte4 F_tpsSignalFailure = 0x10;
-static const ubyte4 F_bpsSignalFailure = 0x20;
-static const ubyte4 F_tpsNotCalibrated = 0x40;
-static const ubyte4 F_bpsNotCalibrated = 0x80;
+#define F_tpsSignalFailure 0x10
+#define F_bpsSignalFailure 0x20
+#define F_tpsNotCalibrated 0x40
+#define F_bpsNotCalibrated 0x80
 
 //nibble 3
-static const ubyte4 F_tpsOutOfSync = 0x100;
-static const ubyte4 F_bpsOutOfSync = 0x200; //NOT USED
-static const ubyte4 F_tpsbpsImplausible = 0x400;
-//static const ubyte4 UNUSED = 0x800;
+#define F_tpsOutOfSync 0x100
+#define F_bpsOutOfSync 0x200 //NOT USED
+#define F_tpsbpsImplausible 0x400
+//#define UNUSED 0x800
 
 //nibble 4
-//static const ubyte4 F_ = 0x1000;
-//static const ubyte4 F_ = 0x2000;
-//static const ubyte4 F_ = 0x4000;
-//static const ubyte4 F_ = 0x8000;
+//#define F_ 0x1000
+//#define F_ 0x2000
+//#define F_ 0x4000
+//#define F_ 0x8000
 
 //nibble 5
-static const ubyte4 F_lvsBatteryVeryLow = 0x10000;
-//static const ubyte4 F_ = 0x20000;
-//static const ubyte4 F_ = 0x40000;
-//static const ubyte4 F_ = 0x80000;
+#define F_lvsBatteryVeryLow 0x10000
+//#define F_ 0x20000
+//#define F_ 0x40000
+//#define F_ 0x80000
 
 //nibble 6
 //nibble 7
 //nibble 8
 //                             nibble: 87654321
-static const ubyte4 F_unusedFaults = 0xFFFEF800;
+#define F_unusedFaults 0xFFFEF800
 
 
 //Warnings -------------------------------------------
-static const ubyte2 W_lvsBatteryLow = 1;
-static const ubyte2 W_hvilOverrideEnabled = 0x40;  //This flag indicates HVIL bypass (MCM turn on)
-static const ubyte2 W_safetyBypassEnabled = 0x80;  //This flag controls the safety bypass
+#define W_lvsBatteryLow 1
+#define W_bmsMessageStale 2
+#define W_hvilOverrideEnabled 0x40  //This flag indicates HVIL bypass (MCM turn on)
+#define W_safetyBypassEnabled 0x80  //This flag controls the safety bypass
 
 //Notices
-static const ubyte2 N_HVILTermSenseLost = 1;
+#define N_HVILTermSenseLost 1
 
-static const ubyte2 N_Over75kW_BMS = 0x10;
-static const ubyte2 N_Over75kW_MCM = 0x20;
+#define N_Over75kW_BMS 0x10
+#define N_Over75kW_MCM 0x20
 
 
+/*****************************************************************************
+* Safety rules
+******************************************************************************
+* Every check is a row in safetyRules[]: a condition function, the flag it
+* drives, and how long the condition has to hold before the flag sets
+* (debounce) or stay gone before it clears (persistence).  Times of 0 mean
+* immediately.
+*
+* A condition returns TRUE while the problem exists.  It is given the flag's
+* current state so latching checks (e.g. EV2.5.1 - implausibility stays
+* until the pedal is released) can use different set/clear thresholds.
+*
+* Rules only touch their own flag, and only when it changes state.
+*
+* Scheduling:
+*  SAFETY_FAST     - SafetyChecker_updateFast (every tick).  Pedal checks that
+*                    the rules say must cut torque immediately.
+*  SAFETY_SLOW     - SafetyChecker_update (medium task), every time.
+*  SAFETY_INPUT_*  - SafetyChecker_update, but only when one of those inputs
+*                    changed since the last evaluation (or a debounce is
+*                    still running).  For things that almost never change.
+****************************************************************************/
+typedef enum { SAFETY_FAULT, SAFETY_WARNING, SAFETY_NOTICE } SafetyLevel;
+
+#define SAFETY_FAST                 0x01
+#define SAFETY_SLOW                 0x02
+#define SAFETY_INPUT_CALIBRATION    0x04  //VEHICLESTATE_TPS/BPS_CALIBRATED
+#define SAFETY_INPUT_POWER          0x08  //VEHICLESTATE_TPS/BPS_POWER_ERROR
+
+struct _SafetyChecker;
+typedef bool (*SafetyCondition)(struct _SafetyChecker* me, bool active);
+
+typedef struct _SafetyRule
+{
+    SafetyCondition condition;
+    ubyte1 schedule;         //SAFETY_FAST, SAFETY_SLOW, or SAFETY_INPUT_* bits
+    SafetyLevel level;
+    ubyte4 flag;             //0 = log only
+    ubyte2 setDelay_ms;      //Condition must hold this long before the flag sets
+    ubyte2 clearDelay_ms;    //...and be gone this long before it clears
+    const ubyte1* message;   //Logged when the flag sets (NULL = nothing)
+} SafetyRule;
+
+typedef struct _SafetyRuleState
+{
+    bool condition;             //Result of the last evaluation
+    bool active;                //Flag state
+    ubyte4 timestamp_changed;   //When condition last changed (SafetyChecker timebase)
+} SafetyRuleState;
+
 /*****************************************************************************
 * SafetyChecker object
 ******************************************************************************
@@ -87,11 +143,152 @@ struct _SafetyChecker {
 
     bool tpsbpsImplausible;
 
-    bool bypass;
+    bool bypass;                //Bypass command received and not timed out yet
 	ubyte4 timestamp_bypassSafetyChecks;
 	ubyte4 bypassSafetyChecksTimeout_us;
+
+    //Inputs for the rule conditions (from the latest update call)
+    MotorController* mcm;
+    BatteryManagementSystem* bms;
+    const VehicleState* state;
+
+    //Dirty tracking for SAFETY_INPUT_* rules
+    ubyte1 dirtyInputs;
+    ubyte1 lastCalibration;     //pedalStatus calibrated bits
+    ubyte1 lastPowerErrors;     //pedalStatus supply error bits
+
+    ubyte4 timebase;
+    SafetyRuleState* ruleStates;
+
+    PowerLimiter* powerLimiter;  //80 kW, BMS DCL/CCL and low speed regen ceilings (reduceTorque)
+};
+
+/*-------------------------------------------------------------------
+* Rule conditions
+-------------------------------------------------------------------*/
+static bool SafetyRule_pedalStatus(SafetyChecker* me, ubyte1 bits) { return (me->state->pedalStatus & bits) != 0; }
+
+static bool SafetyRule_tpsNotCalibrated(SafetyChecker* me, bool active) { return !SafetyRule_pedalStatus(me, VEHICLESTATE_TPS_CALIBRATED); }
+static bool SafetyRule_bpsNotCalibrated(SafetyChecker* me, bool active) { return !SafetyRule_pedalStatus(me, VEHICLESTATE_BPS_CALIBRATED); }
+
+//Check if VCU was able to get a TPS/BPS reading
+static bool SafetyRule_tpsPowerFailure(SafetyChecker* me, bool active) { return SafetyRule_pedalStatus(me, VEHICLESTATE_TPS_POWER_ERROR); }
+static bool SafetyRule_bpsPowerFailure(SafetyChecker* me, bool active) { return SafetyRule_pedalStatus(me, VEHICLESTATE_BPS_POWER_ERROR); }
+static bool SafetyRule_tpsSignalFailure(SafetyChecker* me, bool active) { return SafetyRule_pedalStatus(me, VEHICLESTATE_TPS_SIGNAL_ERROR); }
+static bool SafetyRule_bpsSignalFailure(SafetyChecker* me, bool active) { return SafetyRule_pedalStatus(me, VEHICLESTATE_BPS_SIGNAL_ERROR); }
+
+//RULE: EV2.3.10 - signal outside of operating range is considered a failure
+//  This refers to SPEC SHEET values, not calibration values
+//Note: IC cars may continue to drive for up to 100ms until valid readings are restored, but EVs must immediately cut power
+static bool SafetyRule_tpsOutOfRange(SafetyChecker* me, bool active) { return SafetyRule_pedalStatus(me, VEHICLESTATE_TPS_OUT_OF_SPEC); }
+static bool SafetyRule_bpsOutOfRange(SafetyChecker* me, bool active) { return SafetyRule_pedalStatus(me, VEHICLESTATE_BPS_OUT_OF_SPEC); }
+
+// EV2.3.5 If an implausibility occurs between the values of these two sensors
+//  the power to the motor(s) must be immediately shut down completely. It is not necessary 
+//  to completely deactivate the tractive system, the motor controller(s) shutting down the 
+//  power to the motor(s) is sufficient.
+// EV2.3.6 Implausibility is defined as a deviation of more than 10 % pedal travel between the sensors.
+static bool SafetyRule_tpsOutOfSync(SafetyChecker* me, bool active)
+{
+	//Pedal percents (0 to FIXEDPOINT_ONE)
+	sbyte4 tpsDifference = (sbyte4)me->state->tps1Percent - (sbyte4)me->state->tps0Percent;
+	return (tpsDifference > (sbyte4)Q15(.1) || tpsDifference < -(sbyte4)Q15(.1));  //Note: Individual TPS readings don't go negative, otherwise this wouldn't work
+}
+
+// EV2.5 Torque Encoder / Brake Pedal Plausibility Check
+//  The power to the motors must be immediately shut down completely, if the mechanical brakes 
+//  are actuated and the torque encoder signals more than 25 % pedal travel at the same time.
+//  This must be demonstrated when the motor controllers are under load.
+// EV2.5.1 The motor power shut down must remain active until the torque encoder signals less than 5 % pedal travel,
+//  no matter whether the brakes are still actuated or not.
+static bool SafetyRule_tpsbpsImplausible(SafetyChecker* me, bool active)
+{
+    if (active == TRUE)
+    {
+        return (me->state->throttlePercent >= Q15(.10));  //Stays until TPS is reduced (we use 10%, not 5%)
+    }
+    return (me->state->brakePercent > Q15(.05) && me->state->throttlePercent > Q15(.25));
+}
+
+//  IO_ADC_UBAT: 0..40106  (0V..40.106V)
+static bool SafetyRule_lvsBatteryVeryLow(SafetyChecker* me, bool active)
+{
+    return (me->state->lvBatteryMV <= 9200);  //12730 = 10% SOC but hard to tell under load. 9200 = empty
+}
+
+static bool SafetyRule_lvsBatteryLow(SafetyChecker* me, bool active)
+{
+    return (me->state->lvBatteryMV <= 12730);  //13100 = Recharge percentage, per Shorai
+}
+
+// The safety checker should only be bypassed by a CAN message sent by
+// the PCAN Explorer dashboard.  This is only used during debugging.
+// In case CAN communication is lost, the bypass is disabled after some time.
+static bool SafetyRule_safetyBypassEnabled(SafetyChecker* me, bool active)
+{
+    me->bypass = (me->bypass == TRUE && IO_RTC_GetTimeUS(me->timestamp_bypassSafetyChecks) < me->bypassSafetyChecksTimeout_us);
+    return me->bypass;
+}
+
+static bool SafetyRule_hvilOverrideEnabled(SafetyChecker* me, bool active)
+{
+    return MCM_getHvilOverrideStatus(me->mcm);
+}
+
+// If HVIL term sense goes low (because HV went down), motor torque
+// command should be set to zero before turning off the controller
+static bool SafetyRule_HVILTermSenseLost(SafetyChecker* me, bool active)
+{
+    return (me->state->hvilTermSense == FALSE);
+}
+
+//A BMS message hasn't arrived within its timeout (see BMS_setMessageTimeout)
+static bool SafetyRule_bmsMessageStale(SafetyChecker* me, bool active) { return BMS_isStale(me->bms); }
+
+static bool SafetyRule_over75kW_BMS(SafetyChecker* me, bool active) { return (me->state->bmsPowerW > 75000); }
+static bool SafetyRule_over75kW_MCM(SafetyChecker* me, bool active) { return (me->state->mcmPowerW > 75000); }
+
+/*-------------------------------------------------------------------
+* Rule table
+-------------------------------------------------------------------*/
+static const SafetyRule safetyRules[] =
+{
+    //  condition                         schedule                  level           flag                     set  clear  message
+    //Pedals - every tick (EV2.3.5, EV2.3.10, EV2.5: cut power immediately)
+      { SafetyRule_tpsOutOfRange,         SAFETY_FAST,              SAFETY_FAULT,   F_tpsOutOfRange,         0,   0,     "TPS out of range\n" }
+    , { SafetyRule_bpsOutOfRange,         SAFETY_FAST,              SAFETY_FAULT,   F_bpsOutOfRange,         0,   0,     "BPS out of range\n" }
+    , { SafetyRule_tpsOutOfSync,          SAFETY_FAST,              SAFETY_FAULT,   F_tpsOutOfSync,          0,   0,     "TPS discrepancy of over 10%\n" }
+    , { SafetyRule_tpsbpsImplausible,     SAFETY_FAST,              SAFETY_FAULT,   F_tpsbpsImplausible,     0,   0,     "TPS BPS implausiblity detected.\n" }
+
+    //Sensor readings
+    , { SafetyRule_tpsSignalFailure,      SAFETY_SLOW,              SAFETY_WARNING, 0,                       0,   0,     "TPS signal error\n" }  //Not a fault yet (F_tpsSignalFailure)
+    , { SafetyRule_bpsSignalFailure,      SAFETY_SLOW,              SAFETY_FAULT,   F_bpsSignalFailure,      0,   0,     "BPS signal error\n" }
+
+    //Only change when their inputs do
+    , { SafetyRule_tpsNotCalibrated,      SAFETY_INPUT_CALIBRATION, SAFETY_FAULT,   F_tpsNotCalibrated,      0,   0,     NULL }
+    , { SafetyRule_bpsNotCalibrated,      SAFETY_INPUT_CALIBRATION, SAFETY_FAULT,   F_bpsNotCalibrated,      0,   0,     NULL }
+    , { SafetyRule_tpsPowerFailure,       SAFETY_INPUT_POWER,       SAFETY_FAULT,   F_tpsPowerFailure,       0,   0,     "TPS power failure\n" }
+    , { SafetyRule_bpsPowerFailure,       SAFETY_INPUT_POWER,       SAFETY_FAULT,   F_bpsPowerFailure,       0,   0,     "BPS power failure\n" }
+
+    //LV battery - sags under load, so it has to stay low for a second
+    , { SafetyRule_lvsBatteryVeryLow,     SAFETY_SLOW,              SAFETY_FAULT,   F_lvsBatteryVeryLow,     1000, 1000, "LVS battery EXTREMELY LOW!\n" }
+    , { SafetyRule_lvsBatteryLow,         SAFETY_SLOW,              SAFETY_WARNING, W_lvsBatteryLow,         1000, 1000, "LVS battery LOW.\n" }
+
+    //BMS communication (the timeouts already allow for the message rates)
+    , { SafetyRule_bmsMessageStale,       SAFETY_SLOW,              SAFETY_WARNING, W_bmsMessageStale,       0,   0,     "BMS message timeout\n" }
+
+    //Debug overrides
+    , { SafetyRule_safetyBypassEnabled,   SAFETY_SLOW,              SAFETY_WARNING, W_safetyBypassEnabled,   0,   0,     "Safety bypass enabled\n" }
+    , { SafetyRule_hvilOverrideEnabled,   SAFETY_SLOW,              SAFETY_WARNING, W_hvilOverrideEnabled,   0,   0,     "HVIL override enabled\n" }
+
+    //Notices
+    , { SafetyRule_HVILTermSenseLost,     SAFETY_SLOW,              SAFETY_NOTICE,  N_HVILTermSenseLost,     0,   0,     NULL }
+    , { SafetyRule_over75kW_BMS,          SAFETY_SLOW,              SAFETY_NOTICE,  N_Over75kW_BMS,          0,   100,   NULL }
+    , { SafetyRule_over75kW_MCM,          SAFETY_SLOW,              SAFETY_NOTICE,  N_Over75kW_MCM,          0,   100,   NULL }
 };
 
+#define SAFETY_RULE_COUNT (sizeof(safetyRules) / sizeof(safetyRules[0]))
+
 /*****************************************************************************
 * Torque Encoder (TPS) functions
 * RULE EV2.3.5:
@@ -100,21 +297,38 @@ struct _SafetyChecker {
 ****************************************************************************/
 SafetyChecker* SafetyChecker_new(SerialManager* sm, ubyte2 maxChargeAmps, ubyte2 maxDischargeAmps)
 {
-    SafetyChecker* me = (SafetyChecker*)malloc(sizeof(struct _SafetyChecker));
+    SafetyChecker* me = (SafetyChecker*)Arena_allocate(ARENA_INTERNAL, sizeof(struct _SafetyChecker));
 
     me->serialMan = sm;
     me->faults = 0;
     me->warnings = 0;
+    me->notices = 0;
 
     me->tpsbpsImplausible = TRUE;
 
     me->maxAmpsCharge = maxChargeAmps;
     me->maxAmpsDischarge = maxDischargeAmps;
 
-    me->bypass = FALSE;
+    me->bypass = FALSE;  //Starts expired - timestamp_bypassSafetyChecks means nothing until the first bypass command
 	me->timestamp_bypassSafetyChecks = 0;
 	me->bypassSafetyChecksTimeout_us = 500000; //If safety bypass command is not neceived in this time then safety is re-enabled
 	//Note: The safety bypass warning flag is the determining factor in bypassing the multiplier.
+
+    //Every rule runs on the first update
+    me->dirtyInputs = 0xFF;
+    me->lastCalibration = 0;
+    me->lastPowerErrors = 0;
+
+    IO_RTC_StartTime(&me->timebase);
+    me->ruleStates = (SafetyRuleState*)Arena_allocate(ARENA_INTERNAL, sizeof(SafetyRuleState) * SAFETY_RULE_COUNT);
+    for (ubyte1 i = 0; i < SAFETY_RULE_COUNT; i++)
+    {
+        me->ruleStates[i].condition = FALSE;
+        me->ruleStates[i].active = FALSE;
+        me->ruleStates[i].timestamp_changed = 0;
+    }
+
+    me->powerLimiter = PowerLimiter_new();
     return me;
 }
 
@@ -122,316 +336,96 @@ void SafetyChecker_parseCanMessage(SafetyChecker* me, IO_CAN_DATA_FRAME* canMess
 {
 	switch (canMessage->id)
 	{
-	case 0x5FF:
-		//If the safety bypass code (0xC4) is received on the VCU debug address (0x5FF) at byte 0 (data[0])
-        if (canMessage->data[0] == 0xC4)
+	case VCU_DEBUG_MESSAGE_ID:
+		//If the safety bypass code is received on the VCU debug address at byte 0 (data[0])
+        if (canMessage->data[0] == VCU_DEBUG_SAFETY_BYPASS)
         {
             IO_RTC_StartTime(&me->timestamp_bypassSafetyChecks);
+            me->bypass = TRUE;
         }
 		break;
 	}
 }
 
-//Updates all values based on sensor readings, safety checks, etc
-void SafetyChecker_update(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, TorqueEncoder* tps, BrakePressureSensor* bps, Sensor* HVILTermSense, Sensor* LVBattery)
+/*-------------------------------------------------------------------
+* Rule evaluation
+-------------------------------------------------------------------*/
+static void SafetyChecker_setFlag(SafetyChecker* me, const SafetyRule* rule, bool active)
 {
-    ubyte1* message[50];  //For sprintf'ing variables to print in serial
-    //SerialManager_send(me->serialMan, "Entered SafetyChecker_update().\n");
-    /*****************************************************************************
-    * Faults
-    ****************************************************************************/
-	//===================================================================
-	// Get calibration status
-	//===================================================================
-    //me->faults = 0xFFFF; //Set ALL faults by default.  only clear if truly safe
-    me->faults &= ~F_unusedFaults;
-
-    //me->faults = 1;
-    if (tps->calibrated == FALSE) { me->faults |= F_tpsNotCalibrated; }
-    else { me->faults &= ~F_tpsNotCalibrated; }
-
-    if (bps->calibrated == FALSE) { me->faults |= F_bpsNotCalibrated; }
-    else { me->faults &= ~F_bpsNotCalibrated; }
-
-	//===================================================================
-	// Check if VCU was able to get a TPS/BPS reading
-	//===================================================================
-	if (tps->tps0->ioErr_powerInit != IO_E_OK
-		|| tps->tps1->ioErr_powerInit != IO_E_OK
-		|| tps->tps0->ioErr_powerSet != IO_E_OK
-		|| tps->tps1->ioErr_powerSet != IO_E_OK)
-    {
-        me->faults |= F_tpsPowerFailure;
-    }
-    else
+    //Branch on the level once - the flag words are different sizes
+    ubyte4 set = active ? rule->flag : 0;
+    switch (rule->level)
     {
-        me->faults &= ~F_tpsPowerFailure;
-    }
-
-	if (   tps->tps0->ioErr_signalInit != IO_E_OK
-		|| tps->tps1->ioErr_signalInit != IO_E_OK
-		|| tps->tps0->ioErr_signalGet != IO_E_OK
-		|| tps->tps1->ioErr_signalGet != IO_E_OK)
-	{
-		//me->faults |= F_tpsSignalFailure;
-        SerialManager_send(me->serialMan, "TPS signal error\n");
-	}
-    else
-    {
-        me->faults &= ~F_tpsSignalFailure;
-    }
-
-	if (bps->bps0->ioErr_powerInit != IO_E_OK
-		|| bps->bps0->ioErr_powerSet != IO_E_OK)
-	{
-		me->faults |= F_bpsPowerFailure;
-	}
-    else
-    {
-        me->faults &= ~F_bpsPowerFailure;
-    }
-
-	if (bps->bps0->ioErr_signalInit != IO_E_OK
-		|| bps->bps0->ioErr_signalGet != IO_E_OK)
-	{
-		me->faults |= F_bpsSignalFailure;
-	}
-    else
-    {
-        me->faults &= ~F_bpsSignalFailure;
-    }
-
-	//===================================================================
-	// Make sure raw sensor readings are within operating range
-	//===================================================================
-	//RULE: EV2.3.10 - signal outside of operating range is considered a failure
-	//  This refers to SPEC SHEET values, not calibration values
-	//Note: IC cars may continue to drive for up to 100ms until valid readings are restored, but EVs must immediately cut power
-	//Note: We need to decide how to report errors and how to perform actions when those errors occur.  For now, I'm calling an imaginary Err.Report function
-	
-	//-------------------------------------------------------------------
-	//Torque Encoder
-	//-------------------------------------------------------------------
-	if (tps->tps0->sensorValue < tps->tps0->specMin || tps->tps0->sensorValue > tps->tps0->specMax
-	||  tps->tps1->sensorValue < tps->tps1->specMin || tps->tps1->sensorValue > tps->tps1->specMax)
-	{
-		me->faults |= F_tpsOutOfRange;
-	}
-    else
-    {
-        me->faults &= ~F_tpsOutOfRange;
-    }
-
-	//-------------------------------------------------------------------
-	//Brake Pressure Sensor
-	//-------------------------------------------------------------------
-	if (bps->bps0->sensorValue < bps->bps0->specMin || bps->bps0->sensorValue > bps->bps0->specMax)
-	{
-		me->faults |= F_bpsOutOfRange;
-	}
-    else
-    {
-        me->faults &= ~F_bpsOutOfRange;
-    }
-
-	//===================================================================
-	// Make sure calibrated TPS readings are in sync with each other
-	//===================================================================
-	// EV2.3.5 If an implausibility occurs between the values of these two sensors
-	//  the power to the motor(s) must be immediately shut down completely. It is not necessary 
-	//  to completely deactivate the tractive system, the motor controller(s) shutting down the 
-	//  power to the motor(s) is sufficient.
-	// EV2.3.6 Implausibility is defined as a deviation of more than 10 % pedal travel between the sensors.
-	//-------------------------------------------------------------------
-	
-	//Check for implausibility (discrepancy > 10%)
-	//RULE: EV2.3.6 Implausibility is defined as a deviation of more than 10% pedal travel between the sensors.
-	float4 tps0Percent;   //Pedal percent float (a decimal between 0 and 1
-	float4 tps1Percent;
-
-	TorqueEncoder_getIndividualSensorPercent(tps, 0, &tps0Percent); //borrow the pedal percent variable
-	TorqueEncoder_getIndividualSensorPercent(tps, 1, &tps1Percent);
-
-    //sprintf(message, "TPS0: %f\n", tps0Percent);
-    //SerialManager_send(me->serialMan, message);
-    //sprintf(message, "TPS1: %f\n", tps1Percent);
-    //SerialManager_send(me->serialMan, message);
-
-	if ((tps1Percent - tps0Percent) > .1 || (tps1Percent - tps0Percent) < -.1)  //Note: Individual TPS readings don't go negative, otherwise this wouldn't work
-	{
-
-		//Err.Report(Err.Codes.TPSDiscrepancy, "TPS discrepancy of over 10%", Motor.Stop);
-        SerialManager_send(me->serialMan, "TPS discrepancy of over 10%\n");
-
-        me->faults |= F_tpsOutOfSync;
-	}
-    else
-    {
-        me->faults &= ~F_tpsOutOfSync;
-    }
-
-    //Only one BPS right now - this fault doesn't happen
-    me->faults &= ~F_bpsOutOfSync;
-
-
-	//===================================================================
-	//Torque Encoder <-> Brake Pedal Plausibility Check
-	//===================================================================
-	// EV2.5 Torque Encoder / Brake Pedal Plausibility Check
-	//  The power to the motors must be immediately shut down completely, if the mechanical brakes 
-	//  are actuated and the torque encoder signals more than 25 % pedal travel at the same time.
-	//  This must be demonstrated when the motor controllers are under load.
-	// EV2.5.1 The motor power shut down must remain active until the torque encoder signals less than 5 % pedal travel,
-	//  no matter whether the brakes are still actuated or not.
-	//-------------------------------------------------------------------
-	//Implausibility if..
-    //float4 twelve = 12.0;
-    //SerialManager_sprintf(me->serialMan, "The number twelve: %d\n", &twelve);
-    bool tpsHigh = FALSE;
-    bool bpsHigh = FALSE;
-    if (bps->percent > .05) 
-    {
-        bpsHigh = TRUE;
-    }
-    else
-    {
-        bpsHigh = FALSE;
-    }
-
-    if (tps->percent > .25) 
-    {
-        tpsHigh = TRUE;
-    }
-    else
-    {
-        tpsHigh = FALSE;
-    }
-    
-    
-    
-    //if (bps->percent > .05 && tps->percent > .25)
-    if (tpsHigh == TRUE && bpsHigh == TRUE)
-    {
-        //If mechanical brakes actuated && tps > 25%
-       
-            me->faults |= F_tpsbpsImplausible;
-            me->tpsbpsImplausible = TRUE;
-            SerialManager_send(me->serialMan, "TPS BPS implausiblity detected.\n");
-            //From here, assume that motor controller will check for implausibility before accepting commands
-       
-    }
-	//Clear implausibility if...
-	//if ((me->faults & F_tpsbpsImplausible) > 0)
-	//{
-		if (tps->percent < .10) //TPS is reduced to < 5%
-		{
-            //me->tpsbpsImplausible = FALSE;
-            //SerialManager_send(me->serialMan, "TPS below .05.  No implausibility.\n");
-			me->faults &= ~(F_tpsbpsImplausible);  //turn off the implausibility flag
-		}
-	//}
-
-        SerialManager_send(me->serialMan, "\n");
-
-
-
-
-    /*****************************************************************************
-    * Warnings
-    ****************************************************************************/
-    //===================================================================
-    // LVS Battery Check - FAULTS LATCH UNTIL RETURN TO PREVIOUS STAGE
-    //===================================================================
-    //  IO_ADC_UBAT: 0..40106  (0V..40.106V)
-    //-------------------------------------------------------------------
-    if (LVBattery->sensorValue <= 9200)  //12730 = 10% SOC but hard to tell under load. 9200 = empty
-    {
-        me->faults |= F_lvsBatteryVeryLow;
-        me->warnings |= W_lvsBatteryLow;
-        sprintf(message, "LVS battery %.03fV EXTREMELY LOW!\n", (float4)LVBattery->sensorValue / 1000);
-        SerialManager_send(me->serialMan, message);
-    }
-    else if (LVBattery->sensorValue <= 12730)  //13100 = Recharge percentage, per Shorai
-    {
-        me->faults &= ~F_lvsBatteryVeryLow;
-        me->warnings |= W_lvsBatteryLow;
-        sprintf(message, "LVS battery %.03fV LOW.\n", (float4)LVBattery->sensorValue / 1000);
-        SerialManager_send(me->serialMan, message);
-    }
-    else
-    {
-        me->warnings &= ~F_lvsBatteryVeryLow;
-        me->warnings &= ~W_lvsBatteryLow;
-        //sprintf(message, "LVS battery %.03fV good.\n", (float4)LVBattery->sensorValue / 1000);
+    case SAFETY_FAULT:   me->faults = (me->faults & ~rule->flag) | set; break;
+    case SAFETY_WARNING: me->warnings = (me->warnings & ~(ubyte2)rule->flag) | (ubyte2)set; break;
+    case SAFETY_NOTICE:  me->notices = (me->notices & ~(ubyte2)rule->flag) | (ubyte2)set; break;
     }
+}
 
-    //===================================================================
-    // Safety checker bypass
-    //===================================================================
-    // The safety checker should only be bypassed by a CAN message sent by
-    // the PCAN Explorer dashboard.  This is only used during debugging.
-    //-------------------------------------------------------------------
-    //In case CAN communication is lost, the bypass should be disabled after some time, 
-    if (IO_RTC_GetTimeUS(me->timestamp_bypassSafetyChecks) < me->bypassSafetyChecksTimeout_us)
-    {
-        me->warnings |= W_safetyBypassEnabled;
-    }
-    else
-    {
-        me->warnings &= ~W_safetyBypassEnabled;
-    }
+//Evaluates every rule whose schedule matches.  Returns the rules that still
+//have a debounce running (so SAFETY_INPUT_* rules get another look next time).
+static ubyte1 SafetyChecker_evaluate(SafetyChecker* me, ubyte1 schedule)
+{
+    ubyte4 now = IO_RTC_GetTimeUS(me->timebase);
+    ubyte1 pending = 0;
 
-    //===================================================================
-    // HVIL Override
-    //===================================================================
-    if (MCM_getHvilOverrideStatus(mcm) == TRUE)
+    for (ubyte1 i = 0; i < SAFETY_RULE_COUNT; i++)
     {
-        me->warnings |= W_hvilOverrideEnabled;
-    }
-    else
-    {
-        me->warnings &= ~W_hvilOverrideEnabled;
-    }
+        const SafetyRule* rule = &safetyRules[i];
+        SafetyRuleState* state = &me->ruleStates[i];
 
-	/*****************************************************************************
-	* Notices
-	****************************************************************************/
+        if ((rule->schedule & schedule) == 0) { continue; }
 
-    //===================================================================
-    // HVIL Term Sense Check
-    //===================================================================
-    // If HVIL term sense goes low (because HV went down), motor torque
-    // command should be set to zero before turning off the controller
-    //-------------------------------------------------------------------
-    if (HVILTermSense->sensorValue == FALSE)
-    {
-        me->notices |= N_HVILTermSenseLost;
-    }
-    else
-    {
-        me->notices &= ~N_HVILTermSenseLost;
-    }
+        bool condition = rule->condition(me, state->active);
+        if (condition != state->condition)
+        {
+            state->condition = condition;
+            state->timestamp_changed = now;
+        }
+        if (condition == state->active) { continue; }  //Nothing to do
 
+        ubyte4 delay_us = (ubyte4)(condition ? rule->setDelay_ms : rule->clearDelay_ms) * 1000;
+        if (now - state->timestamp_changed < delay_us)
+        {
+            pending |= rule->schedule;
+            continue;
+        }
 
-    if (BMS_getPower(bms) > 75000)
-    {
-        me->notices |= N_Over75kW_BMS;
-    }
-    else
-    {
-        me->notices &= ~N_Over75kW_BMS;
+        state->active = condition;
+        SafetyChecker_setFlag(me, rule, condition);
+        if (condition == TRUE && rule->message != NULL)
+        {
+            SerialManager_log(me->serialMan, (rule->level == SAFETY_FAULT) ? SERIAL_ERROR : SERIAL_WARNING, rule->message);
+        }
     }
+    return pending;
+}
 
-        
-    if (MCM_getPower(mcm) > 75000)
-    {
-        me->notices |= N_Over75kW_MCM;
-    }
-    else
-    {
-        me->notices &= ~N_Over75kW_MCM;
-    }
+//Pedal plausibility - run every tick, after the TPS/BPS updates
+void SafetyChecker_updateFast(SafetyChecker* me, const VehicleState* state)
+{
+    me->state = state;
+    SafetyChecker_evaluate(me, SAFETY_FAST);
+    me->tpsbpsImplausible = ((me->faults & F_tpsbpsImplausible) != 0);
+}
 
+//Everything else
+void SafetyChecker_update(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, const VehicleState* state)
+{
+    me->mcm = mcm;
+    me->bms = bms;
+    me->state = state;
+
+    //Which rarely-changing inputs changed?
+    ubyte1 calibration = state->pedalStatus & (VEHICLESTATE_TPS_CALIBRATED | VEHICLESTATE_BPS_CALIBRATED);
+    ubyte1 powerErrors = state->pedalStatus & (VEHICLESTATE_TPS_POWER_ERROR | VEHICLESTATE_BPS_POWER_ERROR);
+    if (calibration != me->lastCalibration) { me->dirtyInputs |= SAFETY_INPUT_CALIBRATION; }
+    if (powerErrors != me->lastPowerErrors) { me->dirtyInputs |= SAFETY_INPUT_POWER; }
+    me->lastCalibration = calibration;
+    me->lastPowerErrors = powerErrors;
+
+    ubyte1 pending = SafetyChecker_evaluate(me, SAFETY_SLOW | (me->dirtyInputs & ~(SAFETY_FAST | SAFETY_SLOW)));
+    me->dirtyInputs = pending & ~(SAFETY_FAST | SAFETY_SLOW);
 }
 
 
@@ -461,9 +455,7 @@ ubyte4 SafetyChecker_getNotices(SafetyChecker* me)
 
 void SafetyChecker_reduceTorque(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms)
 {
-    float4 multiplier = 1;
-    //float4 tempMultiplier = 1;
-    sbyte1 groundSpeedKPH = MCM_getGroundSpeedKPH(mcm);
+    Q15 multiplier = FIXEDPOINT_ONE;
 
     //-------------------------------------------------------------------
     // Critical conditions - set 0 torque
@@ -472,95 +464,24 @@ void SafetyChecker_reduceTorque(SafetyChecker* me, MotorController* mcm, Battery
     {
         multiplier = 0;
     }
-    //////////if ((me->notices & N_HVILTermSenseLost) > 0) // HVIL is low (must command 0 torque before opening MCM relay
-    //////////{
-    //////////    multiplier = 0;
-    //////////    SerialManager_send(me->serialMan, "SC.0: HVIL term sense low\n");
-    //////////}
-    ////////if (MCM_commands_getTorque(mcm) < 0 && groundSpeedKPH < 5)  //No regen below 5kph
-    ////////{
-    ////////    SerialManager_send(me->serialMan, "SC.0: Regen < 5kph\n");
-    ////////    multiplier = 0;
-    ////////}
-    //-------------------------------------------------------------------
-    // Other limits (% reduction) - set torque to the lowest of all these
-    // IMPORTANT: Be aware of direction-sensitive situations (accel/regen)
-    //-------------------------------------------------------------------
-    //80kW limit ---------------------------------
-    // if either the bms or mcm goes over 75kw, limit torque 
-    //////////if ((BMS_getPower(bms) > 75000) || (MCM_getPower(mcm) > 75000))
-    //////////{
-    //////////    // using bmsPower since closer to e-meter
-    //////////    tempMultiplier = 1 - getPercent(max(BMS_getPower(bms), MCM_getPower(mcm)), 75000, 80000, TRUE);
-    //////////    SerialManager_send(me->serialMan, "SC.Mult: 80kW\n");
-    //////////}
-    //////////if (tempMultiplier < multiplier) { multiplier = tempMultiplier; }
-
-    //CCL/DCL from BMS --------------------------------
-    //why the DCL/CCL could be limited:
-    //0: No limit
-    //1 : Pack voltage too low
-    //2 : Pack voltage high
-    //3 : Cell voltage low
-    //4 : Cell voltage high
-    //5 : Temperature high for charging
-    //6 : Temperature too low for charging
-    //7 : Temperature high for discharging
-    //8 : Temperature too low for discharging
-    //9 : Charging current peak lasted too long
-    //10 = A : Discharging current peak lasted too long
-    //11 = B : Power up delay(Charge testing)
-    //12 = C : Fault
-    //13 = D : Contactors are off
-    ////////if (MCM_commands/*_getTorque(mcm) >= 0)
-    ////////{*/
-        ///////////*tempMultiplier = getPercent(BMS_getDCL(bms), 0, me->maxAmpsDischarge, TRUE);
-        //////////if (tempMultiplier < 1)
-        //////////{
-        //////////    SerialManager_send(me->serialMan, "SC.Mult: DCL\n");
-        //////////}*/
-    //////////}
-    //////////else //regen - Pick the lowest of CCL and speed reductions
-    //////////{
-    //////////    tempMultiplier = getPercent(BMS_getCCL(bms), 0, me->maxAmpsCharge, TRUE);
-    //////////    if (tempMultiplier < 1)
-    //////////    {
-    //////////        SerialManager_send(me->serialMan, "SC.Mult: CCL\n");
-    //////////    }
-    //////////    //Also, regen should be ramped down as speed approaches minimum
-    //////////    if ( groundSpeedKPH < 15)
-    //////////    {
-    //////////        float4 regenMultiplier = 1 - getPercent(groundSpeedKPH, MCM_getRegenMinSpeed(mcm), MCM_getRegenRampdownStartSpeed(mcm), TRUE);
-    //////////        if (tempMultiplier < 1) { SerialManager_send(me->serialMan, "SC.Mult: Regen < 15kph\n"); }
-    //////////        if (regenMultiplier < tempMultiplier) { tempMultiplier = regenMultiplier; } // Pick the lesser of CCL (tempMultiplier) or speed reduction (regenMultiplier)
-    //////////    }
-    //////////}
-    ////////if (tempMultiplier < multiplier) { multiplier = tempMultiplier; }
-
-    //Reduce the torque command.  Multiplier should be a percent value (between 0 and 1)
-
-	//If the safety bypass is enabled, then override the multiplier to 100% (no reduction)
+
+	//If the safety bypass is enabled, then leave the torque command alone (no reduction)
     if ((me->warnings & W_safetyBypassEnabled) == W_safetyBypassEnabled)
 	{
-		multiplier = 1;
+		return;
 	}
-    MCM_commands_setTorqueDNm(mcm, MCM_commands_getTorque(mcm) * multiplier);
+
+    //Reduce the torque command.  Multiplier is a Q15 percent (between 0 and FIXEDPOINT_ONE)
+    sbyte2 torque = (sbyte2)FixedPoint_mul(MCM_commands_getTorque(mcm), multiplier);
+
+    //-------------------------------------------------------------------
+    // Other limits - 80 kW, BMS DCL/CCL, low speed regen (see powerLimiter.h).
+    // Direction-sensitive: the ceiling depends on drive vs regen.
+    //-------------------------------------------------------------------
+    MCM_commands_setTorqueDNm(mcm, PowerLimiter_limitTorque(me->powerLimiter, mcm, bms, torque));
 }
 
-//-------------------------------------------------------------------
-// 80kW Limit Check
-//-------------------------------------------------------------------
-//Change this to return a multiplier instead of torque value
-//ubyte2 checkPowerDraw(BatteryManagementSystem* bms, MotorController* mcm)
-//{
-//    ubyte2 torqueThrottle = 0;
-//
-//    // if either the bms or mcm goes over 75kw, limit torque 
-//    if ((BMS_getPower(bms) > 75000) || (MCM_getPower(mcm) > 75000))
-//    {
-//        // using bmsPower since closer to e-meter
-//        torqueThrottle = MCM_getCommandedTorque(mcm) - (((BMS_getPower(bms) - 80000) / 80000) * MCM_getCommandedTorque(mcm));
-//    }
-//
-//    return torqueThrottle;
-//}
+PowerLimiter* SafetyChecker_getPowerLimiter(SafetyChecker* me)
+{
+    return me->powerLimiter;
+}
@@ -8,6 +8,8 @@
 #include "sensors.h"
 #include "motorController.h"
 #include "bms.h"
+#include "powerLimiter.h"
+#include "vehicleState.h"
 #include "serial.h"
 
 /*
@@ -21,18 +23,22 @@ typedef enum { CHECK_tpsOutOfRange    , CHECK_bpsOutOfRange
 typedef struct _SafetyChecker SafetyChecker;
 
 SafetyChecker* SafetyChecker_new(SerialManager* sm, ubyte2 maxChargeAmps, ubyte2 maxDischargeAmps);
-void SafetyChecker_update(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, TorqueEncoder* tps, BrakePressureSensor* bps, Sensor* HVILTermSense, Sensor* LVBattery);
+//Pedal plausibility (EV2.3.5, EV2.3.10, EV2.5).  Every fast task tick, before reduceTorque,
+//on the snapshot being built (VehicleStateBuffer_getBack - the inputs are filled in by then).
+void SafetyChecker_updateFast(SafetyChecker* me, const VehicleState* state);
+//All other checks (medium task), on the published snapshot
+void SafetyChecker_update(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, const VehicleState* state);
 void SafetyChecker_parseCanMessage(SafetyChecker* me, IO_CAN_DATA_FRAME* canMessage);
 bool SafetyChecker_allSafe(SafetyChecker* me);
 ubyte4 SafetyChecker_getFaults(SafetyChecker* me);
 ubyte4 SafetyChecker_getWarnings(SafetyChecker* me);
 ubyte4 SafetyChecker_getNotices(SafetyChecker* me);
+//Every fast tick, after MCM_calculateCommands: faults -> 0 torque, then the power limiter ceilings
 void SafetyChecker_reduceTorque(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms);
+PowerLimiter* SafetyChecker_getPowerLimiter(SafetyChecker* me);  //For telemetry
 //bool SafetyChecker_getError(SafetyChecker* me, SafetyCheck check);
 //bool SafetyChecker_getErrorByte(SafetyChecker* me, ubyte1* errorByte);
 
-//ubyte2 checkPowerDraw(BatteryManagementSystem* bms, MotorController* mcm);
 void checkBatteryPackTemp(BatteryManagementSystem* bms);
-ubyte2 checkPowerDraw(BatteryManagementSystem* bms, MotorController* mcm);
 
 #endif //  _SAFETY_H
\ No newline at end of file
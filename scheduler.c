@@ -0,0 +1,196 @@
+#include "IO_Driver.h"
+#include "IO_RTC.h"
+#include "IO_UART.h"
+
+#include "scheduler.h"
+#include "arena.h"
+#include "loopTiming.h"
+
+#define SCHEDULER_MAX_TASKS 8
+#define SCHEDULER_MAX_BACKGROUND_TASKS 4
+
+typedef struct _SchedulerTask
+{
+    SchedulerTaskFunction run;
+    void* object;
+    ubyte2 periodTicks;
+    ubyte2 phaseTicks;
+    ubyte2 ticksUntilDue;  //Counts down to 0, so no division is needed every tick
+    ubyte2 overruns;
+} SchedulerTask;
+
+typedef struct _SchedulerBackgroundTask
+{
+    SchedulerTaskFunction run;
+    void* object;
+} SchedulerBackgroundTask;
+
+struct _Scheduler
+{
+    ubyte4 tickPeriodus;
+
+    //Times are microseconds since this IO_RTC timestamp (wrap-safe differences)
+    ubyte4 timebase;
+    ubyte4 tickStartTime;
+
+    ubyte4 tickCount;
+    ubyte4 tickOverruns;
+    ubyte4 missedTicks;
+
+    SchedulerTask tasks[SCHEDULER_MAX_TASKS];
+    ubyte1 taskCount;
+
+    SchedulerBackgroundTask background[SCHEDULER_MAX_BACKGROUND_TASKS];
+    ubyte1 backgroundCount;
+    ubyte1 nextBackground;
+};
+
+Scheduler* Scheduler_new(ubyte4 tickPeriodus)
+{
+    Scheduler* me = (Scheduler*)Arena_allocate(ARENA_INTERNAL, sizeof(struct _Scheduler));
+
+    me->tickPeriodus = tickPeriodus;
+    IO_RTC_StartTime(&me->timebase);
+    me->tickStartTime = 0;
+
+    me->tickCount = 0;
+    me->tickOverruns = 0;
+    me->missedTicks = 0;
+
+    me->taskCount = 0;
+    me->backgroundCount = 0;
+    me->nextBackground = 0;
+
+    return me;
+}
+
+ubyte1 Scheduler_addTask(Scheduler* me, SchedulerTaskFunction run, void* object, ubyte2 periodTicks, ubyte2 phaseTicks)
+{
+    if (me->taskCount >= SCHEDULER_MAX_TASKS || periodTicks == 0) { return SCHEDULER_NO_TASK; }
+
+    SchedulerTask* task = &me->tasks[me->taskCount];
+    task->run = run;
+    task->object = object;
+    task->periodTicks = periodTicks;
+    task->phaseTicks = phaseTicks % periodTicks;
+    task->ticksUntilDue = task->phaseTicks;
+    task->overruns = 0;
+
+    return me->taskCount++;
+}
+
+bool Scheduler_addBackgroundTask(Scheduler* me, SchedulerTaskFunction run, void* object)
+{
+    if (me->backgroundCount >= SCHEDULER_MAX_BACKGROUND_TASKS) { return FALSE; }
+
+    me->background[me->backgroundCount].run = run;
+    me->background[me->backgroundCount].object = object;
+    me->backgroundCount++;
+    return TRUE;
+}
+
+/*-------------------------------------------------------------------
+* Scheduler_runTick
+* Runs every periodic task that is due this tick, in the order they were added.
+* Tasks run inside IO_Driver_TaskBegin/End (one SW cycle per tick).
+-------------------------------------------------------------------*/
+static void Scheduler_runTick(Scheduler* me)
+{
+    bool overran = FALSE;
+
+    LOOPTIMING_START(LOOPTIMING_TICK);
+    IO_Driver_TaskBegin();
+    for (ubyte1 i = 0; i < me->taskCount; i++)
+    {
+        SchedulerTask* task = &me->tasks[i];
+        if (task->ticksUntilDue > 0)
+        {
+            task->ticksUntilDue--;
+            continue;
+        }
+        task->ticksUntilDue = task->periodTicks - 1;
+
+        task->run(task->object);
+
+        //Blame the task that was running when the deadline passed
+        if (overran == FALSE && IO_RTC_GetTimeUS(me->timebase) - me->tickStartTime >= me->tickPeriodus)
+        {
+            overran = TRUE;
+            if (task->overruns < 0xFFFF) { task->overruns++; }
+        }
+    }
+    IO_Driver_TaskEnd();
+    LOOPTIMING_STOP(LOOPTIMING_TICK);
+
+    if (overran == TRUE) { me->tickOverruns++; }
+    me->tickCount++;
+}
+
+void Scheduler_run(Scheduler* me)
+{
+    me->tickStartTime = IO_RTC_GetTimeUS(me->timebase);
+    while (1)
+    {
+        Scheduler_runTick(me);
+
+        //----------------------------------------------------------------------------
+        // Next tick starts one period after this one did (fixed rate, no drift).
+        // If we're already more than a whole period late, skip ahead instead of
+        // running a burst of back-to-back ticks.
+        //----------------------------------------------------------------------------
+        me->tickStartTime += me->tickPeriodus;
+        sbyte4 lateness = (sbyte4)(IO_RTC_GetTimeUS(me->timebase) - me->tickStartTime);
+        if (lateness >= (sbyte4)me->tickPeriodus)
+        {
+            ubyte4 ticksBehind = (ubyte4)lateness / me->tickPeriodus;
+            me->missedTicks += ticksBehind;
+            me->tickStartTime += ticksBehind * me->tickPeriodus;
+        }
+
+        //----------------------------------------------------------------------------
+        // Background work until the next tick is due
+        //----------------------------------------------------------------------------
+        while ((sbyte4)(me->tickStartTime - IO_RTC_GetTimeUS(me->timebase)) > 0)
+        {
+            IO_UART_Task();  //The task function shall be called every SW cycle.
+            if (me->backgroundCount > 0)
+            {
+                SchedulerBackgroundTask* task = &me->background[me->nextBackground];
+                task->run(task->object);
+                me->nextBackground = (me->nextBackground + 1) % me->backgroundCount;
+            }
+        }
+    }
+}
+
+void Scheduler_step(Scheduler* me)
+{
+    me->tickStartTime = IO_RTC_GetTimeUS(me->timebase);
+    Scheduler_runTick(me);
+
+    IO_UART_Task();
+    for (ubyte1 i = 0; i < me->backgroundCount; i++)
+    {
+        me->background[i].run(me->background[i].object);
+    }
+}
+
+ubyte4 Scheduler_getTickCount(Scheduler* me)
+{
+    return me->tickCount;
+}
+
+ubyte4 Scheduler_getTickOverruns(Scheduler* me)
+{
+    return me->tickOverruns;
+}
+
+ubyte4 Scheduler_getMissedTicks(Scheduler* me)
+{
+    return me->missedTicks;
+}
+
+ubyte2 Scheduler_getTaskOverruns(Scheduler* me, ubyte1 task)
+{
+    return (task < me->taskCount) ? me->tasks[task].overruns : 0;
+}
@@ -0,0 +1,43 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include "IO_Driver.h"
+
+/*****************************************************************************
+* Cyclic executive
+******************************************************************************
+* Runs periodic tasks from a fixed tick (e.g. 5 ms).  Each task has a period
+* and a phase (both in ticks) so tasks with the same period can be spread
+* across different ticks.  Whatever time is left in a tick is spent running
+* background tasks round-robin (and IO_UART_Task).
+*
+* A tick overruns when its periodic tasks are still running at the start of
+* the next tick.  Overruns are counted for the whole schedule and for the task
+* that was running when the deadline passed.
+****************************************************************************/
+typedef struct _Scheduler Scheduler;
+
+//object is the pointer that was given when the task was added
+typedef void (*SchedulerTaskFunction)(void* object);
+
+#define SCHEDULER_NO_TASK 0xFF
+
+Scheduler* Scheduler_new(ubyte4 tickPeriodus);
+
+//Returns the task's index, or SCHEDULER_NO_TASK if the task table is full / period is 0
+ubyte1 Scheduler_addTask(Scheduler* me, SchedulerTaskFunction run, void* object, ubyte2 periodTicks, ubyte2 phaseTicks);
+bool Scheduler_addBackgroundTask(Scheduler* me, SchedulerTaskFunction run, void* object);
+
+//Never returns
+void Scheduler_run(Scheduler* me);
+
+//One tick starting now, then each background task once - no waiting on the clock.
+//For the host replay build (host/), which steps the simulated clock itself.
+void Scheduler_step(Scheduler* me);
+
+ubyte4 Scheduler_getTickCount(Scheduler* me);
+ubyte4 Scheduler_getTickOverruns(Scheduler* me);
+ubyte4 Scheduler_getMissedTicks(Scheduler* me);  //Ticks skipped because a tick ran longer than a whole period
+ubyte2 Scheduler_getTaskOverruns(Scheduler* me, ubyte1 task);
+
+#endif // _SCHEDULER_H
@@ -12,6 +12,7 @@
 *                              statement inside of a loop
 *****************************************************************************/
 
+#include <stdio.h>  //sprintf
 #include "IO_Driver.h"  //Includes datatypes, constants, etc - should be included in every c file
 #include "IO_ADC.h"
 #include "IO_PWD.h"
@@ -20,6 +21,7 @@
 
 #include "sensors.h"
 #include "mathFunctions.h"
+#include "serial.h"
 
 extern Sensor Sensor_TPS0;
 extern Sensor Sensor_TPS1;
@@ -51,64 +53,250 @@ extern Sensor Sensor_HVILTerminationSense;
 * Returns the % (position) of value, between min and max
 * If zeroToOneOnly is true, then % will be capped at 0%-100% (no negative % or > 100%)
 -------------------------------------------------------------------*/
+/*-------------------------------------------------------------------
+* Sample history / filters
+-------------------------------------------------------------------*/
+void Sensor_setFilter(Sensor* sensor, SensorFilter filter, ubyte1 shift)
+{
+    //The moving average window can't be longer than the history
+    if (filter == SENSOR_FILTER_MOVING_AVERAGE)
+    {
+        while (((ubyte2)1 << shift) > SENSOR_HISTORY_LENGTH) { shift--; }
+    }
+    sensor->filter = filter;
+    sensor->filterShift = shift;
+    sensor->historyPrimed = FALSE;  //Restart from the next sample
+}
+
+static ubyte2 Sensor_median3(ubyte2 a, ubyte2 b, ubyte2 c)
+{
+    if (a > b) { ubyte2 temp = a; a = b; b = temp; }  //a <= b
+    if (b > c) { b = (a > c) ? a : c; }
+    return b;
+}
+
+void Sensor_addSample(Sensor* sensor)
+{
+    ubyte2 sample = (sensor->rawValue > 0xFFFF) ? 0xFFFF : (ubyte2)sensor->rawValue;
+    ubyte1 mask = SENSOR_HISTORY_LENGTH - 1;
+    ubyte1 i = sensor->historyIndex;
+
+    //Start from the first reading instead of ramping up from 0
+    if (sensor->historyPrimed == FALSE)
+    {
+        for (ubyte1 j = 0; j < SENSOR_HISTORY_LENGTH; j++) { sensor->history[j] = sample; }
+        sensor->filterState = (ubyte4)sample << sensor->filterShift;
+        sensor->historyPrimed = TRUE;
+    }
+
+    switch (sensor->filter)
+    {
+    case SENSOR_FILTER_MOVING_AVERAGE:
+        //Add the new sample, drop the one that is 2^shift samples old (read it before it's overwritten)
+        sensor->filterState += sample;
+        sensor->filterState -= sensor->history[(i - (1 << sensor->filterShift)) & mask];
+        sensor->history[i] = sample;
+        sensor->sensorValue = sensor->filterState >> sensor->filterShift;
+        break;
+
+    case SENSOR_FILTER_IIR:
+        sensor->filterState = sensor->filterState - (sensor->filterState >> sensor->filterShift) + sample;
+        sensor->history[i] = sample;
+        sensor->sensorValue = sensor->filterState >> sensor->filterShift;
+        break;
+
+    case SENSOR_FILTER_MEDIAN3:
+        sensor->history[i] = sample;
+        sensor->sensorValue = Sensor_median3(sample, sensor->history[(i - 1) & mask], sensor->history[(i - 2) & mask]);
+        break;
+
+    default:
+        sensor->history[i] = sample;
+        sensor->sensorValue = sensor->rawValue;
+        break;
+    }
+
+    sensor->historyIndex = (i + 1) & mask;
+}
+
+ubyte2 Sensor_getHistory(Sensor* sensor, ubyte1 samplesAgo)
+{
+    return sensor->history[(sensor->historyIndex - 1 - samplesAgo) & (SENSOR_HISTORY_LENGTH - 1)];
+}
+
+//----------------------------------------------------------------------------
+// Sensor channel table
+//----------------------------------------------------------------------------
+// Every input sensors_updateSensors reads, one row per channel.  Each channel
+// is read on the calls where (call count % pollDivisor) == pollPhase, so
+// things that change on a human timescale aren't read every tick.  Give slow
+// channels different phases so they don't all land on the same tick.
+// With the 5 ms fast task: divisor 4 = 20 ms, divisor 20 = 100 ms.
+//
+// The name is only used to report channels that never became ready at startup.
+//----------------------------------------------------------------------------
+typedef enum
+{
+      SENSOR_DRIVER_ADC         //IO_ADC_Get
+    , SENSOR_DRIVER_PWD_FREQ    //IO_PWD_FreqGet
+    , SENSOR_DRIVER_DI          //IO_DI_Get
+} SensorDriver;
+
+typedef struct _SensorChannel
+{
+    Sensor* sensor;
+    SensorDriver driver;
+    ubyte1 channel;
+    ubyte1 pollDivisor;   //1 = every call
+    ubyte1 pollPhase;     //0 .. pollDivisor-1
+    const ubyte1* name;
+} SensorChannel;
+
+static const SensorChannel sensorChannels[] =
+{
+    //Torque Encoders / Brake Position Sensor
+    //(production TPS may move to PWD: IO_PWD_PulseGet on IO_PWM_00/01)
+      { &Sensor_TPS0,                 SENSOR_DRIVER_ADC,      IO_ADC_5V_00, 1,  0, "TPS0" }
+    , { &Sensor_TPS1,                 SENSOR_DRIVER_ADC,      IO_ADC_5V_01, 1,  0, "TPS1" }
+    , { &Sensor_BPS0,                 SENSOR_DRIVER_ADC,      IO_ADC_5V_02, 1,  0, "BPS0" }
+    //, { &Sensor_BPS1,               SENSOR_DRIVER_ADC,      IO_ADC_5V_03, 1,  0, "BPS1" }
+
+    //Wheel speed sensors
+    , { &Sensor_WSS_FL,               SENSOR_DRIVER_PWD_FREQ, IO_PWD_10,    1,  0, "WSS_FL" }
+    , { &Sensor_WSS_FR,               SENSOR_DRIVER_PWD_FREQ, IO_PWD_08,    1,  0, "WSS_FR" }
+    , { &Sensor_WSS_RL,               SENSOR_DRIVER_PWD_FREQ, IO_PWD_11,    1,  0, "WSS_RL" }
+    , { &Sensor_WSS_RR,               SENSOR_DRIVER_PWD_FREQ, IO_PWD_09,    1,  0, "WSS_RR" }
+
+    //HVIL is read every tick - the MCM relay logic reacts to it
+    , { &Sensor_HVILTerminationSense, SENSOR_DRIVER_DI,       IO_DI_07,     1,  0, "HVIL" }
+
+    //Driver controls
+    , { &Sensor_TCSKnob,              SENSOR_DRIVER_ADC,      IO_ADC_5V_04, 4,  1, "TCSKnob" }
+    , { &Sensor_RTDButton,            SENSOR_DRIVER_DI,       IO_DI_00,     4,  2, "RTDButton" }
+    , { &Sensor_EcoButton,            SENSOR_DRIVER_DI,       IO_DI_01,     4,  3, "EcoButton" }
+    , { &Sensor_TCSSwitchUp,          SENSOR_DRIVER_DI,       IO_DI_02,     20, 5, "TCSSwitchUp" }
+    , { &Sensor_TCSSwitchDown,        SENSOR_DRIVER_DI,       IO_DI_03,     20, 6, "TCSSwitchDown" }
+
+    //Shock pots (not fitted - channels need IO_ADC_ChannelInit too)
+    //, { &Sensor_WPS_FL,             SENSOR_DRIVER_ADC,      IO_ADC_5V_05, 4,  0, "WPS_FL" }
+    //, { &Sensor_WPS_FR,             SENSOR_DRIVER_ADC,      IO_ADC_5V_06, 4,  1, "WPS_FR" }
+    //, { &Sensor_WPS_RL,             SENSOR_DRIVER_ADC,      IO_ADC_5V_07, 4,  2, "WPS_RL" }
+    //, { &Sensor_WPS_RR,             SENSOR_DRIVER_ADC,      IO_ADC_5V_03, 4,  3, "WPS_RR" }
+
+    //Battery voltage (at VCU internal electronics supply input)
+    , { &Sensor_LVBattery,            SENSOR_DRIVER_ADC,      IO_ADC_UBAT,  20, 10, "LVBattery" }
+};
+
+#define SENSOR_CHANNEL_COUNT (sizeof(sensorChannels) / sizeof(sensorChannels[0]))
+
+//Consecutive good readings per channel, for sensors_isReady (saturates at 255).
+//PWD channels are left out: with the car stopped there are no pulses to measure.
+static ubyte1 sensorGoodReadings[SENSOR_CHANNEL_COUNT];
+
+static void sensors_readChannel(ubyte1 index)
+{
+    const SensorChannel* input = &sensorChannels[index];
+    Sensor* sensor = input->sensor;
+    bool good;
+
+    //The drivers return 16-bit / bool values - read into the right type, then widen
+    switch (input->driver)
+    {
+    case SENSOR_DRIVER_ADC:
+    {
+        ubyte2 value;
+        sensor->ioErr_signalGet = IO_ADC_Get(input->channel, &value, &sensor->fresh);
+        sensor->rawValue = value;
+        good = (sensor->ioErr_signalGet == IO_E_OK && sensor->fresh == TRUE);
+        break;
+    }
+    case SENSOR_DRIVER_PWD_FREQ:
+    {
+        ubyte2 value;
+        sensor->ioErr_signalGet = IO_PWD_FreqGet(input->channel, &value);
+        sensor->rawValue = value;
+        good = TRUE;
+        break;
+    }
+    case SENSOR_DRIVER_DI:
+    {
+        bool value;
+        sensor->ioErr_signalGet = IO_DI_Get(input->channel, &value);
+        sensor->rawValue = value;
+        good = (sensor->ioErr_signalGet == IO_E_OK);
+        break;
+    }
+    default:
+        good = FALSE;
+    }
+
+    //An ADC read that just isn't fresh yet doesn't count against the channel - only errors do
+    if (good == TRUE) { if (sensorGoodReadings[index] < 0xFF) { sensorGoodReadings[index]++; } }
+    else if (sensor->ioErr_signalGet != IO_E_OK) { sensorGoodReadings[index] = 0; }
+
+    Sensor_addSample(sensor);
+}
+
 //----------------------------------------------------------------------------
 // Read sensors values from ADC channels
 // The sensor values should be stored in sensor objects.
+// Called once per fast task tick.
 //----------------------------------------------------------------------------
 void sensors_updateSensors(void)
 {
     //TODO: Handle errors (using the return values for these Get functions)
+    static ubyte2 pollCount = 0;
 
-    //TODO: RTDS
-
-    //Torque Encoders ---------------------------------------------------
-    //Sensor_BenchTPS0.ioErr_signalGet = IO_ADC_Get(IO_ADC_5V_00, &Sensor_BenchTPS0.sensorValue, &Sensor_BenchTPS0.fresh);
-    //Sensor_BenchTPS1.ioErr_signalGet = IO_ADC_Get(IO_ADC_5V_01, &Sensor_BenchTPS1.sensorValue, &Sensor_BenchTPS1.fresh);
-    Sensor_TPS0.ioErr_signalGet = IO_ADC_Get(IO_ADC_5V_00, &Sensor_TPS0.sensorValue, &Sensor_TPS0.fresh);
-    Sensor_TPS1.ioErr_signalGet = IO_ADC_Get(IO_ADC_5V_01, &Sensor_TPS1.sensorValue, &Sensor_TPS1.fresh);
-    //Sensor_TPS0.ioErr_signalGet = IO_PWD_PulseGet(IO_PWM_00, &Sensor_TPS0.sensorValue);
-	//Sensor_TPS1.ioErr_signalGet = IO_PWD_PulseGet(IO_PWM_01, &Sensor_TPS1.sensorValue);
-
-	
-	//Brake Position Sensor ---------------------------------------------------
-	Sensor_BPS0.ioErr_signalGet = IO_ADC_Get(IO_ADC_5V_02, &Sensor_BPS0.sensorValue, &Sensor_BPS0.fresh);
-
-	//TCS Knob
-	Sensor_TCSKnob.ioErr_signalGet = IO_ADC_Get(IO_ADC_5V_04, &Sensor_TCSKnob.sensorValue, &Sensor_TCSKnob.fresh);
-    
-	//?? - For future use ---------------------------------------------------
-    //IO_ADC_Get(IO_ADC_5V_03, &Sensor_BPS1.sensorValue, &Sensor_BPS1.fresh);
-
-    //Shock pots ---------------------------------------------------
-    /*IO_ADC_Get(IO_ADC_5V_04, &Sensor_WPS_FL.sensorValue, &Sensor_WPS_FL.fresh);
-    IO_ADC_Get(IO_ADC_5V_05, &Sensor_WPS_FR.sensorValue, &Sensor_WPS_FR.fresh);
-    IO_ADC_Get(IO_ADC_5V_06, &Sensor_WPS_RL.sensorValue, &Sensor_WPS_RL.fresh);
-    IO_ADC_Get(IO_ADC_5V_07, &Sensor_WPS_RR.sensorValue, &Sensor_WPS_RR.fresh);
-	*/
-
-    //Wheel speed sensors ---------------------------------------------------
-	Sensor_WSS_FL.ioErr_signalGet = IO_PWD_FreqGet(IO_PWD_10, &Sensor_WSS_FL.sensorValue);
-	Sensor_WSS_FR.ioErr_signalGet = IO_PWD_FreqGet(IO_PWD_08, &Sensor_WSS_FR.sensorValue);
-	Sensor_WSS_RL.ioErr_signalGet = IO_PWD_FreqGet(IO_PWD_11, &Sensor_WSS_RL.sensorValue);
-	Sensor_WSS_RR.ioErr_signalGet = IO_PWD_FreqGet(IO_PWD_09, &Sensor_WSS_RR.sensorValue);
-
-    //Switches / Digital ---------------------------------------------------
-	Sensor_RTDButton.ioErr_signalGet = IO_DI_Get(IO_DI_00, &Sensor_RTDButton.sensorValue);
-	Sensor_EcoButton.ioErr_signalGet = IO_DI_Get(IO_DI_01, &Sensor_EcoButton.sensorValue);
-	Sensor_TCSSwitchUp.ioErr_signalGet = IO_DI_Get(IO_DI_02, &Sensor_TCSSwitchUp.sensorValue);
-	Sensor_TCSSwitchDown.ioErr_signalGet = IO_DI_Get(IO_DI_03, &Sensor_TCSSwitchDown.sensorValue);
-	Sensor_HVILTerminationSense.ioErr_signalGet = IO_DI_Get(IO_DI_07, &Sensor_HVILTerminationSense.sensorValue);
-
-    //Other stuff ---------------------------------------------------
-    //Battery voltage (at VCU internal electronics supply input)
-	Sensor_LVBattery.ioErr_signalGet = IO_ADC_Get(IO_ADC_UBAT, &Sensor_LVBattery.sensorValue, &Sensor_LVBattery.fresh);
+    for (ubyte1 i = 0; i < SENSOR_CHANNEL_COUNT; i++)
+    {
+        const SensorChannel* input = &sensorChannels[i];
+        if (input->pollDivisor > 1 && (pollCount % input->pollDivisor) != input->pollPhase) { continue; }
 
+        sensors_readChannel(i);
+    }
 
+    //Wrap at a multiple of every divisor (60) so the phases stay put
+    pollCount = (pollCount + 1) % 60;
+}
+
+void sensors_updateAllSensors(void)
+{
+    for (ubyte1 i = 0; i < SENSOR_CHANNEL_COUNT; i++)
+    {
+        sensors_readChannel(i);
+    }
+}
+
+bool sensors_isReady(ubyte1 requiredReadings)
+{
+    for (ubyte1 i = 0; i < SENSOR_CHANNEL_COUNT; i++)
+    {
+        if (sensorGoodReadings[i] < requiredReadings) { return FALSE; }
+    }
+    return TRUE;
+}
+
+void sensors_logNotReady(SerialManager* serialMan, ubyte1 requiredReadings)
+{
+    for (ubyte1 i = 0; i < SENSOR_CHANNEL_COUNT; i++)
+    {
+        if (sensorGoodReadings[i] < requiredReadings)
+        {
+            ubyte1 message[48];
+            sprintf(message, "Sensor %s not ready (error %u)\n", sensorChannels[i].name, (ubyte2)sensorChannels[i].sensor->ioErr_signalGet);
+            SerialManager_log(serialMan, SERIAL_WARNING, message);
+        }
+    }
 }
 
 void Light_set(Light light, float4 percent)
 {
-    ubyte2 duty = 65535 * percent;
+    Light_setDuty(light, 65535 * percent);
+}
+
+//duty: 0 = off, 65535 = fully on.  Use FixedPoint_toDuty to convert a Q15 percent.
+void Light_setDuty(Light light, ubyte2 duty)
+{
     bool power = duty > 5000 ? TRUE : FALSE; //Even though it's a lowside output, TRUE = on
 
     switch (light)
@@ -97,6 +97,7 @@
 #define _SENSORS_H
 
 #include "IO_Driver.h"
+#include "serial.h"
 
 
 
@@ -122,7 +123,24 @@ typedef enum
 // required for all sensors.
 //
 // TODO: What about having default calbiration values?  (Probably useless)
+//
+// Sampling/filtering:
+// sensors_updateSensors reads each channel into rawValue, then Sensor_addSample
+// pushes it into the sensor's history and updates sensorValue.  sensorValue is
+// the filtered value (or rawValue, if the sensor has no filter), so everything
+// that reads sensorValue gets the filtered signal.  All filters are O(1) per
+// sample - nothing is recomputed over the window.
 //----------------------------------------------------------------------------
+#define SENSOR_HISTORY_LENGTH 8  //Must be a power of 2
+
+typedef enum
+{
+      SENSOR_FILTER_NONE             //sensorValue = rawValue
+    , SENSOR_FILTER_MOVING_AVERAGE   //Average of the last 2^shift samples (running sum)
+    , SENSOR_FILTER_IIR              //First order low pass: y += (x - y) / 2^shift
+    , SENSOR_FILTER_MEDIAN3          //Median of the last 3 samples (rejects single-sample spikes)
+} SensorFilter;
+
 typedef struct _Sensor {
     //Sensor values / properties
     ubyte4 specMin;
@@ -133,8 +151,17 @@ typedef struct _Sensor {
     //ubyte2 calibNormal;  //zero value or normal position
 
     //ubyte2 calibratedValue;
-    ubyte4 sensorValue;
+    ubyte4 sensorValue;  //Filtered
+    ubyte4 rawValue;     //Latest reading straight from the IO driver
     bool fresh;
+
+    //Sample history (see Sensor_addSample).  Samples are saturated to 16 bits.
+    SensorFilter filter;
+    ubyte1 filterShift;
+    ubyte2 history[SENSOR_HISTORY_LENGTH];
+    ubyte1 historyIndex;   //Where the next sample goes
+    bool historyPrimed;    //FALSE until the first sample
+    ubyte4 filterState;    //Moving average: running sum.  IIR: output << filterShift
     //bool isCalibrated;
 	IO_ErrorType ioErr_powerInit;
 	IO_ErrorType ioErr_powerSet;
@@ -193,6 +220,19 @@ extern Sensor Sensor_LVBattery; // = { 0xA };  //Note: There will be no init for
 //----------------------------------------------------------------------------
 void sensors_updateSensors(void);
 
+//Startup: read every channel, ignoring poll divisors
+void sensors_updateAllSensors(void);
+
+//TRUE once every channel has returned requiredReadings good readings in a row
+//(ADC: OK and fresh, DI: OK.  Wheel speed PWD channels always count as ready.)
+bool sensors_isReady(ubyte1 requiredReadings);
+void sensors_logNotReady(SerialManager* serialMan, ubyte1 requiredReadings);
+
+//shift: moving average length is 2^shift samples (max SENSOR_HISTORY_LENGTH), IIR weight is 1/2^shift
+void Sensor_setFilter(Sensor* sensor, SensorFilter filter, ubyte1 shift);
+void Sensor_addSample(Sensor* sensor);
+ubyte2 Sensor_getHistory(Sensor* sensor, ubyte1 samplesAgo);  //0 = latest sample
+
 
 void setMCMRelay(bool turnOn);
 
@@ -201,5 +241,6 @@ void setMCMRelay(bool turnOn);
 // Outputs
 //----------------------------------------------------------------------------
 void Light_set(Light light, float4 percent);
+void Light_setDuty(Light light, ubyte2 duty);
 
 #endif // _SENSORS_H
\ No newline at end of file
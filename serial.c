@@ -1,9 +1,25 @@
-#include <stdlib.h>  //Needed for malloc
 #include <stdio.h>  //sprintf
 #include <string.h>
 #include "IO_Driver.h"
+#include "IO_RTC.h"
 #include "IO_UART.h"
 #include "serial.h"
+#include "arena.h"
+#include "loopTiming.h"
+
+//Outgoing data.  Must be a power of 2.
+#define SERIALMANAGER_BUFFER_SIZE 1024
+
+//Repeated message suppression
+#define SERIALMANAGER_REPEAT_SLOTS 8
+#define SERIALMANAGER_REPEAT_WINDOW_US 1000000
+
+typedef struct _SerialRepeat
+{
+    ubyte2 key;                  //Hash of the message (or format string)
+    ubyte4 timestamp_lastSent;   //SerialManager timebase
+    ubyte2 suppressed;           //Times it was sent again inside the window
+} SerialRepeat;
 
 struct _SerialManager {
     //Init stuff
@@ -11,31 +27,195 @@ struct _SerialManager {
     //packet size
     //???
 
-    //More stuff
-    ubyte1 size;  //This value is thrown away
+    SerialLevel minimumLevel;
+
+    //Ring buffer: head = next byte written by send, tail = next byte handed to the UART
+    ubyte1 buffer[SERIALMANAGER_BUFFER_SIZE];
+    ubyte2 head;
+    ubyte2 tail;
+
+    ubyte2 droppedCount;        //Total messages dropped because the buffer was full
+    ubyte2 droppedUnreported;   //Dropped since the last "(N messages dropped)" notice
+
+    ubyte4 timebase;            //IO_RTC timestamp that repeat times are measured from
+    SerialRepeat repeats[SERIALMANAGER_REPEAT_SLOTS];
 };
 
 SerialManager* SerialManager_new(void)
 {
-    SerialManager* me = (SerialManager*)malloc(sizeof(struct _SerialManager));
+    SerialManager* me = (SerialManager*)Arena_allocate(ARENA_EXTERNAL, sizeof(struct _SerialManager));
     IO_UART_Init(IO_UART_RS232, 115200, 8, IO_UART_PARITY_NONE, 1);
 
+    me->minimumLevel = SERIAL_INFO;
+    me->head = 0;
+    me->tail = 0;
+    me->droppedCount = 0;
+    me->droppedUnreported = 0;
+
+    IO_RTC_StartTime(&me->timebase);
+    for (ubyte1 i = 0; i < SERIALMANAGER_REPEAT_SLOTS; i++)
+    {
+        me->repeats[i].key = 0;
+        me->repeats[i].timestamp_lastSent = 0 - SERIALMANAGER_REPEAT_WINDOW_US;  //Not inside the window
+        me->repeats[i].suppressed = 0;
+    }
+
     return me;
 }
 
-IO_ErrorType SerialManager_send(SerialManager* me, const ubyte1* data)
+void SerialManager_setLevel(SerialManager* me, SerialLevel minimumLevel)
+{
+    me->minimumLevel = minimumLevel;
+}
+
+/*-------------------------------------------------------------------
+* Ring buffer
+-------------------------------------------------------------------*/
+static ubyte2 SerialManager_freeSpace(SerialManager* me)
 {
-    IO_ErrorType err = IO_UART_Write(IO_UART_CH0, data, strlen(data), &me->size);
+    return (SERIALMANAGER_BUFFER_SIZE - 1) - ((me->head - me->tail) & (SERIALMANAGER_BUFFER_SIZE - 1));
+}
+
+//Copies a whole message into the buffer, or nothing at all
+static bool SerialManager_enqueue(SerialManager* me, const ubyte1* data, ubyte2 length)
+{
+    if (length > SerialManager_freeSpace(me)) { return FALSE; }
+
+    for (ubyte2 i = 0; i < length; i++)
+    {
+        me->buffer[me->head] = data[i];
+        me->head = (me->head + 1) & (SERIALMANAGER_BUFFER_SIZE - 1);
+    }
+    return TRUE;
+}
+
+static IO_ErrorType SerialManager_queue(SerialManager* me, const ubyte1* data, ubyte2 length)
+{
+    //Let the reader know if anything went missing (once there's room again)
+    if (me->droppedUnreported > 0)
+    {
+        ubyte1 notice[40];
+        sprintf(notice, "(%u serial messages dropped)\n", me->droppedUnreported);
+        if (SerialManager_enqueue(me, notice, strlen(notice))) { me->droppedUnreported = 0; }
+    }
+
+    if (SerialManager_enqueue(me, data, length) == FALSE)
+    {
+        if (me->droppedCount < 0xFFFF) { me->droppedCount++; }
+        if (me->droppedUnreported < 0xFFFF) { me->droppedUnreported++; }
+        return IO_E_BUSY;
+    }
+    return IO_E_OK;
+}
+
+/*-------------------------------------------------------------------
+* Repeat suppression
+* Returns FALSE if this message was already sent within the repeat window.
+-------------------------------------------------------------------*/
+static ubyte2 SerialManager_hash(const ubyte1* data, ubyte2* length)
+{
+    ubyte2 hash = 5381;
+    ubyte2 i;
+    for (i = 0; data[i] != 0; i++)
+    {
+        hash = (hash << 5) + hash + data[i];
+    }
+    *length = i;
+    return hash;
+}
+
+static bool SerialManager_allowRepeat(SerialManager* me, ubyte2 key)
+{
+    ubyte4 now = IO_RTC_GetTimeUS(me->timebase);
+    SerialRepeat* slot = NULL;
+    SerialRepeat* oldest = &me->repeats[0];
+
+    for (ubyte1 i = 0; i < SERIALMANAGER_REPEAT_SLOTS; i++)
+    {
+        if (me->repeats[i].key == key) { slot = &me->repeats[i]; break; }
+        if (now - me->repeats[i].timestamp_lastSent > now - oldest->timestamp_lastSent) { oldest = &me->repeats[i]; }
+    }
+
+    if (slot == NULL)
+    {
+        //New message - take over the slot that was used longest ago
+        slot = oldest;
+        slot->key = key;
+        slot->suppressed = 0;
+    }
+    else if (now - slot->timestamp_lastSent < SERIALMANAGER_REPEAT_WINDOW_US)
+    {
+        if (slot->suppressed < 0xFFFF) { slot->suppressed++; }
+        return FALSE;
+    }
+    else if (slot->suppressed > 0)
+    {
+        ubyte1 notice[40];
+        sprintf(notice, "(last message repeated %u times)\n", slot->suppressed);
+        SerialManager_queue(me, notice, strlen(notice));
+        slot->suppressed = 0;
+    }
+
+    slot->timestamp_lastSent = now;
+    return TRUE;
+}
+
+/*-------------------------------------------------------------------
+* Sending
+-------------------------------------------------------------------*/
+IO_ErrorType SerialManager_log(SerialManager* me, SerialLevel level, const ubyte1* data)
+{
+    IO_ErrorType err = IO_E_OK;
+    ubyte2 length;
+
+    if (level < me->minimumLevel) { return IO_E_OK; }
+
+    LOOPTIMING_START(LOOPTIMING_SERIAL);
+    ubyte2 key = SerialManager_hash(data, &length);
+    if (SerialManager_allowRepeat(me, key))
+    {
+        err = SerialManager_queue(me, data, length);
+    }
+    LOOPTIMING_STOP(LOOPTIMING_SERIAL);
     return err;
+}
 
+IO_ErrorType SerialManager_send(SerialManager* me, const ubyte1* data)
+{
+    return SerialManager_log(me, SERIAL_INFO, data);
 }
 
 IO_ErrorType SerialManager_sprintf(SerialManager* me, const ubyte1* message, void* dataValue)
 {
-    ubyte1* temp[64];
-    sprintf(&temp, message, dataValue);
-    IO_ErrorType err = IO_UART_Write(IO_UART_CH0, temp, strlen(temp), &me->size);
-    return err;
+    ubyte1 temp[64];
+    ubyte2 length;
+
+    if (SERIAL_INFO < me->minimumLevel) { return IO_E_OK; }
+    if (SerialManager_allowRepeat(me, SerialManager_hash(message, &length)) == FALSE) { return IO_E_OK; }
+
+    sprintf(temp, message, dataValue);
+    return SerialManager_queue(me, temp, strlen(temp));
+}
+
+void SerialManager_task(SerialManager* me)
+{
+    while (me->head != me->tail)
+    {
+        //Largest contiguous chunk (IO_UART_Write takes up to 255 bytes)
+        ubyte2 chunk = ((me->head > me->tail) ? me->head : SERIALMANAGER_BUFFER_SIZE) - me->tail;
+        if (chunk > 255) { chunk = 255; }
+
+        ubyte1 written = 0;
+        IO_UART_Write(IO_UART_CH0, &me->buffer[me->tail], (ubyte1)chunk, &written);
+        me->tail = (me->tail + written) & (SERIALMANAGER_BUFFER_SIZE - 1);
+
+        if (written < chunk) { break; }  //UART driver buffer is full - try again next time
+    }
+}
+
+ubyte2 SerialManager_getDroppedCount(SerialManager* me)
+{
+    return me->droppedCount;
 }
 
 //IO_ErrorType SerialManager_sendLen(SerialManager* me, const ubyte1* data, ubyte1* dataLength)
@@ -9,14 +9,31 @@ typedef struct _SerialManager SerialManager;
 //Make serialMan available globally
 //SerialManager* serialMan;
 
-//Note: Sum of messageLimits must be < 128 (hardware only does 128 total messages)
+//Messages are queued in a RAM ring buffer and written to the UART by SerialManager_task, which
+//should be called from idle time (scheduler background).  Sending never waits on the UART.
+//If the buffer is full the message is dropped and counted.
 SerialManager* SerialManager_new(void);
 
+//Severity levels.  Messages below the current level (default SERIAL_INFO) are thrown away.
+typedef enum { SERIAL_DEBUG, SERIAL_INFO, SERIAL_WARNING, SERIAL_ERROR } SerialLevel;
+void SerialManager_setLevel(SerialManager* me, SerialLevel minimumLevel);
+
+//Identical messages sent again within SERIALMANAGER_REPEAT_WINDOW_US of each other are
+//suppressed and reported once as "(last message repeated N times)".
+//Returns IO_E_BUSY if the message was dropped because the buffer is full.
+IO_ErrorType SerialManager_log(SerialManager* me, SerialLevel level, const ubyte1* data);
+
 //usage:
 //ubyte1* message = "my message";
 //Write(serialMan, message);
-IO_ErrorType SerialManager_send(SerialManager* me, const ubyte1* data);
+IO_ErrorType SerialManager_send(SerialManager* me, const ubyte1* data);  //SERIAL_INFO
 //IO_ErrorType SerialManager_sendLen(SerialManager* me, const ubyte1* data, ubyte1* dataLength);
 
+//Repeats are limited per call site (format string), before any formatting is done
 IO_ErrorType SerialManager_sprintf(SerialManager* me, const ubyte1* message, void* dataValue);
-#endif // This header has been defined before
\ No newline at end of file
+
+//Moves queued data to the UART driver.  Never blocks.
+void SerialManager_task(SerialManager* me);
+
+ubyte2 SerialManager_getDroppedCount(SerialManager* me);
+#endif // This header has been defined before
@@ -1,14 +1,26 @@
-#include <stdlib.h>  //Needed for malloc
 #include <math.h>
 #include "IO_RTC.h"
 
 #include "torqueEncoder.h"
+#include "arena.h"
 #include "mathFunctions.h"
+#include "fixedPoint.h"
+#include "eepromManager.h"
 
 #include "sensors.h"
 extern Sensor Sensor_BenchTPS0;
 extern Sensor Sensor_BenchTPS1;
 
+//A stored calibration narrower than this (in mV) is assumed to be from a botched sweep
+#define TPS_MIN_CALIBRATION_SPAN 200
+
+//Precompute the reciprocals so update() doesn't have to divide
+static void TorqueEncoder_setSpans(TorqueEncoder* me)
+{
+    FixedPoint_setSpan(&me->tps0_span, me->tps0_calibMin, me->tps0_calibMax);
+    FixedPoint_setSpan(&me->tps1_span, me->tps1_calibMin, me->tps1_calibMax);
+}
+
 /*****************************************************************************
 * Torque Encoder (TPS) functions
 * RULE EV2.3.5:
@@ -17,7 +29,7 @@ extern Sensor Sensor_BenchTPS1;
 ****************************************************************************/
 TorqueEncoder* TorqueEncoder_new(bool benchMode)
 {
-    TorqueEncoder* me = (TorqueEncoder*)malloc(sizeof(struct _TorqueEncoder));
+    TorqueEncoder* me = (TorqueEncoder*)Arena_allocate(ARENA_INTERNAL, sizeof(struct _TorqueEncoder));
     //me->bench = benchMode;
 	
     //TODO: Make sure the main loop is running before doing this
@@ -61,6 +73,7 @@ TorqueEncoder* TorqueEncoder_new(bool benchMode)
     //me->tps1_calibMin = 2382;  //me->tps1->sensorValue;
     //me->tps1_calibMax = 4441;  //me->tps1->sensorValue;
 
+    TorqueEncoder_setSpans(me);
     me->calibrated = TRUE;
 
     return me;
@@ -99,10 +112,10 @@ void TorqueEncoder_update(TorqueEncoder* me)
 		{
 			//Calculate individual throttle percentages
 			//Percent = (Voltage - CalibMin) / (CalibMax - CalibMin)
-			me->tps0_percent = getPercent(me->tps0_value, me->tps0_calibMin, me->tps0_calibMax, TRUE);
-			me->tps1_percent = getPercent(me->tps1_value, me->tps1_calibMin, me->tps1_calibMax, TRUE);
+			me->tps0_percent = FixedPoint_percent(&me->tps0_span, me->tps0_value);
+			me->tps1_percent = FixedPoint_percent(&me->tps1_span, me->tps1_value);
 
-			me->percent = (me->tps0_percent + me->tps1_percent) / 2;
+			me->percent = ((ubyte4)me->tps0_percent + me->tps1_percent) / 2;
 		}
 	}
 }
@@ -118,14 +131,42 @@ void TorqueEncoder_resetCalibration(TorqueEncoder* me)
     me->tps1_calibMax = me->tps1->sensorValue;
 }
 
-void TorqueEncoder_saveCalibrationToEEPROM(TorqueEncoder* me)
+void TorqueEncoder_saveCalibrationToEEPROM(TorqueEncoder* me, EEPROMManager* eeprom)
 {
+    EEPROMCalibration calibration;
+    EEPROMManager_getCalibration(eeprom, &calibration);  //Keep the BPS values
+
+    calibration.tps0_calibMin = (ubyte2)me->tps0_calibMin;
+    calibration.tps0_calibMax = (ubyte2)me->tps0_calibMax;
+    calibration.tps1_calibMin = (ubyte2)me->tps1_calibMin;
+    calibration.tps1_calibMax = (ubyte2)me->tps1_calibMax;
+    EEPROMManager_setCalibration(eeprom, &calibration);
+}
 
+//Stored range must sit inside the sensor's datasheet limits and be wide enough to be a real sweep
+static bool TorqueEncoder_calibrationPlausible(Sensor* tps, ubyte2 calibMin, ubyte2 calibMax)
+{
+    return (calibMin >= tps->specMin && calibMax <= tps->specMax && (ubyte4)calibMin + TPS_MIN_CALIBRATION_SPAN <= calibMax);
 }
 
-void TorqueEncoder_loadCalibrationFromEEPROM(TorqueEncoder* me)
+bool TorqueEncoder_loadCalibrationFromEEPROM(TorqueEncoder* me, EEPROMManager* eeprom)
 {
+    EEPROMCalibration calibration;
 
+    if (EEPROMManager_getCalibration(eeprom, &calibration) == FALSE) { return FALSE; }
+    if (TorqueEncoder_calibrationPlausible(me->tps0, calibration.tps0_calibMin, calibration.tps0_calibMax) == FALSE
+     || TorqueEncoder_calibrationPlausible(me->tps1, calibration.tps1_calibMin, calibration.tps1_calibMax) == FALSE)
+    {
+        return FALSE;
+    }
+
+    me->tps0_calibMin = calibration.tps0_calibMin;
+    me->tps0_calibMax = calibration.tps0_calibMax;
+    me->tps1_calibMin = calibration.tps1_calibMin;
+    me->tps1_calibMax = calibration.tps1_calibMax;
+    TorqueEncoder_setSpans(me);
+    me->calibrated = TRUE;
+    return TRUE;
 }
 
 void TorqueEncoder_startCalibration(TorqueEncoder* me, ubyte1 secondsToRun)
@@ -176,13 +217,14 @@ void TorqueEncoder_calibrationCycle(TorqueEncoder* me, ubyte1* errorCount)
             //float4 pedalTopPlay = 1.05;
             //float4 pedalBottomPlay = .95;
 
-            //Shrink the calibrated range slightly
-            float4 shrink0 = (me->tps0_calibMax - me->tps0_calibMin) * .05;
-            float4 shrink1 = (me->tps1_calibMax - me->tps1_calibMin) * .05;
+            //Shrink the calibrated range slightly (5% each end)
+            ubyte4 shrink0 = (me->tps0_calibMax - me->tps0_calibMin) / 20;
+            ubyte4 shrink1 = (me->tps1_calibMax - me->tps1_calibMin) / 20;
             me->tps0_calibMin += shrink0;
             me->tps0_calibMax -= shrink0;
             me->tps1_calibMin += shrink1;
             me->tps1_calibMax -= shrink1;
+            TorqueEncoder_setSpans(me);
 
 
 			me->runCalibration = FALSE;
@@ -197,9 +239,8 @@ void TorqueEncoder_calibrationCycle(TorqueEncoder* me, ubyte1* errorCount)
         //TODO: Throw warning: calibrationCycle helper function was called but calibration should not be running
     }
 
-    //TODO: Write calibration data to EEPROM
-
-    //TODO: Check for valid/reasonable calibration data
+    //Calibration data is written to EEPROM by the caller (see TorqueEncoder_saveCalibrationToEEPROM)
+    //and checked for valid/reasonable values when it is loaded
 
     //TODO: Do something on the display to show that voltages are being recorded
 
@@ -209,7 +250,7 @@ void TorqueEncoder_calibrationCycle(TorqueEncoder* me, ubyte1* errorCount)
 }
 
 
-void TorqueEncoder_getIndividualSensorPercent(TorqueEncoder* me, ubyte1 sensorNumber, float4* percent)
+void TorqueEncoder_getIndividualSensorPercent(TorqueEncoder* me, ubyte1 sensorNumber, Q15* percent)
 {
 	switch (sensorNumber)
 	{
@@ -228,12 +269,12 @@ void TorqueEncoder_getIndividualSensorPercent(TorqueEncoder* me, ubyte1 sensorNu
 * Description: Reads TPS Pin voltages and returns % of throttle pedal travel.
 * Parameters:  None
 * Inputs:      Assumes TPS#.sensorValue has been set by main loop
-* Returns:     Throttle value in percent (from 0 to 1)
+* Returns:     Throttle value in percent (Q15: 0 to FIXEDPOINT_ONE)
 * Notes:       Valid pedal travel is from 10% (0.10) to 90% (0.90), not including mechanical limits.
 * Throws:      000 - TPS0 voltage out of range
 *              001 - TPS1 voltage out of range, 002
 -------------------------------------------------------------------*/
-void TorqueEncoder_getPedalTravel(TorqueEncoder* me, ubyte1* errorCount, float4* pedalPercent)
+void TorqueEncoder_getPedalTravel(TorqueEncoder* me, ubyte1* errorCount, Q15* pedalPercent)
 {
 	*pedalPercent = me->percent;
 
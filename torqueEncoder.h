@@ -3,6 +3,8 @@
 
 #include "IO_Driver.h"
 #include "sensors.h"
+#include "fixedPoint.h"
+#include "eepromManager.h"
 
 //After updateFromSensors, access to tps Sensor objects should no longer be necessary.
 //In other words, only updateFromSensors itself should use the tps Sensor objects
@@ -18,32 +20,35 @@ typedef struct _TorqueEncoder
 	ubyte4 tps0_calibMax;
 	bool tps0_reverse;
 	ubyte4 tps0_value;
-    float4 tps0_percent;
+    Q15 tps0_percent;
+    FixedPointSpan tps0_span;  //calibMin -> calibMax, set whenever the calibration changes
 
 	ubyte4 tps1_calibMin;
     ubyte4 tps1_calibMax;
 	bool tps1_reverse; 
 	ubyte4 tps1_value;
-    float4 tps1_percent;
+    Q15 tps1_percent;
+    FixedPointSpan tps1_span;
 
     bool runCalibration;
     ubyte4 timestamp_calibrationStart;
     ubyte1 calibrationRunTime;
 
     bool calibrated;
-    float4 percent;
+    Q15 percent;
 	bool implausibility;
 } TorqueEncoder;
 
 TorqueEncoder* TorqueEncoder_new(bool benchMode);
 void TorqueEncoder_update(TorqueEncoder* me);
-void TorqueEncoder_getIndividualSensorPercent(TorqueEncoder* me, ubyte1 sensorNumber, float4* percent);
+void TorqueEncoder_getIndividualSensorPercent(TorqueEncoder* me, ubyte1 sensorNumber, Q15* percent);
 void TorqueEncoder_resetCalibration(TorqueEncoder* me);
-void TorqueEncoder_saveCalibrationToEEPROM(TorqueEncoder* me);
-void TorqueEncoder_loadCalibrationFromEEPROM(TorqueEncoder* me);
+void TorqueEncoder_saveCalibrationToEEPROM(TorqueEncoder* me, EEPROMManager* eeprom);
+//Returns FALSE (and keeps the current calibration) if nothing is stored or the stored values look wrong
+bool TorqueEncoder_loadCalibrationFromEEPROM(TorqueEncoder* me, EEPROMManager* eeprom);
 void TorqueEncoder_startCalibration(TorqueEncoder* me, ubyte1 secondsToRun);
 void TorqueEncoder_calibrationCycle(TorqueEncoder* me, ubyte1* errorCount);
 //void TorqueEncoder_plausibilityCheck(TorqueEncoder* me, ubyte1* errorCount, bool* isPlausible);
-void TorqueEncoder_getPedalTravel(TorqueEncoder* me, ubyte1* errorCount, float4* pedalPercent);
+void TorqueEncoder_getPedalTravel(TorqueEncoder* me, ubyte1* errorCount, Q15* pedalPercent);
 
 #endif //  _TORQUEENCODER_H
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "IO_Driver.h"
+
+#include "vehicleState.h"
+#include "arena.h"
+
+struct _VehicleStateBuffer
+{
+    VehicleState states[2];
+    ubyte1 front;               //Index of the published snapshot
+};
+
+static const VehicleState VehicleState_empty = { 0 };
+
+VehicleStateBuffer* VehicleStateBuffer_new(void)
+{
+    //External: written once per tick and read field by field, and the internal
+    //region is already taken by the objects that run state machines every tick
+    VehicleStateBuffer* me = (VehicleStateBuffer*)Arena_allocate(ARENA_EXTERNAL, sizeof(struct _VehicleStateBuffer));
+
+    me->states[0] = VehicleState_empty;
+    me->states[1] = VehicleState_empty;
+    me->front = 0;
+    return me;
+}
+
+VehicleState* VehicleStateBuffer_getBack(VehicleStateBuffer* me)
+{
+    return &me->states[me->front ^ 1];
+}
+
+void VehicleStateBuffer_publish(VehicleStateBuffer* me)
+{
+    me->front ^= 1;
+}
+
+const VehicleState* VehicleStateBuffer_getFront(VehicleStateBuffer* me)
+{
+    return &me->states[me->front];
+}
@@ -0,0 +1,104 @@
+#ifndef _VEHICLESTATE_H
+#define _VEHICLESTATE_H
+
+#include "IO_Driver.h"
+#include "fixedPoint.h"
+
+/*****************************************************************************
+* Vehicle state snapshot
+******************************************************************************
+* Everything the control and telemetry code needs from one fast task tick, in
+* one flat struct.  The fast task fills it in two steps:
+*   inputs  - after the sensors, pedals and wheel speeds have been updated
+*             (the torque calculation and the fast safety checks read these)
+*   outputs - once the torque command is final (after SafetyChecker and the
+*             inverter control)
+* and then publishes it.
+*
+* Two copies: the fast task always writes the back one, and publish swaps
+* them.  Everything else (medium/slow tasks, the 0xC0 and data logger output
+* at the end of the fast tick) reads the front one, so it always sees one
+* complete tick - telemetry shows exactly what the controller used, and a
+* value can't change halfway through a task.
+*
+* Settings and calibrations (regen mode, TPS/BPS calibration limits, ...)
+* aren't measurements and are still read from their objects.
+*
+* Fields are grouped by size (all 4 byte fields, then 2 byte, then 1 byte)
+* so the struct packs without holes; inputs come first within each group.
+****************************************************************************/
+
+//pedalStatus bits (sensor supply/signal IO errors, spec range, calibration)
+#define VEHICLESTATE_TPS_POWER_ERROR    0x01    //tps0/tps1 ioErr_powerInit/powerSet
+#define VEHICLESTATE_BPS_POWER_ERROR    0x02
+#define VEHICLESTATE_TPS_SIGNAL_ERROR   0x04    //tps0/tps1 ioErr_signalInit/signalGet
+#define VEHICLESTATE_BPS_SIGNAL_ERROR   0x08
+#define VEHICLESTATE_TPS_OUT_OF_SPEC    0x10    //Either TPS reading outside its specMin/specMax
+#define VEHICLESTATE_BPS_OUT_OF_SPEC    0x20
+#define VEHICLESTATE_TPS_CALIBRATED     0x40
+#define VEHICLESTATE_BPS_CALIBRATED     0x80
+
+typedef struct _VehicleState
+{
+    //---------------------------------------------------------------
+    // 4 byte fields
+    //---------------------------------------------------------------
+    //Inputs
+    sbyte4 mcmPowerW;               //MCM_getPower
+    sbyte4 bmsPowerW;               //BMS_getPower
+    //Outputs
+    ubyte4 faults;                  //SafetyChecker flags
+    sbyte4 powerLimitTrimW;         //PowerLimiter PI output, <= 0
+
+    //---------------------------------------------------------------
+    // 2 byte fields
+    //---------------------------------------------------------------
+    //Inputs
+    Q15 throttlePercent;            //TorqueEncoder percent (pedal travel)
+    Q15 tps0Percent;
+    Q15 tps1Percent;
+    Q15 brakePercent;               //BrakePressureSensor percent
+    ubyte2 tps0Value;               //Sensor readings (ADC counts / PWM)
+    ubyte2 tps1Value;
+    ubyte2 bps0Value;
+    ubyte2 wheelSpeed[4];           //mm/s, by Wheel
+    ubyte2 wheelSpeedSensor[4];     //Raw WSS frequency (Hz), by Wheel
+    ubyte2 lvBatteryMV;
+    ubyte2 bmsDCL;                  //A
+    ubyte2 bmsCCL;                  //A
+    sbyte2 mcmTemp;                 //C
+    sbyte2 motorTemp;               //C
+    //Outputs
+    ubyte2 warnings;
+    ubyte2 notices;
+    sbyte2 requestedTorqueDNm;      //MCM_calculateCommands, before SafetyChecker_reduceTorque
+    sbyte2 commandedTorqueDNm;      //What goes out in 0xC0
+    sbyte2 torqueLimitDNm;
+    ubyte2 torqueCeilingDNm;        //PowerLimiter ceiling for the direction of the request
+
+    //---------------------------------------------------------------
+    // 1 byte fields
+    //---------------------------------------------------------------
+    //Inputs
+    sbyte1 batteryMaxTemp;          //C
+    ubyte1 pedalStatus;             //VEHICLESTATE_* bits
+    bool hvilTermSense;
+    //Outputs
+    ubyte1 mcmStartupStage;
+    ubyte1 direction;               //Direction
+    ubyte1 powerLimit;              //PowerLimitSource
+    bool inverterEnabled;
+} VehicleState;
+
+typedef struct _VehicleStateBuffer VehicleStateBuffer;
+
+VehicleStateBuffer* VehicleStateBuffer_new(void);
+
+//Fast task only: the snapshot being built this tick
+VehicleState* VehicleStateBuffer_getBack(VehicleStateBuffer* me);
+//Fast task, once the outputs are filled in: the back snapshot becomes the front one
+void VehicleStateBuffer_publish(VehicleStateBuffer* me);
+//Latest complete tick (all zeros before the first publish)
+const VehicleState* VehicleStateBuffer_getFront(VehicleStateBuffer* me);
+
+#endif // _VEHICLESTATE_H
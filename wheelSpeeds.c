@@ -1,10 +1,11 @@
-#include <stdlib.h>  //Needed for malloc
 #include <math.h>
 #include "IO_RTC.h"
 #include "IO_DIO.h"
 
 #include "wheelSpeeds.h"
+#include "arena.h"
 #include "mathFunctions.h"
+#include "fixedPoint.h"
 
 #include "sensors.h"
 //extern Sensor Sensor_BPS0;
@@ -18,16 +19,33 @@
 * for i.e. traction control
 ****************************************************************************/
 
+//No valid PWD reading for this long = the wheel has stopped (or the sensor is gone).
+//At 16 pulses per rotation on an 18" tire this is ~0.45 m/s.
+#define WHEELSPEEDS_TIMEOUT_US 200000
+
+//Below this the pulse rate is too low for slip to mean anything
+#define WHEELSPEEDS_SLIP_MIN_SPEED 2000
+
+//Reference speed low pass: 1/4 per update (~20 ms at 5 ms)
+#define WHEELSPEEDS_REFERENCE_SHIFT 2
+
+static Sensor* const wheelSpeedSensors[4] = { &Sensor_WSS_FL, &Sensor_WSS_FR, &Sensor_WSS_RL, &Sensor_WSS_RR };
+
 struct _WheelSpeeds
 {
-	float4 tireCircumferenceMeters_F;  //calculated
-	float4 tireCircumferenceMeters_R;  //calculated
-	float4 pulsesPerRotation_F;
-	float4 pulsesPerRotation_R;
-	float4 speed_FL;
-	float4 speed_FR;
-	float4 speed_RL;
-	float4 speed_RR;
+	//Precomputed at _new: speed (mm/s) = (pulses/sec * scale) >> 16
+	ubyte4 scale_F;             //mm per pulse, Q16
+	ubyte4 scale_R;
+	ubyte2 maxFrequency_F;      //Saturate here so the speed fits in 16 bits
+	ubyte2 maxFrequency_R;
+
+	ubyte4 timebase;            //IO_RTC timestamp that lastReading times are measured from
+	ubyte4 timestamp_lastReading[4];
+	ubyte2 speed[4];            //mm/s, indexed by Wheel
+
+	ubyte4 referenceState;      //referenceSpeed << WHEELSPEEDS_REFERENCE_SHIFT
+	ubyte2 referenceSpeed;
+	sbyte2 slip;
 };
 
 
@@ -40,17 +58,25 @@ struct _WheelSpeeds
 ****************************************************************************/
 WheelSpeeds* WheelSpeeds_new(float4 tireDiameterInches_F, float4 tireDiameterInches_R, ubyte1 pulsesPerRotation_F, ubyte1 pulsesPerRotation_R)
 {
-	WheelSpeeds* me = (WheelSpeeds*)malloc(sizeof(struct _WheelSpeeds));
-    
-	//1 inch = .0254 m
-	me->tireCircumferenceMeters_F = 3.14159 * (.0254 * tireDiameterInches_F);
-	me->tireCircumferenceMeters_R = 3.14159 * (.0254 * tireDiameterInches_R);
-	me->pulsesPerRotation_F = pulsesPerRotation_F;
-	me->pulsesPerRotation_R = pulsesPerRotation_R;
-	me->speed_FL = 0;
-	me->speed_FR = 0;
-	me->speed_RL = 0;
-	me->speed_RR = 0;
+	WheelSpeeds* me = (WheelSpeeds*)Arena_allocate(ARENA_INTERNAL, sizeof(struct _WheelSpeeds));
+
+	//1 inch = 25.4 mm.  Float is fine here - this only runs once.
+	float4 circumferenceMM_F = 3.14159 * 25.4 * tireDiameterInches_F;
+	float4 circumferenceMM_R = 3.14159 * 25.4 * tireDiameterInches_R;
+	me->scale_F = (ubyte4)(circumferenceMM_F * 65536 / pulsesPerRotation_F);
+	me->scale_R = (ubyte4)(circumferenceMM_R * 65536 / pulsesPerRotation_R);
+	me->maxFrequency_F = (ubyte2)(65535.0 * pulsesPerRotation_F / circumferenceMM_F);
+	me->maxFrequency_R = (ubyte2)(65535.0 * pulsesPerRotation_R / circumferenceMM_R);
+
+	IO_RTC_StartTime(&me->timebase);
+	for (ubyte1 corner = FL; corner <= RR; corner++)
+	{
+		me->timestamp_lastReading[corner] = 0 - WHEELSPEEDS_TIMEOUT_US - 1;  //No reading yet
+		me->speed[corner] = 0;
+	}
+	me->referenceState = 0;
+	me->referenceSpeed = 0;
+	me->slip = 0;
 
 	//Turn on WSS power pins
 	IO_DO_Set(IO_DO_06, TRUE); //Front WSS x2
@@ -61,48 +87,83 @@ WheelSpeeds* WheelSpeeds_new(float4 tireDiameterInches_F, float4 tireDiameterInc
 
 void WheelSpeeds_update(WheelSpeeds* me)
 {
-	//speed (m/s) = m * pulses/sec / pulses
-	me->speed_FL = me->tireCircumferenceMeters_F * Sensor_WSS_FL.sensorValue / me->pulsesPerRotation_F;
-	me->speed_FR = me->tireCircumferenceMeters_F * Sensor_WSS_FR.sensorValue / me->pulsesPerRotation_F;
-	me->speed_RL = me->tireCircumferenceMeters_R * Sensor_WSS_RL.sensorValue / me->pulsesPerRotation_R;
-	me->speed_RR = me->tireCircumferenceMeters_R * Sensor_WSS_RR.sensorValue / me->pulsesPerRotation_R;
-}
+	ubyte4 now = IO_RTC_GetTimeUS(me->timebase);
+	bool valid[4];
 
-float4 WheelSpeeds_getWheelSpeed(WheelSpeeds* me, Wheel corner)
-{
-	float4 speed;
-	switch (corner)
+	//----------------------------------------------------------------------------
+	// Wheel speeds
+	//----------------------------------------------------------------------------
+	for (ubyte1 corner = FL; corner <= RR; corner++)
+	{
+		Sensor* wss = wheelSpeedSensors[corner];
+		bool front = (corner == FL || corner == FR);
+
+		if (wss->ioErr_signalGet == IO_E_OK)
+		{
+			//speed (mm/s) = mm/pulse * pulses/sec
+			ubyte2 maxFrequency = front ? me->maxFrequency_F : me->maxFrequency_R;
+			ubyte4 frequency = (wss->sensorValue > maxFrequency) ? maxFrequency : wss->sensorValue;
+			me->speed[corner] = (ubyte2)((frequency * (front ? me->scale_F : me->scale_R)) >> 16);
+			me->timestamp_lastReading[corner] = now;
+		}
+
+		//Keep the last speed through the odd missed reading, but not forever
+		valid[corner] = (now - me->timestamp_lastReading[corner] <= WHEELSPEEDS_TIMEOUT_US);
+		if (valid[corner] == FALSE) { me->speed[corner] = 0; }
+	}
+
+	//----------------------------------------------------------------------------
+	// Vehicle reference speed: the fronts aren't driven, so the slower one is
+	// the best guess of how fast the car is moving.  If one front sensor has
+	// timed out, use the other one.
+	//----------------------------------------------------------------------------
+	ubyte2 frontSpeed;
+	if (valid[FL] == TRUE && valid[FR] == TRUE) { frontSpeed = WheelSpeeds_getSlowestFront(me); }
+	else if (valid[FL] == TRUE) { frontSpeed = me->speed[FL]; }
+	else if (valid[FR] == TRUE) { frontSpeed = me->speed[FR]; }
+	else { frontSpeed = 0; }
+
+	me->referenceState = me->referenceState - (me->referenceState >> WHEELSPEEDS_REFERENCE_SHIFT) + frontSpeed;
+	me->referenceSpeed = (ubyte2)(me->referenceState >> WHEELSPEEDS_REFERENCE_SHIFT);
+
+	//----------------------------------------------------------------------------
+	// Slip: fastest rear vs reference.  At low speed the reference is floored so
+	// a launch still shows up as slip, without dividing by ~0.
+	//----------------------------------------------------------------------------
+	ubyte2 rearSpeed = WheelSpeeds_getFastestRear(me);
+	if (me->referenceSpeed < WHEELSPEEDS_SLIP_MIN_SPEED && rearSpeed < WHEELSPEEDS_SLIP_MIN_SPEED)
 	{
-	case FL:
-		speed = me->speed_FL;
-		break;
-	case FR:
-		speed = me->speed_FR;
-		break;
-	case RL:
-		speed = me->speed_RL;
-		break;
-	case RR:
-		speed = me->speed_RR;
-		break;
-	default:
-		speed = 0;
+		me->slip = 0;
 	}
+	else
+	{
+		ubyte2 denominator = (me->referenceSpeed < WHEELSPEEDS_SLIP_MIN_SPEED) ? WHEELSPEEDS_SLIP_MIN_SPEED : me->referenceSpeed;
+		sbyte4 slip = ((sbyte4)rearSpeed - (sbyte4)me->referenceSpeed) * 1000 / denominator;
+		me->slip = (sbyte2)FixedPoint_clamp(slip, -32767, 32767);
+	}
+}
 
-	return speed;
+ubyte2 WheelSpeeds_getWheelSpeed(WheelSpeeds* me, Wheel corner)
+{
+	return (corner <= RR) ? me->speed[corner] : 0;
+}
+
+ubyte2 WheelSpeeds_getSlowestFront(WheelSpeeds* me)
+{
+	return (me->speed[FL] < me->speed[FR]) ? me->speed[FL] : me->speed[FR];
 }
 
-float4 WheelSpeeds_getSlowestFront(WheelSpeeds* me)
+ubyte2 WheelSpeeds_getFastestRear(WheelSpeeds* me)
 {
-	return (me->speed_FL < me->speed_FR) ? me->speed_FL : me->speed_FR;
+	return (me->speed[RL] > me->speed[RR]) ? me->speed[RL] : me->speed[RR];
 }
 
-float4 WheelSpeeds_getFastestRear(WheelSpeeds* me)
+ubyte2 WheelSpeeds_getGroundSpeed(WheelSpeeds* me)
 {
-	return (me->speed_RL > me->speed_RR) ? me->speed_RL : me->speed_RR;
+	return me->referenceSpeed;
 }
 
-float4 WheelSpeeds_getGroundSpeed(WheelSpeeds* me)
+sbyte2 WheelSpeeds_getSlip(WheelSpeeds* me)
 {
-	return (me->speed_FL + me->speed_FR) / 2;
+	return me->slip;
 }
@@ -11,11 +11,20 @@ typedef enum { FL,FR,RL,RR } Wheel;
 //Also, all values in the TorqueEncoder object are from 
 typedef struct _WheelSpeeds WheelSpeeds;
 
+//All speeds are in mm/s (saturate at 65535 = 236 km/h).
+//Tire sizes are only used here (once) to precompute the per-axle scales.
 WheelSpeeds* WheelSpeeds_new(float4 tireDiameterInches_F, float4 tireDiameterInches_R, ubyte1 pulsesPerRotation_F, ubyte1 pulsesPerRotation_R);
+
+//Cheap enough for every fast task tick: integer only, one RTC read, one divide (slip)
 void WheelSpeeds_update(WheelSpeeds* me);
-float4 WheelSpeeds_getWheelSpeed(WheelSpeeds* me, Wheel corner);
-float4 WheelSpeeds_getSlowestFront(WheelSpeeds* me);
-float4 WheelSpeeds_getFastestRear(WheelSpeeds* me);
-float4 WheelSpeeds_getGroundSpeed(WheelSpeeds* me);
+
+ubyte2 WheelSpeeds_getWheelSpeed(WheelSpeeds* me, Wheel corner);
+ubyte2 WheelSpeeds_getSlowestFront(WheelSpeeds* me);
+ubyte2 WheelSpeeds_getFastestRear(WheelSpeeds* me);
+ubyte2 WheelSpeeds_getGroundSpeed(WheelSpeeds* me);  //Filtered vehicle reference speed (from the undriven fronts)
+
+//Fastest rear vs reference speed, in 0.1% (1000 = rears turning twice as fast as the car is moving).
+//Negative = rears slower (braking/regen).  0 when the car and the rears are both below the slip minimum speed.
+sbyte2 WheelSpeeds_getSlip(WheelSpeeds* me);
 
 #endif //  _BRAKEPRESSURESENSOR_H
\ No newline at end of file